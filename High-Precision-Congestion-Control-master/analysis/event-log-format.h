@@ -0,0 +1 @@
+../simulation/src/point-to-point/model/event-log-format.h
\ No newline at end of file
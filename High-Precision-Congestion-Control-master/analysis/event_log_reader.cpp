@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "event-log-format.h"
+
+using namespace ns3;
+using namespace std;
+
+int main(int argc, char** argv){
+	if (argc != 2 && argc != 3){
+		printf("Usage: ./event_log_reader <event_log_file> [max_level]\n");
+		return 0;
+	}
+	FILE* file = fopen(argv[1], "r");
+	if (file == NULL){
+		printf("Cannot open %s\n", argv[1]);
+		return 0;
+	}
+	uint32_t max_level = argc == 3 ? atoi(argv[2]) : EVLOG_DEBUG;
+
+	// blocks of different threads are interleaved, records within a block are in time order
+	EventLogBlock b;
+	vector<EventLogRecord> rec;
+	while (fread(&b, sizeof(b), 1, file) == 1){
+		if (b.magic != EVENT_LOG_MAGIC){
+			printf("Corrupted block header\n");
+			return 1;
+		}
+		rec.resize(b.count);
+		if (fread(&rec[0], sizeof(EventLogRecord), b.count, file) != b.count){
+			printf("Truncated block\n");
+			return 1;
+		}
+		for (uint32_t i = 0; i < b.count; i++){
+			EventLogRecord &r = rec[i];
+			if (r.level > max_level)
+				continue;
+			printf("%lu n:%u t:%u %u %s %lu %lu %lu %lu\n", r.time, r.node, b.thread, r.level, EventLogTypeName(r.type), r.arg[0], r.arg[1], r.arg[2], r.arg[3]);
+		}
+	}
+	fclose(file);
+}
@@ -0,0 +1 @@
+../simulation/src/point-to-point/model/trace-block-format.h
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef TRACE_AGGREGATE_HPP
+#define TRACE_AGGREGATE_HPP
+
+#include <cstdio>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "trace-format.h"
+
+/*
+ * Aggregates computed by trace_reader -a over the records that pass the filter, instead of
+ * printing them. Each thread fills its own copy, and the copies are merged at the end.
+ */
+class TraceAggregate{
+public:
+	virtual ~TraceAggregate(){}
+	virtual void add(const ns3::TraceFormat &tr) = 0;
+	virtual void merge(const TraceAggregate &other) = 0;
+	virtual void print(FILE *out) = 0;
+	virtual TraceAggregate* clone() = 0; // an empty aggregate of the same kind
+};
+
+/*
+ * -a qlen: histogram of the queue length seen by each enqueued packet, per queue.
+ * Output: one line per non-empty bucket, "node intf qidx bucket_start count", sorted.
+ */
+class QlenHistogram : public TraceAggregate{
+public:
+	uint32_t bucket; // bytes
+	std::unordered_map<uint32_t, std::vector<uint64_t> > hist; // node << 16 | intf << 8 | qidx
+
+	QlenHistogram(uint32_t _bucket) : bucket(_bucket) {}
+	void add(const ns3::TraceFormat &tr){
+		if (tr.event != ns3::Enqu)
+			return;
+		std::vector<uint64_t> &h = hist[((uint32_t)tr.node << 16) | ((uint32_t)tr.intf << 8) | tr.qidx];
+		uint32_t b = tr.qlen / bucket;
+		if (b >= h.size())
+			h.resize(b + 1, 0);
+		h[b]++;
+	}
+	void merge(const TraceAggregate &other){
+		const QlenHistogram &o = (const QlenHistogram&)other;
+		for (auto &it : o.hist){
+			std::vector<uint64_t> &h = hist[it.first];
+			if (h.size() < it.second.size())
+				h.resize(it.second.size(), 0);
+			for (uint32_t i = 0; i < it.second.size(); i++)
+				h[i] += it.second[i];
+		}
+	}
+	void print(FILE *out){
+		std::map<uint32_t, std::vector<uint64_t>*> sorted;
+		for (auto &it : hist)
+			sorted[it.first] = &it.second;
+		for (auto &it : sorted)
+			for (uint32_t i = 0; i < it.second->size(); i++)
+				if ((*it.second)[i] > 0)
+					fprintf(out, "%u %u %u %lu %lu\n", it.first >> 16, (it.first >> 8) & 0xff, it.first & 0xff, (uint64_t)i * bucket, (*it.second)[i]);
+	}
+	TraceAggregate* clone(){
+		return new QlenHistogram(bucket);
+	}
+};
+
+/*
+ * -a flow: packets, bytes and payload bytes of data packets per flow. Every record that passes
+ * the filter counts, so filter on one point of the path, e.g. "event=0&nodeType=0" for the bytes
+ * received by the hosts.
+ * Output: one line per flow, "sip dip sport dport packets bytes payload", sorted.
+ */
+class FlowBytes : public TraceAggregate{
+public:
+	struct Count{
+		uint64_t packets, bytes, payload;
+	};
+	std::map<std::pair<uint64_t, uint32_t>, Count> flows; // (sip << 32 | dip, sport << 16 | dport)
+
+	void add(const ns3::TraceFormat &tr){
+		if (tr.l3Prot != 0x6 && tr.l3Prot != 0x11)
+			return;
+		Count &c = flows[std::make_pair(((uint64_t)tr.sip << 32) | tr.dip, ((uint32_t)tr.data.sport << 16) | tr.data.dport)];
+		c.packets++;
+		c.bytes += tr.size;
+		c.payload += tr.data.payload;
+	}
+	void merge(const TraceAggregate &other){
+		const FlowBytes &o = (const FlowBytes&)other;
+		for (auto &it : o.flows){
+			Count &c = flows[it.first];
+			c.packets += it.second.packets;
+			c.bytes += it.second.bytes;
+			c.payload += it.second.payload;
+		}
+	}
+	void print(FILE *out){
+		for (auto &it : flows)
+			fprintf(out, "%08x %08x %u %u %lu %lu %lu\n", (uint32_t)(it.first.first >> 32), (uint32_t)it.first.first, it.first.second >> 16, it.first.second & 0xffff, it.second.packets, it.second.bytes, it.second.payload);
+	}
+	TraceAggregate* clone(){
+		return new FlowBytes();
+	}
+};
+
+#endif /* TRACE_AGGREGATE_HPP */
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <stdint.h>
+#include <cstring>
+#include <algorithm>
 #include <cctype>
 #include <regex>
 #include <sstream>
@@ -17,9 +19,13 @@ public:
 	public:
 		uint32_t offset; // data offset in TraceFormat
 		uint8_t op;
+		uint8_t width; // bytes of the field
+		uint64_t value64; // the value, for the compiled program
 
-		Field(uint32_t _offset, std::string &_op){
+		Field(uint32_t _offset, std::string &_op, uint8_t _width, uint64_t _value){
 			offset = _offset;
+			width = _width;
+			value64 = _value;
 			if (_op == "=")
 				op = 0;
 			else if (_op == ">")
@@ -68,7 +74,7 @@ public:
 	class ByteField : public Field{
 	public:
 		uint8_t value;
-		ByteField(uint32_t _offset, std::string &op, uint8_t _value) : Field(_offset, op), value(_value) {}
+		ByteField(uint32_t _offset, std::string &op, uint8_t _value) : Field(_offset, op, 1, _value), value(_value) {}
 		virtual bool test(ns3::TraceFormat &tr){
 			OP(uint8_t);
 		}
@@ -81,7 +87,7 @@ public:
 	class WordField : public Field{
 	public:
 		uint16_t value;
-		WordField(uint32_t _offset, std::string &op, uint16_t _value) : Field(_offset, op), value(_value) {}
+		WordField(uint32_t _offset, std::string &op, uint16_t _value) : Field(_offset, op, 2, _value), value(_value) {}
 		virtual bool test(ns3::TraceFormat &tr){
 			OP(uint16_t);
 		}
@@ -94,7 +100,7 @@ public:
 	class DwordField : public Field{
 	public:
 		uint32_t value;
-		DwordField(uint32_t _offset, std::string &op, uint32_t _value) : Field(_offset, op), value(_value) {}
+		DwordField(uint32_t _offset, std::string &op, uint32_t _value) : Field(_offset, op, 4, _value), value(_value) {}
 		virtual bool test(ns3::TraceFormat &tr){
 			OP(uint32_t);
 		}
@@ -107,7 +113,7 @@ public:
 	class QwordField : public Field{
 	public:
 		uint64_t value;
-		QwordField(uint32_t _offset, std::string &op, uint64_t _value) : Field(_offset, op), value(_value) {}
+		QwordField(uint32_t _offset, std::string &op, uint64_t _value) : Field(_offset, op, 8, _value), value(_value) {}
 		virtual bool test(ns3::TraceFormat &tr){
 			OP(uint64_t);
 		}
@@ -160,25 +166,105 @@ public:
 		}
 	};
 
+	/**********************************
+	 * the tree compiled into a flat program: each instruction tests one field and
+	 * jumps to the next instruction depending on the result, until PASS or FAIL
+	 **********************************/
+	struct Insn{
+		uint32_t offset;
+		uint8_t width;
+		uint8_t op;
+		uint64_t value;
+		int32_t next[2]; // if the test fails, if it passes
+	};
+	static const int32_t PASS = -1, FAIL = -2;
+
 	/***************
 	 * members
 	 ***************/
 	Node* root;
+	std::vector<Insn> prog;
+	int32_t entry;
 
 	/******************
 	 * methods
 	 *****************/
-	TraceFilter() : root(NULL){}
+	TraceFilter() : root(NULL), entry(PASS){}
 	// test a trace if it passes the filter
 	bool test(ns3::TraceFormat &tr){
 		if (root)
 			return root->test(tr);
 		return true;
 	}
+	// same as test(), with the compiled program on a record in memory
+	bool test_compiled(const uint8_t *rec) const{
+		int32_t pc = entry;
+		while (pc >= 0){
+			const Insn &i = prog[pc];
+			uint64_t v = 0;
+			memcpy(&v, rec + i.offset, i.width); // little endian
+			bool r;
+			switch (i.op){
+				case 0: r = v == i.value; break;
+				case 1: r = v > i.value; break;
+				case 2: r = v >= i.value; break;
+				case 3: r = v < i.value; break;
+				case 4: r = v <= i.value; break;
+				case 5: r = v != i.value; break;
+				default: r = false;
+			}
+			pc = i.next[r];
+		}
+		return pc == PASS;
+	}
 
 	// parse an filter expression
 	void parse(std::string expr){
 		root = _parse(expr);
+		prog.clear();
+		entry = root ? compile(root, PASS, FAIL) : PASS;
+	}
+	// helper function: emit the program of n, which continues at t if n is true and at f otherwise; returns its first instruction
+	int32_t compile(Node *n, int32_t t, int32_t f){
+		if (n->type == 0){
+			Insn i;
+			i.offset = n->f->offset;
+			i.width = n->f->width;
+			i.op = n->f->op;
+			i.value = n->f->width == 8 ? n->f->value64 : n->f->value64 & ((1lu << (8 * n->f->width)) - 1);
+			i.next[0] = f;
+			i.next[1] = t;
+			prog.push_back(i);
+			return prog.size() - 1;
+		}
+		int32_t right = compile(n->son[1], t, f);
+		if (n->type == 1)
+			return compile(n->son[0], right, f);
+		return compile(n->son[0], t, right);
+	}
+
+	// the time range that the filter may pass, from the time tests joined by & at the top of the expression
+	void time_range(uint64_t &lo, uint64_t &hi){
+		time_range(root, lo, hi);
+	}
+	void time_range(Node *n, uint64_t &lo, uint64_t &hi){
+		if (n == NULL)
+			return;
+		if (n->type == 1){
+			time_range(n->son[0], lo, hi);
+			time_range(n->son[1], lo, hi);
+			return;
+		}
+		if (n->type != 0 || n->f->offset != offsetof(ns3::TraceFormat, time))
+			return;
+		uint64_t v = n->f->value64;
+		switch (n->f->op){
+			case 0: lo = std::max(lo, v); hi = std::min(hi, v); break;
+			case 1: if (v == ~0lu) lo = 1, hi = 0; else lo = std::max(lo, v + 1); break;
+			case 2: lo = std::max(lo, v); break;
+			case 3: if (v == 0) lo = 1, hi = 0; else hi = std::min(hi, v - 1); break;
+			case 4: hi = std::min(hi, v); break;
+		}
 	}
 	// helper function: skip the spaces from idx i of str
 	static void skip_space(uint32_t &i, const std::string &str){
@@ -1,30 +1,263 @@
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
 #include <unistd.h>
-#include <unordered_map>
-#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "trace-format.h"
+#include "trace-block-format.h"
 #include "trace_filter.hpp"
+#include "trace_aggregate.hpp"
 #include "utils.hpp"
 #include "sim-setting.h"
 
 using namespace ns3;
 using namespace std;
 
+uint64_t time_start = 0, time_end = ~0lu;
+TraceFilter f;
+
+/*
+ * The trace is mapped into memory and cut into chunks: one block of the compressed format, or
+ * RAW_CHUNK_RECORDS records of the raw one. Worker threads filter the chunks and render the
+ * passing records into the chunk's text (or add them to their aggregate), and the main thread
+ * writes the texts in chunk order, so the output is the same with any number of threads.
+ * Workers run at most `window` chunks ahead of the output, to bound the memory.
+ */
+static const uint32_t RAW_CHUNK_RECORDS = 65536;
+
+struct Chunk{
+	const uint8_t *p; // raw records, or the TraceBlockHeader
+	uint32_t count; // raw records
+	bool done, corrupted;
+	string out;
+};
+
+const uint8_t *base;
+size_t file_size;
+bool compressed;
+vector<Chunk> chunks;
+TraceAggregate *agg = NULL; // -a, otherwise the records are printed
+
+mutex m;
+condition_variable cv_worker, cv_output;
+uint32_t next_chunk = 0, printed = 0, window;
+
+static inline void output(const uint8_t *rec, string &out, TraceAggregate *a){
+	uint64_t time;
+	memcpy(&time, rec + offsetof(TraceFormat, time), sizeof(time));
+	if (time < time_start || time > time_end)
+		return;
+	if (!f.test_compiled(rec))
+		return;
+	TraceFormat tr;
+	memcpy(&tr, rec, sizeof(tr));
+	if (a){
+		a->add(tr);
+		return;
+	}
+	char buf[256];
+	out.append(buf, sprint_trace(buf, tr));
+}
+
+// returns false if the block is corrupted
+static bool read_block(const uint8_t *p, string &out, TraceAggregate *a, TraceBlockDecoder &decoder, vector<uint8_t> &raw){
+	TraceBlockHeader h;
+	memcpy(&h, p, sizeof(h));
+	const uint8_t *data = p + sizeof(h);
+	if (h.size != h.rawSize){
+		raw.resize(h.rawSize);
+		if (!TraceLzDecompress(data, h.size, &raw[0], h.rawSize))
+			return false;
+		data = &raw[0];
+	}
+	const uint8_t *end = data + h.rawSize;
+	TraceFormat tr;
+	decoder.Reset();
+	for (uint32_t j = 0; j < h.count; j++){
+		if ((data = decoder.Decode(data, end, tr)) == NULL)
+			return false;
+		output((const uint8_t*)&tr, out, a);
+	}
+	return true;
+}
+
+static void worker(TraceAggregate *a){
+	TraceBlockDecoder decoder;
+	vector<uint8_t> raw;
+	while (true){
+		uint32_t i;
+		{
+			unique_lock<mutex> lock(m);
+			cv_worker.wait(lock, []{ return next_chunk >= chunks.size() || next_chunk < printed + window; });
+			if (next_chunk >= chunks.size())
+				return;
+			i = next_chunk++;
+		}
+		Chunk &c = chunks[i];
+		bool ok = true;
+		if (compressed)
+			ok = read_block(c.p, c.out, a, decoder, raw);
+		else
+			for (uint32_t j = 0; j < c.count; j++)
+				output(c.p + j * sizeof(TraceFormat), c.out, a);
+		{
+			lock_guard<mutex> lock(m);
+			c.corrupted = !ok;
+			c.done = true;
+		}
+		cv_output.notify_one();
+	}
+}
+
+static void add_chunk(const uint8_t *p, uint32_t count){
+	Chunk c;
+	c.p = p;
+	c.count = count;
+	c.done = c.corrupted = false;
+	chunks.push_back(c);
+}
+
+// index of the first raw record after time t
+static uint64_t raw_upper_bound(const uint8_t *data, uint64_t n, uint64_t t){
+	uint64_t lo = 0, hi = n, time;
+	while (lo < hi){
+		uint64_t mid = (lo + hi) / 2;
+		memcpy(&time, data + mid * sizeof(TraceFormat) + offsetof(TraceFormat, time), sizeof(time));
+		if (time <= t)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// old format: raw records from data_start, in time order
+void split_raw(size_t data_start){
+	const uint8_t *data = base + data_start;
+	uint64_t n = (file_size - data_start) / sizeof(TraceFormat);
+	// binary search the records between time_start and time_end
+	uint64_t first = time_start == 0 ? 0 : raw_upper_bound(data, n, time_start - 1), last = time_end == ~0lu ? n : raw_upper_bound(data, n, time_end);
+	for (uint64_t i = first; i < last; i += RAW_CHUNK_RECORDS)
+		add_chunk(data + i * sizeof(TraceFormat), min((uint64_t)RAW_CHUNK_RECORDS, last - i));
+}
+
+// compressed format: blocks from data_start, then the block index if the trace was closed
+void split_blocks(size_t data_start){
+	vector<TraceIndexEntry> index;
+	TraceIndexTrailer t;
+	if (file_size >= data_start + sizeof(t))
+		memcpy(&t, base + file_size - sizeof(t), sizeof(t));
+	if (file_size >= data_start + sizeof(t) && t.magic == TRACE_INDEX_MAGIC){
+		if (t.offset < data_start || t.offset + (uint64_t)t.count * sizeof(TraceIndexEntry) + sizeof(t) != file_size){
+			printf("Truncated block index\n");
+			exit(1);
+		}
+		index.resize(t.count);
+		if (t.count > 0)
+			memcpy(&index[0], base + t.offset, t.count * sizeof(TraceIndexEntry));
+	}else{
+		// no index, the simulation did not finish: walk the block headers
+		fprintf(stderr, "No block index, scanning blocks\n");
+		TraceBlockHeader h;
+		for (size_t offset = data_start; offset + sizeof(h) <= file_size; offset += sizeof(h) + h.size){
+			memcpy(&h, base + offset, sizeof(h));
+			if (h.magic != TRACE_BLOCK_MAGIC)
+				break;
+			TraceIndexEntry e = {(uint64_t)offset, h.firstTime, h.lastTime, h.count, 0};
+			index.push_back(e);
+		}
+	}
+
+	TraceBlockHeader h;
+	for (uint32_t i = 0; i < index.size(); i++){
+		if (index[i].lastTime < time_start || index[i].firstTime > time_end)
+			continue;
+		if (index[i].offset + sizeof(h) > file_size){
+			printf("Corrupted block header\n");
+			exit(1);
+		}
+		memcpy(&h, base + index[i].offset, sizeof(h));
+		if (h.magic != TRACE_BLOCK_MAGIC){
+			printf("Corrupted block header\n");
+			exit(1);
+		}
+		if (index[i].offset + sizeof(h) + h.size > file_size){
+			// the last block of an unfinished trace may be cut
+			fprintf(stderr, "Truncated block\n");
+			return;
+		}
+		add_chunk(base + index[i].offset, h.count);
+	}
+}
+
 int main(int argc, char** argv){
-	if (argc != 2 && argc != 3){
-		printf("Usage: ./trace_reader <trace_file> [filter_expr]\n");
+	int opt;
+	uint32_t nthreads = 1, bucket = 1000;
+	string agg_type;
+	while ((opt = getopt(argc, argv, "s:e:j:a:b:")) != -1){
+		switch (opt){
+			case 's':
+				time_start = strtoull(optarg, NULL, 10);
+				break;
+			case 'e':
+				time_end = strtoull(optarg, NULL, 10);
+				break;
+			case 'j':
+				nthreads = max(1ul, strtoul(optarg, NULL, 10));
+				break;
+			case 'a':
+				agg_type = optarg;
+				break;
+			case 'b':
+				bucket = max(1ul, strtoul(optarg, NULL, 10));
+				break;
+			default:
+				argc = 0;
+		}
+	}
+	if (agg_type == "qlen")
+		agg = new QlenHistogram(bucket);
+	else if (agg_type == "flow")
+		agg = new FlowBytes();
+	else if (agg_type != "")
+		argc = 0;
+	if (argc - optind != 1 && argc - optind != 2){
+		printf("Usage: ./trace_reader [-s start_time] [-e end_time] [-j threads] [-a qlen|flow] [-b qlen_bucket] <trace_file> [filter_expr]\n");
+		return 0;
+	}
+	FILE* file = fopen(argv[optind], "r");
+	if (file == NULL){
+		printf("Cannot open %s\n", argv[optind]);
 		return 0;
 	}
-	FILE* file = fopen(argv[1], "r");
-	TraceFilter f;
-	if (argc == 3){
-		f.parse(argv[2]);
+	if (argc - optind == 2){
+		f.parse(argv[optind + 1]);
 		if (f.root == NULL){
 			printf("Invalid filter\n");
 			return 0;
 		}
 	}
 	//printf("filter: %s\n", f.str().c_str());
+	// the time tests of the filter narrow the chunks to read
+	f.time_range(time_start, time_end);
+
+	// the compressed format starts with a TraceFileHeader, the old one with the SimSetting
+	TraceFileHeader fh;
+	compressed = fread(&fh, sizeof(fh), 1, file) == 1 && fh.magic == TRACE_FILE_MAGIC;
+	if (!compressed)
+		fseeko(file, 0, SEEK_SET);
+	else if (fh.version != TRACE_FILE_VERSION){
+		printf("Unsupported trace version %u\n", fh.version);
+		return 0;
+	}
 
 	// first read SimSetting
 	SimSetting sim_setting;
@@ -35,12 +268,59 @@ int main(int argc, char** argv){
 		for (auto j : i.second)
 			printf("%u,%u:%lu\n", i.first, j.first, j.second);
 	#endif
+	size_t data_start = ftello(file);
+
+	// map the trace
+	struct stat st;
+	fstat(fileno(file), &st);
+	file_size = st.st_size;
+	if (file_size <= data_start || time_start > time_end){
+		fclose(file);
+		if (agg)
+			agg->print(stdout);
+		return 0;
+	}
+	base = (const uint8_t*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+	if (base == MAP_FAILED){
+		printf("Cannot map %s\n", argv[optind]);
+		return 0;
+	}
+	madvise((void*)base, file_size, MADV_SEQUENTIAL);
 
 	// read trace
-	TraceFormat tr;
-	while (tr.Deserialize(file) > 0){
-		if (!f.test(tr))
-			continue;
-		print_trace(tr);
+	if (compressed)
+		split_blocks(data_start);
+	else
+		split_raw(data_start);
+	window = nthreads * 4;
+	vector<TraceAggregate*> aggs;
+	vector<thread> threads;
+	for (uint32_t i = 0; i < nthreads; i++){
+		aggs.push_back(agg ? agg->clone() : NULL);
+		threads.push_back(thread(worker, aggs[i]));
+	}
+	for (uint32_t i = 0; i < chunks.size(); i++){
+		unique_lock<mutex> lock(m);
+		cv_output.wait(lock, [i]{ return chunks[i].done; });
+		lock.unlock();
+		if (chunks[i].corrupted){
+			fflush(stdout);
+			printf("Corrupted block\n");
+			exit(1);
+		}
+		fwrite(chunks[i].out.data(), 1, chunks[i].out.size(), stdout);
+		string().swap(chunks[i].out);
+		lock.lock();
+		printed = i + 1;
+		cv_worker.notify_all();
+	}
+	for (uint32_t i = 0; i < nthreads; i++)
+		threads[i].join();
+	if (agg){
+		for (uint32_t i = 0; i < nthreads; i++)
+			agg->merge(*aggs[i]);
+		agg->print(stdout);
 	}
+	munmap((void*)base, file_size);
+	fclose(file);
 }
@@ -0,0 +1,101 @@
+from __future__ import print_function
+import argparse
+import subprocess
+import sys
+import os
+
+# Go-back-N against selective repeat (L2_SELECTIVE_REPEAT) across loss rates (ERROR_RATE_PER_LINK).
+# Every run is the base config with these keys replaced, and its outputs in the --out directory.
+# For each run: the flows finished, the mean and 99th percentile FCT, the mean slowdown
+# (FCT / standalone FCT), and the goodput: the bytes of the finished flows over the time from the
+# first start to the last finish.
+
+def read_config(name):
+	keys = []
+	conf = {}
+	with open(name) as f:
+		for line in f:
+			line = line.strip()
+			if len(line) == 0:
+				continue
+			key, _, value = line.partition(' ')
+			keys.append(key)
+			conf[key] = value
+	return keys, conf
+
+def write_config(name, keys, conf):
+	with open(name, "w") as f:
+		for key in keys:
+			f.write("%s %s\n"%(key, conf[key]))
+
+def get_pctl(a, p):
+	return a[min(int(len(a) * p), len(a) - 1)]
+
+def fct_stats(fct_file):
+	# sip dip sport dport size start_time fct standalone_fct
+	fcts = []
+	slowdown = 0.
+	size = 0
+	first, last = None, 0
+	with open(fct_file) as f:
+		for line in f:
+			v = line.split()
+			if len(v) < 8:
+				continue
+			start, fct, base = int(v[5]), int(v[6]), int(v[7])
+			fcts.append(fct)
+			slowdown += max(float(fct) / base, 1.)
+			size += int(v[4])
+			first = start if first is None else min(first, start)
+			last = max(last, start + fct)
+	if len(fcts) == 0:
+		return 0, 0., 0, 0., 0.
+	fcts.sort()
+	goodput = size * 8. / (last - first) if last > first else 0. # bits per ns, i.e. Gb/s
+	return len(fcts), sum(fcts) / float(len(fcts)), get_pctl(fcts, 0.99), slowdown / len(fcts), goodput
+
+if __name__ == "__main__":
+	parser = argparse.ArgumentParser(description='compare go-back-N and selective repeat across loss rates')
+	parser.add_argument('--config', dest='config', action='store', default='mix/config.txt', help="the base config")
+	parser.add_argument('--loss', dest='loss', action='store', default='0,0.0001,0.001,0.01', help="comma separated ERROR_RATE_PER_LINK")
+	parser.add_argument('--out', dest='out', action='store', default='mix/loss', help="directory of the configs and outputs")
+	parser.add_argument('--bin', dest='bin', action='store', default='', help="run this build of scratch/third instead of ./waf --run")
+	args = parser.parse_args()
+
+	keys, base = read_config(args.config)
+	for key in ['ERROR_RATE_PER_LINK', 'L2_SELECTIVE_REPEAT', 'ENABLE_TRACE']:
+		if key not in base:
+			keys.append(key)
+	with open(base['FLOW_FILE']) as f:
+		n_flow = int(f.readline().split()[0])
+	if not os.path.isdir(args.out):
+		os.makedirs(args.out)
+
+	print("%-10s %-4s %9s %12s %12s %9s %12s"%("loss", "mode", "finished", "avg fct(us)", "p99 fct(us)", "slowdown", "goodput(Gb/s)"))
+	for loss in args.loss.split(','):
+		for sr in [0, 1]:
+			mode = "sr" if sr else "gbn"
+			prefix = "%s/%s_%s"%(args.out, mode, loss)
+			conf = dict(base)
+			conf['ERROR_RATE_PER_LINK'] = loss
+			conf['L2_SELECTIVE_REPEAT'] = str(sr)
+			conf['ENABLE_TRACE'] = '0'
+			conf['TRACE_OUTPUT_FILE'] = prefix + "_mix.tr"
+			conf['FCT_OUTPUT_FILE'] = prefix + "_fct.txt"
+			conf['PFC_OUTPUT_FILE'] = prefix + "_pfc.txt"
+			conf['QLEN_MON_FILE'] = prefix + "_qlen.txt"
+			config_name = prefix + "_config.txt"
+			write_config(config_name, keys, conf)
+
+			with open(prefix + "_out.txt", "w") as out:
+				if args.bin:
+					ret = subprocess.call([args.bin, config_name], stdout=out, stderr=subprocess.STDOUT)
+				else:
+					ret = subprocess.call("./waf --run 'scratch/third %s'"%config_name, shell=True, stdout=out, stderr=subprocess.STDOUT)
+			if ret != 0:
+				print("%s failed, see %s_out.txt"%(config_name, prefix))
+				sys.exit(1)
+
+			n, avg, p99, slowdown, goodput = fct_stats(conf['FCT_OUTPUT_FILE'])
+			print("%-10s %-4s %4d/%-4d %12.1f %12.1f %9.2f %12.2f"%(loss, mode, n, n_flow, avg / 1000., p99 / 1000., slowdown, goodput))
+			sys.stdout.flush()
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
+#include <algorithm>
 #include <time.h> 
 #include "ns3/core-module.h"
 #include "ns3/qbb-helper.h"
@@ -37,7 +38,15 @@
 #include <ns3/switch-node.h>
 #include <ns3/sim-setting.h>
 #include <ns3/enquserver-node.h>
+#include <ns3/event-log.h>
+#include <ns3/trace-writer.h>
+#include <ns3/mtp-interface.h>
+#include <ns3/pod-partition-helper.h>
+#include <ns3/pfc-deadlock-detector.h>
 #include <unistd.h> 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace ns3;
 using namespace std;
@@ -48,6 +57,8 @@ uint32_t cc_mode = 1;
 bool enable_qcn = true, use_dynamic_pfc_threshold = true;
 uint32_t packet_payload_size = 1000, l2_chunk_size = 0, l2_ack_interval = 0;
 double pause_time = 5, simulator_stop_time = 3.01;
+uint32_t enable_pfc = 1;
+uint32_t pfc_deadlock = 0; // PfcDeadlockDetector::Mode
 std::string data_rate, link_delay, topology_file, flow_file, trace_file, trace_output_file;
 std::string fct_output_file = "fct.txt";
 std::string pfc_output_file = "pfc.txt";
@@ -58,8 +69,10 @@ uint32_t fast_recovery_times = 5;
 std::string rate_ai, rate_hai, min_rate = "100Mb/s";
 std::string dctcp_rate_ai = "1000Mb/s";
 
-bool clamp_target_rate = false, l2_back_to_zero = false;
+bool clamp_target_rate = false, l2_back_to_zero = false, l2_selective_repeat = false;
 double error_rate_per_link = 0.0;
+uint32_t l2_ack_coalesce_bytes = 0;
+double l2_ack_coalesce_time = 1.0;
 uint32_t has_win = 1;
 uint32_t global_t = 1;
 uint32_t mi_thresh = 5;
@@ -71,12 +84,29 @@ double pint_prob = 1.0;
 double u_target = 0.95;
 uint32_t int_multi = 1;
 bool rate_bound = true;
+uint32_t qp_scheduler = 0;
+std::string event_log_file;
+uint32_t event_log_level = 0;
+std::string scheduler_type = "ns3::MapScheduler";
+uint32_t threads = 0; // 0: sequential simulator
+uint32_t parallel_order = 0;
+bool mt_order = false; // the events and losses of a multithreaded run, THREADS 0 gives the same result
 
 uint32_t ack_high_prio = 0;
 uint64_t link_down_time = 0;
 uint32_t link_down_A = 0, link_down_B = 0;
 
+uint32_t ecmp_mode = 0; // 0: one next hop, 1: ECMP, 2: WCMP weighted by the bottleneck bandwidth
+uint32_t enc_steering = 1; // switches with the ENC node among their next hops only use it
+double enc_notify_window = -1; // in maxRtt, 0: the ENC node notifies the senders sharing a link on every ACK, < 0: not set
+double enc_table_timeout = 0; // in maxRtt, 0: a flow leaves the shared table of the ENC node on its FIN only
+bool enc_path_hash = false; // the switches hash the path into the INT, the ENC node learns it from a probe per flow
+uint64_t flowlet_gap = 0; // ns, 0: no flowlet switching
+uint32_t flowlet_table_size = 4096;
+uint32_t flowlet_feedback = 0;
+
 uint32_t enable_trace = 1;
+uint32_t trace_compress = 1;
 
 uint32_t buffer_size = 16;
 
@@ -107,9 +137,17 @@ struct Interface{
 	Interface() : idx(0), up(false){}
 };
 map<Ptr<Node>, map<Ptr<Node>, Interface> > nbr2if;
-// Mapping destination to next hop for each node: <node, <dest, <nexthop0, ...> > >
-map<Ptr<Node>, map<Ptr<Node>, vector<Ptr<Node> > > > nextHop;
-map<Ptr<Node>, map<Ptr<Node>, Ptr<Node> > > nextHopenc;//每个switch节点到目的地址的下一跳的节点<node, <dest, nexthop > >
+// The links of each node by node id, in the order of nbr2if, built by CalculateRoutes
+struct Adjacency{
+	uint32_t nbr;
+	Interface *intf;
+};
+vector<vector<Adjacency> > adj;
+// The routing destinations (hosts) by node id; the tables below are indexed by their position here
+vector<uint32_t> routeDst;
+// Mapping destination to next hop for each node: nextHop[node][dst] = <nexthop0, ...>
+vector<vector<vector<uint32_t> > > nextHop;
+vector<vector<vector<uint32_t> > > nextHopenc;//每个节点到目的地址的下一跳的节点 nextHopenc[node][dst] = <nexthop0, ...> in the node's table, a next hop repeated by its WCMP weight, empty if none
 map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairDelay;
 map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairTxDelay;
 map<uint32_t, map<uint32_t, uint64_t> > pairBw;
@@ -118,41 +156,106 @@ map<uint32_t, map<uint32_t, uint64_t> > pairRtt;
 
 std::vector<Ipv4Address> serverAddress;
 
-// maintain port number for each host pair
-std::unordered_map<uint32_t, unordered_map<uint32_t, uint16_t> > portNumder;
+// maintain port number for each host pair (src << 32 | dst) of the text flow file, from 10000
+std::unordered_map<uint64_t, uint16_t> portNumder;
 
-struct FlowInput{
-	uint32_t src, dst, pg, maxPacketCount, port, dport;
-	double start_time;
-	uint32_t idx;
+/*
+ * Binary flow file, made from the text one by traffic_gen/flow_to_bin.py: a FlowFileHeader, then
+ * n_flow FlowRecords sorted by start time. It is mapped, the records are read in place.
+ */
+struct FlowFileHeader{
+	char magic[8]; // "HPCCFLOW"
+	uint64_t n_flow;
 };
-FlowInput flow_input = {0};
-uint32_t flow_num;
+struct FlowRecord{
+	uint64_t start; // ns
+	uint64_t size; // bytes
+	uint32_t src, dst;
+	uint16_t pg, sport, dport, reserved;
+};
+static_assert(sizeof(FlowFileHeader) == 16 && sizeof(FlowRecord) == 32, "the layout of flow_to_bin.py");
+
+const FlowRecord *flow_map = NULL; // the records of the binary flow file, NULL if it is text
+size_t flow_map_len = 0;
+FlowRecord flow_input; // the next flow to start
+uint32_t flow_idx = 0, flow_num;
+vector<uint8_t> flow_done; // by flow id, set by the completion callback of the qp
+
+// open flow_file, return the number of flows
+uint32_t OpenFlowInput(){
+	int fd = open(flow_file.c_str(), O_RDONLY);
+	struct stat st;
+	FlowFileHeader h;
+	if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(h) && pread(fd, &h, sizeof(h), 0) == sizeof(h)
+			&& memcmp(h.magic, "HPCCFLOW", sizeof(h.magic)) == 0){
+		NS_ABORT_MSG_IF((uint64_t)st.st_size != sizeof(h) + h.n_flow * sizeof(FlowRecord), "truncated flow file " << flow_file);
+		flow_map_len = st.st_size;
+		void *p = mmap(NULL, flow_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+		NS_ABORT_MSG_IF(p == MAP_FAILED, "cannot map " << flow_file);
+		madvise(p, flow_map_len, MADV_SEQUENTIAL);
+		close(fd);
+		flow_map = (const FlowRecord*)((const char*)p + sizeof(h));
+		return h.n_flow;
+	}
+	if (fd >= 0)
+		close(fd);
+	uint32_t num;
+	flowf.open(flow_file.c_str());
+	flowf >> num;
+	return num;
+}
 
 void ReadFlowInput(){
-	if (flow_input.idx < flow_num){
-		flowf >> flow_input.src >> flow_input.dst >> flow_input.pg >> flow_input.dport >> flow_input.maxPacketCount >> flow_input.start_time;
-		NS_ASSERT(n.Get(flow_input.src)->GetNodeType() == 0 && n.Get(flow_input.dst)->GetNodeType() == 0);
+	if (flow_idx >= flow_num)
+		return;
+	if (flow_map != NULL){
+		uint64_t last = flow_input.start;
+		flow_input = flow_map[flow_idx];
+		NS_ABORT_MSG_IF(flow_idx > 0 && flow_input.start < last, "flow " << flow_idx << " of " << flow_file << " is out of order");
+	}else{
+		uint32_t pg, dport, size;
+		double start_time;
+		flowf >> flow_input.src >> flow_input.dst >> pg >> dport >> size >> start_time;
+		flow_input.pg = pg;
+		flow_input.dport = dport;
+		flow_input.size = size;
+		flow_input.start = Seconds(start_time).GetTimeStep();
+		flow_input.sport = portNumder.emplace(((uint64_t)flow_input.src << 32) | flow_input.dst, 10000).first->second++; // get a new port number
 	}
+	NS_ABORT_MSG_IF(flow_input.pg >= QbbNetDevice::qCnt, "flow " << flow_idx << " of " << flow_file << " has priority group " << flow_input.pg << ", there are " << QbbNetDevice::qCnt);
+	NS_ASSERT(n.Get(flow_input.src)->GetNodeType() == 0 && n.Get(flow_input.dst)->GetNodeType() == 0);
+}
+
+void flow_finish(uint32_t id){
+	flow_done[id] = 1; // one byte per flow, the threads never write the same one
 }
+
+// runs in the context of the source host
+void start_flow(uint32_t id, FlowRecord f){
+	Ptr<RdmaDriver> rdma = n.Get(f.src)->GetObject<RdmaDriver>();
+	uint32_t win = has_win ? (global_t == 1 ? maxBdp : pairBdp[n.Get(f.src)][n.Get(f.dst)]) : 0;
+	uint64_t baseRtt = global_t == 1 ? maxRtt : pairRtt[f.src][f.dst];
+	rdma->AddQueuePair(f.size, f.pg, serverAddress[f.src], serverAddress[f.dst], f.sport, f.dport, win, baseRtt, MakeBoundCallback(&flow_finish, id));
+}
+
+// one event per distinct start time, it hands each flow starting now to its source host
 void ScheduleFlowInputs(){
-	while (flow_input.idx < flow_num && Seconds(flow_input.start_time) == Simulator::Now()){
-		uint32_t port = portNumder[flow_input.src][flow_input.dst]++; // get a new port number 
-		RdmaClientHelper clientHelper(flow_input.pg, serverAddress[flow_input.src], serverAddress[flow_input.dst], port, flow_input.dport, flow_input.maxPacketCount, has_win?(global_t==1?maxBdp:pairBdp[n.Get(flow_input.src)][n.Get(flow_input.dst)]):0, global_t==1?maxRtt:pairRtt[flow_input.src][flow_input.dst]);
-		ApplicationContainer appCon = clientHelper.Install(n.Get(flow_input.src));
-		appCon.Start(Time(0));
+	while (flow_idx < flow_num && flow_input.start == (uint64_t)Simulator::Now().GetTimeStep()){
+		Simulator::ScheduleWithContext(flow_input.src, Time(0), &start_flow, flow_idx, flow_input);
 
 		// get the next flow input
-		flow_input.idx++;
+		flow_idx++;
 		ReadFlowInput();
 	}
 
 	// schedule the next time to run this function
-	if (flow_input.idx < flow_num){
-		Simulator::Schedule(Seconds(flow_input.start_time)-Simulator::Now(), ScheduleFlowInputs);
-	}else { // no more flows, close the file
+	if (flow_idx < flow_num){
+		Simulator::Schedule(TimeStep(flow_input.start) - Simulator::Now(), ScheduleFlowInputs);
+	}else if (flow_map != NULL){ // no more flows, release the file
+		munmap((void*)((const char*)flow_map - sizeof(FlowFileHeader)), flow_map_len);
+		flow_map = NULL;
+	}else
 		flowf.close();
-	}
 }
 
 Ipv4Address node_id_to_ip(uint32_t id){
@@ -163,74 +266,76 @@ uint32_t ip_to_node_id(Ipv4Address ip){
 	return (ip.Get() >> 8) & 0xffff;
 }
 
+void delete_rx_qp(uint32_t did, uint32_t sip, uint16_t pg, uint16_t sport){
+	Ptr<RdmaDriver> rdma = n.Get(did)->GetObject<RdmaDriver> ();
+	rdma->m_rdma->DeleteRxQp(sip, pg, sport);
+}
+
 void qp_finish(FILE* fout, Ptr<RdmaQueuePair> q){
 	uint32_t sid = ip_to_node_id(q->sip), did = ip_to_node_id(q->dip);
 	uint64_t base_rtt = pairRtt[sid][did], b = pairBw[sid][did];
 	uint32_t total_bytes = q->m_size + ((q->m_size-1) / packet_payload_size + 1) * (CustomHeader::GetStaticWholeHeaderSize() - IntHeader::GetStaticSize()); // translate to the minimum bytes required (with header but no INT)
 	uint64_t standalone_fct = base_rtt + total_bytes * 8000000000lu / b;
 	// sip, dip, sport, dport, size (B), start_time, fct (ns), standalone_fct (ns)
-	fprintf(fout, "%08x %08x %u %u %lu %lu %lu %lu\n", q->sip.Get(), q->dip.Get(), q->sport, q->dport, q->m_size, q->startTime.GetTimeStep(), (Simulator::Now() - q->startTime).GetTimeStep(), standalone_fct);
+	char line[128];
+	int len = snprintf(line, sizeof(line), "%08x %08x %u %u %lu %lu %lu %lu\n", q->sip.Get(), q->dip.Get(), q->sport, q->dport, q->m_size, q->startTime.GetTimeStep(), (Simulator::Now() - q->startTime).GetTimeStep(), standalone_fct);
+	MtpInterface::Write(fout, line, len);
 	fflush(fout);
 
 	// remove rxQp from the receiver
-	Ptr<Node> dstNode = n.Get(did);
-	Ptr<RdmaDriver> rdma = dstNode->GetObject<RdmaDriver> ();
-	rdma->m_rdma->DeleteRxQp(q->sip.Get(), q->m_pg, q->sport);
+	if (mt_order){
+		// the receiver may run on another thread, it learns about the completion one path delay later
+		Simulator::ScheduleWithContext(did, TimeStep(pairDelay[n.Get(sid)][n.Get(did)]), &delete_rx_qp, did, q->sip.Get(), q->m_pg, q->sport);
+	}else
+		delete_rx_qp(did, q->sip.Get(), q->m_pg, q->sport);
 }
 
 void get_pfc(FILE* fout, Ptr<QbbNetDevice> dev, uint32_t type){
-	fprintf(fout, "%lu %u %u %u %u\n", Simulator::Now().GetTimeStep(), dev->GetNode()->GetId(), dev->GetNode()->GetNodeType(), dev->GetIfIndex(), type);
+	char line[64];
+	int len = snprintf(line, sizeof(line), "%lu %u %u %u %u\n", Simulator::Now().GetTimeStep(), dev->GetNode()->GetId(), dev->GetNode()->GetNodeType(), dev->GetIfIndex(), type);
+	MtpInterface::Write(fout, line, len);
 }
 
-struct QlenDistribution{
-	vector<uint32_t> cnt; // cnt[i] is the number of times that the queue len is i KB
-
-	void add(uint32_t qlen){
-		uint32_t kb = qlen / 1000;
-		if (cnt.size() < kb+1)
-			cnt.resize(kb+1);
-		cnt[kb]++;
-	}
-};
-map<uint32_t, map<uint32_t, QlenDistribution> > queue_result;
-void monitor_buffer(FILE* qlen_output, NodeContainer *n){
-	for (uint32_t i = 0; i < n->GetN(); i++){
-		if (n->Get(i)->GetNodeType() == 1){ // is switch
+// the queue lengths of the switch ports, sampled every qlen_mon_interval from qlen_mon_start to
+// qlen_mon_end, are counted by the switches as they change (SwitchMmu::ConfigQlenMon);
+// the histograms are dumped at the samples on multiples of qlen_dump_interval
+uint64_t get_qlen_mon_last(){
+	uint64_t n = qlen_mon_end > qlen_mon_start ? (qlen_mon_end - qlen_mon_start + qlen_mon_interval - 1) / qlen_mon_interval : 0;
+	return qlen_mon_start + n * qlen_mon_interval;
+}
+void dump_qlen(FILE* qlen_output, NodeContainer *n){
+	uint64_t now = Simulator::Now().GetTimeStep();
+	if ((now - qlen_mon_start) % qlen_mon_interval == 0){
+		fprintf(qlen_output, "time: %lu\n", now);
+		for (uint32_t i = 0; i < n->GetN(); i++){
+			if (n->Get(i)->GetNodeType() != 1) // not switch
+				continue;
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(n->Get(i));
-			if (queue_result.find(i) == queue_result.end())
-				queue_result[i];
 			for (uint32_t j = 1; j < sw->GetNDevices(); j++){
-				uint32_t size = 0;
-				for (uint32_t k = 0; k < SwitchMmu::qCnt; k++)
-					size += sw->m_mmu->egress_bytes[j][k];
-				queue_result[i][j].add(size);
-			}
-		}
-	}
-	if (Simulator::Now().GetTimeStep() % qlen_dump_interval == 0){
-		fprintf(qlen_output, "time: %lu\n", Simulator::Now().GetTimeStep());
-		for (auto &it0 : queue_result)
-			for (auto &it1 : it0.second){
-				fprintf(qlen_output, "%u %u", it0.first, it1.first);
-				auto &dist = it1.second.cnt;
-				for (uint32_t i = 0; i < dist.size(); i++)
-					fprintf(qlen_output, " %u", dist[i]);
+				fprintf(qlen_output, "%u %u", i, j);
+				const vector<uint32_t> &dist = sw->m_mmu->GetQlenDistribution(j);
+				for (uint32_t k = 0; k < dist.size(); k++)
+					fprintf(qlen_output, " %u", dist[k]);
 				fprintf(qlen_output, "\n");
 			}
+		}
 		fflush(qlen_output);
 	}
-	if (Simulator::Now().GetTimeStep() < qlen_mon_end)
-		Simulator::Schedule(NanoSeconds(qlen_mon_interval), &monitor_buffer, qlen_output, n);
+	if (now + qlen_dump_interval <= get_qlen_mon_last())
+		Simulator::Schedule(NanoSeconds(qlen_dump_interval), &dump_qlen, qlen_output, n);
 }
 
-void CalculateRoute(Ptr<Node> host){
+// the shortest paths of all nodes towards routeDst[dst]
+void CalculateRoute(uint32_t dst){
+	uint32_t host = routeDst[dst];
+	uint32_t node_num = adj.size();
 	// queue for the BFS.
-	vector<Ptr<Node> > q;
-	// Distance from the host to each node.
-	map<Ptr<Node>, int> dis;
-	map<Ptr<Node>, uint64_t> delay;
-	map<Ptr<Node>, uint64_t> txDelay;
-	map<Ptr<Node>, uint64_t> bw;
+	vector<uint32_t> q;
+	// Distance from the host to each node, -1 if not reached.
+	vector<int> dis(node_num, -1);
+	vector<uint64_t> delay(node_num), txDelay(node_num), bw(node_num);
+	for (uint32_t i = 0; i < node_num; i++)
+		nextHop[i][dst].clear();
 	// init BFS.
 	q.push_back(host);
 	dis[host] = 0;
@@ -239,43 +344,56 @@ void CalculateRoute(Ptr<Node> host){
 	bw[host] = 0xfffffffffffffffflu;
 	// BFS.
 	for (int i = 0; i < (int)q.size(); i++){
-		Ptr<Node> now = q[i];
+		uint32_t now = q[i];
 		int d = dis[now];
-		for (auto it = nbr2if[now].begin(); it != nbr2if[now].end(); it++){
+		for (auto &it : adj[now]){
 			// skip down link
-			if (!it->second.up)
+			if (!it.intf->up)
 				continue;
-			Ptr<Node> next = it->first;
+			uint32_t next = it.nbr;
 			// If 'next' have not been visited.
-			if (dis.find(next) == dis.end()){
+			if (dis[next] < 0){
 				dis[next] = d + 1;
-				delay[next] = delay[now] + it->second.delay;
-				txDelay[next] = txDelay[now] + packet_payload_size * 1000000000lu * 8 / it->second.bw;
-				bw[next] = std::min(bw[now], it->second.bw);
+				delay[next] = delay[now] + it.intf->delay;
+				txDelay[next] = txDelay[now] + packet_payload_size * 1000000000lu * 8 / it.intf->bw;
+				bw[next] = std::min(bw[now], it.intf->bw);
 				// we only enqueue switch, because we do not want packets to go through host as middle point
-				if (next->GetNodeType() == 1 || next->GetNodeType()==2)
+				if (n.Get(next)->GetNodeType() == 1 || n.Get(next)->GetNodeType()==2)
 					q.push_back(next);
 			}
 			// if 'now' is on the shortest path from 'next' to 'host'.
 			if (d + 1 == dis[next]){
-				nextHop[next][host].push_back(now);
+				nextHop[next][dst].push_back(now);
 			}
 		}
 	}
-	for (auto it : delay)
-		pairDelay[it.first][host] = it.second;
-	for (auto it : txDelay)
-		pairTxDelay[it.first][host] = it.second;
-	for (auto it : bw)
-		pairBw[it.first->GetId()][host->GetId()] = it.second;
+	Ptr<Node> h = n.Get(host);
+	for (uint32_t i = 0; i < node_num; i++){
+		if (dis[i] < 0)
+			continue;
+		pairDelay[n.Get(i)][h] = delay[i];
+		pairTxDelay[n.Get(i)][h] = txDelay[i];
+		pairBw[i][host] = bw[i];
+	}
 }
 
 void CalculateRoutes(NodeContainer &n){
-	for (int i = 0; i < (int)n.GetN(); i++){
+	uint32_t node_num = n.GetN();
+	adj.assign(node_num, vector<Adjacency>());
+	routeDst.clear();
+	for (uint32_t i = 0; i < node_num; i++){
 		Ptr<Node> node = n.Get(i);
+		for (auto &it : nbr2if[node]){
+			Adjacency a = {it.first->GetId(), &it.second};
+			adj[i].push_back(a);
+		}
 		if (node->GetNodeType() == 0)
-			CalculateRoute(node);
+			routeDst.push_back(i);
 	}
+	nextHop.assign(node_num, vector<vector<uint32_t> >(routeDst.size()));
+	nextHopenc.assign(node_num, vector<vector<uint32_t> >(routeDst.size()));
+	for (uint32_t i = 0; i < routeDst.size(); i++)
+		CalculateRoute(i);
 }
 
 // void SetRoutingEntries(){
@@ -303,128 +421,130 @@ void CalculateRoutes(NodeContainer &n){
 // 	}
 // }
 
-void FormatRoutingEntries(){
-	for (auto i = nextHop.begin(); i != nextHop.end(); i++){
-		Ptr<Node> node = i->first;
-		auto &table = i->second;
-		if (node->GetNodeType()==1){
-			for (auto j = table.begin(); j != table.end(); j++){
-				Ptr<Node> dst = j->first;
-				vector<Ptr<Node> > nexts = j->second;
-				int idx = -1;
-				bool flag = false;
-				for (int k = 0; k < (int)nexts.size(); k++){
-					Ptr<Node> next = nexts[k];
-					if (next->GetNodeType() == 2)
-					{
-						idx = k;
-						flag = true;
-					}
-				}
-				if (flag)
-				{
-					nextHopenc[node][dst] = nexts[idx];
-				}else{
-					nextHopenc[node][dst] = nexts.front();
-				}
-				std::cout << node->GetId() << "->" << dst->GetId() << ": " << nextHopenc[node][dst]->GetId() << endl;
-			}
-		}else if (node->GetNodeType()==0)
-		{
-			for (auto j = table.begin(); j != table.end(); j++){
-				Ptr<Node> dst = j->first;
-				vector<Ptr<Node> > nexts = j->second;
-				int idx = -1;
-				bool flag = false;
-				for (int k = 0; k < (int)nexts.size(); k++){
-					Ptr<Node> next = nexts[k];
-					if (next->GetNodeType() == 2)
-					{
-						idx = k;
-						flag = true;
-					}
-				}
-				if (flag && idx == 0)
-				{
-					nextHopenc[node][dst] = nexts[1];
-
-				}else if (flag && idx == nexts.size()-1)
-				{
-					nextHopenc[node][dst] = nexts[nexts.size()-2];
-
-				}else if (flag && 0<idx<nexts.size()-1)
-				{
-					nextHopenc[node][dst] = nexts.front();
+// the next hops of node in its table, among its next hops towards routeDst[dst]
+// hosts and ENC nodes take one, and hosts avoid the ENC node; switches with the ENC node among
+// their next hops go through it under ENC_STEERING, the others take one under ECMP_MODE 0 and all of
+// them otherwise, each as many times as its share of the bandwidth under ECMP_MODE 2
+vector<uint32_t> ChooseNextHops(uint32_t node, uint32_t dst){
+	const vector<uint32_t> &nexts = nextHop[node][dst];
+	if (nexts.empty())
+		return vector<uint32_t>();
+	int idx = -1;
+	for (int k = 0; k < (int)nexts.size(); k++){
+		if (n.Get(nexts[k])->GetNodeType() == 2)
+			idx = k;
+	}
+	uint32_t type = n.Get(node)->GetNodeType();
+	if (type == 1 && idx >= 0 && enc_steering)
+		return vector<uint32_t>(1, nexts[idx]);
+	if (type == 0 && idx == 0 && nexts.size() > 1)
+		return vector<uint32_t>(1, nexts[1]);
+	if (type == 0 && idx == (int)nexts.size() - 1 && nexts.size() > 1)
+		return vector<uint32_t>(1, nexts[nexts.size() - 2]);
+	if (type != 1 || ecmp_mode == 0 || nexts.size() == 1)
+		return vector<uint32_t>(1, nexts.front());
+	if (ecmp_mode == 1)
+		return nexts;
+
+	// WCMP: the bottleneck bandwidth through each next hop, in units of their gcd
+	vector<uint64_t> bw(nexts.size());
+	uint64_t unit = 0;
+	for (uint32_t k = 0; k < nexts.size(); k++){
+		bw[k] = pairBw[nexts[k]][routeDst[dst]];
+		for (auto &it : adj[node]){
+			if (it.nbr == nexts[k])
+				bw[k] = std::min(bw[k], it.intf->bw);
+		}
+		for (uint64_t a = bw[k]; a > 0; ){ // unit = gcd(unit, bw[k])
+			uint64_t t = unit % a;
+			unit = a;
+			a = t;
+		}
+	}
+	vector<uint32_t> chosen;
+	for (uint32_t k = 0; k < nexts.size(); k++)
+		chosen.insert(chosen.end(), bw[k] / unit, nexts[k]);
+	return chosen;
+}
 
-				}else{
-					nextHopenc[node][dst] = nexts.front();
-				}
-				std::cout << node->GetId() << "->" << dst->GetId() << ": " << nextHopenc[node][dst]->GetId() << endl;				
-			}
-		}else{
-			for (auto j = table.begin(); j != table.end(); j++){
-				Ptr<Node> dst = j->first;
-				vector<Ptr<Node> > nexts = j->second;
-				nextHopenc[node][dst] = nexts.front();
-				std::cout << node->GetId() << "->" << dst->GetId() << ": " << nextHopenc[node][dst]->GetId() << endl;
-			}
+// install nextHopenc[node][dst] in the node's routing table, no next hop removes the entry
+void SetRoutingEntry(uint32_t node, uint32_t dst){
+	Ptr<Node> nd = n.Get(node);
+	const vector<uint32_t> &nexts = nextHopenc[node][dst];
+	std::cout << node << "->" << routeDst[dst] << ":";
+	for (uint32_t k = 0; k < nexts.size(); k++)
+		std::cout << ' ' << nexts[k];
+	std::cout << '\n';
+	// The IP address of the dst.
+	Ipv4Address dstAddr = n.Get(routeDst[dst])->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+	vector<uint32_t> interface(nexts.size(), 0);
+	for (uint32_t k = 0; k < nexts.size(); k++){
+		for (auto &it : adj[node]){
+			if (it.nbr == nexts[k])
+				interface[k] = it.intf->idx;
 		}
 	}
+	if (nd->GetNodeType() == 1){
+		Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(nd);
+		sw->ClearTableEntry(dstAddr);
+		for (uint32_t k = 0; k < interface.size(); k++)
+			sw->AddTableEntry(dstAddr, interface[k]);
+	}else if(nd->GetNodeType() == 0){
+		Ptr<RdmaHw> rdma = nd->GetObject<RdmaDriver>()->m_rdma;
+		if (interface.empty())
+			rdma->ClearTableEntry(dstAddr);
+		else
+			rdma->AddTableEntry(dstAddr, interface[0]);
+	}else{
+		Ptr<EnquserverNode> eqs = DynamicCast<EnquserverNode>(nd);
+		if (interface.empty())
+			eqs->ClearTableEntry(dstAddr);
+		else
+			eqs->AddTableEntry(dstAddr, interface[0]);
+	}
 }
 
 void SetRoutingEntriesEnc(){
-	FormatRoutingEntries();
 	// For each node.
-	for (auto i = nextHopenc.begin(); i != nextHopenc.end(); i++){
-		Ptr<Node> node = i->first;
-		auto &table = i->second;
-		for (auto j = table.begin(); j != table.end(); j++){
-			// The destination node.
-			Ptr<Node> dst = j->first;
-			// The IP address of the dst.
-			Ipv4Address dstAddr = dst->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
-			// The next hops towards the dst.
-			Ptr<Node> next = j->second;
-			uint32_t interface = nbr2if[node][next].idx;
-			if (node->GetNodeType() == 1){
-				DynamicCast<SwitchNode>(node)->AddTableEntry(dstAddr, interface);
-			}else if(node->GetNodeType() == 0){
-				node->GetObject<RdmaDriver>()->m_rdma->AddTableEntry(dstAddr, interface);
-			}else{
-				DynamicCast<EnquserverNode>(node)->AddTableEntry(dstAddr, interface);
-			}
+	for (uint32_t i = 0; i < nextHop.size(); i++){
+		for (uint32_t j = 0; j < routeDst.size(); j++){
+			nextHopenc[i][j] = ChooseNextHops(i, j);
+			if (!nextHopenc[i][j].empty())
+				SetRoutingEntry(i, j);
 		}
 	}
 }
 
-
-
-
-
-
 // take down the link between a and b, and redo the routing
+// only the destinations that had a shortest path through the link are recalculated, and only the entries that change are installed
 void TakeDownLink(NodeContainer n, Ptr<Node> a, Ptr<Node> b){
 	if (!nbr2if[a][b].up)
 		return;
 	// take down link between a and b
 	nbr2if[a][b].up = nbr2if[b][a].up = false;
-	nextHop.clear();
-	CalculateRoutes(n);
-	// clear routing tables
-	for (uint32_t i = 0; i < n.GetN(); i++){
-		if (n.Get(i)->GetNodeType() == 1)
-			DynamicCast<SwitchNode>(n.Get(i))->ClearTable();
-		else
-			n.Get(i)->GetObject<RdmaDriver>()->m_rdma->ClearTable();
-	}
 	DynamicCast<QbbNetDevice>(a->GetDevice(nbr2if[a][b].idx))->TakeDown();
 	DynamicCast<QbbNetDevice>(b->GetDevice(nbr2if[b][a].idx))->TakeDown();
-	// reset routing table
-	// SetRoutingEntries();
-	SetRoutingEntriesEnc();
-	// redistribute qp on each host
+	uint32_t ia = a->GetId(), ib = b->GetId();
+	vector<bool> redistribute(n.GetN(), false);
+	for (uint32_t dst = 0; dst < routeDst.size(); dst++){
+		vector<uint32_t> &na = nextHop[ia][dst], &nb = nextHop[ib][dst];
+		if (std::find(na.begin(), na.end(), ib) == na.end() && std::find(nb.begin(), nb.end(), ia) == nb.end())
+			continue;
+		CalculateRoute(dst);
+		for (uint32_t i = 0; i < n.GetN(); i++){
+			vector<uint32_t> next = ChooseNextHops(i, dst);
+			// an unreachable destination loses its entry
+			if (next == nextHopenc[i][dst])
+				continue;
+			nextHopenc[i][dst] = next;
+			SetRoutingEntry(i, dst);
+			if (n.Get(i)->GetNodeType() == 0)
+				redistribute[i] = true;
+		}
+	}
+	// redistribute qp on the hosts whose routes changed
 	for (uint32_t i = 0; i < n.GetN(); i++){
-		if (n.Get(i)->GetNodeType() == 0)
+		if (redistribute[i])
 			n.Get(i)->GetObject<RdmaDriver>()->m_rdma->RedistributeQp();
 	}
 }
@@ -505,6 +625,16 @@ int main(int argc, char *argv[])
 				pause_time = v;
 				std::cout << "PAUSE_TIME\t\t\t" << pause_time << "\n";
 			}
+			else if (key.compare("ENABLE_PFC") == 0)
+			{
+				conf >> enable_pfc;
+				std::cout << "ENABLE_PFC\t\t\t" << enable_pfc << "\n";
+			}
+			else if (key.compare("PFC_DEADLOCK") == 0)
+			{
+				conf >> pfc_deadlock;
+				std::cout << "PFC_DEADLOCK\t\t\t" << pfc_deadlock << "\n";
+			}
 			else if (key.compare("DATA_RATE") == 0)
 			{
 				std::string v;
@@ -550,6 +680,30 @@ int main(int argc, char *argv[])
 				else
 					std::cout << "L2_BACK_TO_ZERO\t\t\t" << "No" << "\n";
 			}
+			else if (key.compare("L2_SELECTIVE_REPEAT") == 0)
+			{
+				uint32_t v;
+				conf >> v;
+				l2_selective_repeat = v;
+				if (l2_selective_repeat)
+					std::cout << "L2_SELECTIVE_REPEAT\t\t" << "Yes" << "\n";
+				else
+					std::cout << "L2_SELECTIVE_REPEAT\t\t" << "No" << "\n";
+			}
+			else if (key.compare("L2_ACK_COALESCE_BYTES") == 0)
+			{
+				uint32_t v;
+				conf >> v;
+				l2_ack_coalesce_bytes = v;
+				std::cout << "L2_ACK_COALESCE_BYTES\t\t" << l2_ack_coalesce_bytes << "\n";
+			}
+			else if (key.compare("L2_ACK_COALESCE_TIME") == 0)
+			{
+				double v;
+				conf >> v;
+				l2_ack_coalesce_time = v;
+				std::cout << "L2_ACK_COALESCE_TIME\t\t" << l2_ack_coalesce_time << "\n";
+			}
 			else if (key.compare("TOPOLOGY_FILE") == 0)
 			{
 				std::string v;
@@ -682,6 +836,24 @@ int main(int argc, char *argv[])
 				conf >> v;
 				rate_bound = v;
 				std::cout << "RATE_BOUND\t\t" << rate_bound << '\n';
+			}else if (key.compare("QP_SCHEDULER") == 0){
+				conf >> qp_scheduler;
+				std::cout << "QP_SCHEDULER\t\t" << qp_scheduler << '\n';
+			}else if (key.compare("EVENT_LOG_FILE") == 0){
+				conf >> event_log_file;
+				std::cout << "EVENT_LOG_FILE\t\t" << event_log_file << '\n';
+			}else if (key.compare("EVENT_LOG_LEVEL") == 0){
+				conf >> event_log_level;
+				std::cout << "EVENT_LOG_LEVEL\t\t" << event_log_level << '\n';
+			}else if (key.compare("SCHEDULER") == 0){
+				conf >> scheduler_type;
+				std::cout << "SCHEDULER\t\t" << scheduler_type << '\n';
+			}else if (key.compare("THREADS") == 0){
+				conf >> threads;
+				std::cout << "THREADS\t\t" << threads << '\n';
+			}else if (key.compare("PARALLEL_ORDER") == 0){
+				conf >> parallel_order;
+				std::cout << "PARALLEL_ORDER\t\t" << parallel_order << '\n';
 			}else if (key.compare("ACK_HIGH_PRIO") == 0){
 				conf >> ack_high_prio;
 				std::cout << "ACK_HIGH_PRIO\t\t" << ack_high_prio << '\n';
@@ -694,9 +866,36 @@ int main(int argc, char *argv[])
 			}else if (key.compare("LINK_DOWN") == 0){
 				conf >> link_down_time >> link_down_A >> link_down_B;
 				std::cout << "LINK_DOWN\t\t\t\t" << link_down_time << ' '<< link_down_A << ' ' << link_down_B << '\n';
+			}else if (key.compare("ECMP_MODE") == 0){
+				conf >> ecmp_mode;
+				std::cout << "ECMP_MODE\t\t\t\t" << ecmp_mode << '\n';
+			}else if (key.compare("ENC_STEERING") == 0){
+				conf >> enc_steering;
+				std::cout << "ENC_STEERING\t\t\t\t" << enc_steering << '\n';
+			}else if (key.compare("ENC_NOTIFY_WINDOW") == 0){
+				conf >> enc_notify_window;
+				std::cout << "ENC_NOTIFY_WINDOW\t\t\t" << enc_notify_window << '\n';
+			}else if (key.compare("ENC_TABLE_TIMEOUT") == 0){
+				conf >> enc_table_timeout;
+				std::cout << "ENC_TABLE_TIMEOUT\t\t\t" << enc_table_timeout << '\n';
+			}else if (key.compare("ENC_PATH_HASH") == 0){
+				conf >> enc_path_hash;
+				std::cout << "ENC_PATH_HASH\t\t\t\t" << enc_path_hash << '\n';
+			}else if (key.compare("FLOWLET_GAP") == 0){
+				conf >> flowlet_gap;
+				std::cout << "FLOWLET_GAP\t\t\t\t" << flowlet_gap << '\n';
+			}else if (key.compare("FLOWLET_TABLE_SIZE") == 0){
+				conf >> flowlet_table_size;
+				std::cout << "FLOWLET_TABLE_SIZE\t\t\t" << flowlet_table_size << '\n';
+			}else if (key.compare("FLOWLET_FEEDBACK") == 0){
+				conf >> flowlet_feedback;
+				std::cout << "FLOWLET_FEEDBACK\t\t\t" << flowlet_feedback << '\n';
 			}else if (key.compare("ENABLE_TRACE") == 0){
 				conf >> enable_trace;
 				std::cout << "ENABLE_TRACE\t\t\t\t" << enable_trace << '\n';
+			}else if (key.compare("TRACE_COMPRESS") == 0){
+				conf >> trace_compress;
+				std::cout << "TRACE_COMPRESS\t\t\t\t" << trace_compress << '\n';
 			}else if (key.compare("KMAX_MAP") == 0){
 				int n_k ;
 				conf >> n_k;
@@ -773,12 +972,39 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	// with path hashes, every ACK reporting a queue would notify all the flows of the link
+	if (enc_notify_window < 0)
+		enc_notify_window = enc_path_hash ? 1 : 0;
+	else if (enc_notify_window == 0 && enc_path_hash){
+		std::cout << "WARNING: ENC_NOTIFY_WINDOW 0 is taken as 1 with ENC_PATH_HASH 1\n";
+		enc_notify_window = 1;
+	}
+
 
 	bool dynamicth = use_dynamic_pfc_threshold;
 
 	Config::SetDefault("ns3::QbbNetDevice::PauseTime", UintegerValue(pause_time));
+	Config::SetDefault("ns3::QbbNetDevice::QbbEnabled", BooleanValue(enable_pfc));
+	if (enable_pfc)
+		PfcDeadlockDetector::Enable(pfc_deadlock, stdout, MicroSeconds(pause_time));
 	Config::SetDefault("ns3::QbbNetDevice::QcnEnabled", BooleanValue(enable_qcn));
 	Config::SetDefault("ns3::QbbNetDevice::DynamicThreshold", BooleanValue(dynamicth));
+	Config::SetDefault("ns3::RdmaEgressQueue::QpScheduler", UintegerValue(qp_scheduler));
+
+	// multithreaded simulator, must be selected before the simulator is created
+	mt_order = threads > 0 || parallel_order;
+	if (threads > 0)
+		MtpInterface::Enable(threads);
+	else if (mt_order)
+		Config::SetDefault("ns3::DefaultSimulatorImpl::OrderByContext", BooleanValue(true));
+
+	ObjectFactory scheduler;
+	scheduler.SetTypeId(scheduler_type);
+	Simulator::SetScheduler(scheduler);
+
+	// event log, records are only compiled in with ./waf configure --event-log-level=N
+	if (event_log_level > 0 && !event_log_file.empty())
+		EventLog::Open(event_log_file, event_log_level);
 
 	// set int_multi
 	IntHop::multi = int_multi;
@@ -802,11 +1028,11 @@ int main(int argc, char *argv[])
 	//SeedManager::SetSeed(time(NULL));
 
 	topof.open(topology_file.c_str());
-	flowf.open(flow_file.c_str());
 	tracef.open(trace_file.c_str());
 	uint32_t node_num, switch_num, en_num,link_num, trace_num;
 	topof >> node_num >> switch_num >>en_num >>link_num;
-	flowf >> flow_num;
+	flow_num = OpenFlowInput();
+	flow_done.resize(flow_num, 0);
 	tracef >> trace_num;
 
 
@@ -824,15 +1050,37 @@ int main(int argc, char *argv[])
 		topof >> eid;
 		node_type[eid] = 2;
 	}	
+	struct LinkInput{
+		uint32_t src, dst;
+		std::string data_rate, link_delay;
+		double error_rate;
+	};
+	std::vector<LinkInput> links(link_num);
+	for (uint32_t i = 0; i < link_num; i++)
+		topof >> links[i].src >> links[i].dst >> links[i].data_rate >> links[i].link_delay >> links[i].error_rate;
+
+	// thread of each node, pods are kept on one thread
+	std::vector<uint32_t> system_id(node_num, 0);
+	if (threads > 0){
+		PodPartitionHelper partition(node_num);
+		for (uint32_t i = 0; i < node_num; i++)
+			if (node_type[i] == 0)
+				partition.SetHost(i);
+		for (uint32_t i = 0; i < link_num; i++)
+			partition.AddLink(links[i].src, links[i].dst);
+		system_id = partition.Partition(threads);
+	}
+
 	for (uint32_t i = 0; i < node_num; i++){
 		if (node_type[i] == 0)
-			n.Add(CreateObject<Node>());
+			n.Add(CreateObject<Node>(system_id[i]));
 		else if(node_type[i] == 1){
-			Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+			Ptr<SwitchNode> sw = CreateObject<SwitchNode>(system_id[i]);
 			n.Add(sw);
 			sw->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
+			sw->SetAttribute("PfcEnabled", BooleanValue(enable_pfc));
 		}else{
-			Ptr<EnquserverNode> en = CreateObject<EnquserverNode>();
+			Ptr<EnquserverNode> en = CreateObject<EnquserverNode>(system_id[i]);
 			n.Add(en);
 			en->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
 		}
@@ -874,10 +1122,9 @@ int main(int argc, char *argv[])
 	Ipv4AddressHelper ipv4;
 	for (uint32_t i = 0; i < link_num; i++)
 	{
-		uint32_t src, dst;
-		std::string data_rate, link_delay;
-		double error_rate;
-		topof >> src >> dst >> data_rate >> link_delay >> error_rate;
+		uint32_t src = links[i].src, dst = links[i].dst;
+		std::string data_rate = links[i].data_rate, link_delay = links[i].link_delay;
+		double error_rate = links[i].error_rate;
 		std::cout << "src-------------- " << src << std::endl;
 		std::cout << "dst-------------- " << dst << std::endl;
 		std::cout << "data_rate----------- " << data_rate << std::endl;
@@ -915,6 +1162,18 @@ int main(int argc, char *argv[])
 		// because we want our IP to be the primary IP (first in the IP address list),
 		// so that the global routing is based on our IP
 		NetDeviceContainer d = qbb.Install(snode, dnode);
+		if (mt_order){
+			// error models draw random numbers, the two ends may run on different threads
+			for (uint32_t k = 0; k < 2; k++){
+				Ptr<RateErrorModel> rem = CreateObject<RateErrorModel>();
+				Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable>();
+				rem->SetRandomVariable(uv);
+				uv->SetStream(50);
+				rem->SetAttribute("ErrorRate", DoubleValue(error_rate > 0 ? error_rate : error_rate_per_link));
+				rem->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+				d.Get(k)->SetAttribute("ReceiveErrorModel", PointerValue(rem));
+			}
+		}
 		if (snode->GetNodeType() == 0){
 			Ptr<Ipv4> ipv4 = snode->GetObject<Ipv4>();
 			ipv4->AddInterface(d.Get(0));
@@ -939,11 +1198,11 @@ int main(int argc, char *argv[])
 		// niux: set max rate for egress port of switch
 		if (snode->GetNodeType() == 1){ // is switch
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(snode);
-			sw->max_rate[nbr2if[snode][dnode].idx] = nbr2if[snode][dnode].bw;
+			sw->SetMaxRate(nbr2if[snode][dnode].idx, nbr2if[snode][dnode].bw);
 		}
 		if (dnode->GetNodeType() == 1) {
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(dnode);
-			sw->max_rate[nbr2if[snode][dnode].idx] = nbr2if[snode][dnode].bw;
+			sw->SetMaxRate(nbr2if[dnode][snode].idx, nbr2if[dnode][snode].bw);
 		}
 
 
@@ -964,6 +1223,7 @@ int main(int argc, char *argv[])
 	for (uint32_t i = 0; i < node_num; i++){
 		if (n.Get(i)->GetNodeType() == 1){ // is switch
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(n.Get(i));
+			sw->ConfigNPort(sw->GetNDevices()-1);
 			uint32_t shift = 3; // by default 1/8
 			for (uint32_t j = 1; j < sw->GetNDevices(); j++){
 				Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(sw->GetDevice(j));
@@ -985,13 +1245,15 @@ int main(int argc, char *argv[])
 					rate /= 2;
 				}
 			}
-			sw->m_mmu->ConfigNPort(sw->GetNDevices()-1);
 			sw->m_mmu->ConfigBufferSize(buffer_size* 1024 * 1024);
 			sw->m_mmu->node_id = sw->GetId();
+			if (!qlen_mon_file.empty())
+				sw->m_mmu->ConfigQlenMon(qlen_mon_start, qlen_mon_end, qlen_mon_interval);
 		}
 		else if (n.Get(i)->GetNodeType() == 2)// is border router
 		{
 			Ptr<EnquserverNode> eqs = DynamicCast<EnquserverNode>(n.Get(i));
+			eqs->m_mmu->ConfigNPort(eqs->GetNDevices()-1);
 			uint32_t shift = 3; // by default 1/8
 			for (uint32_t j = 1; j < eqs->GetNDevices(); j++){
 				Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(eqs->GetDevice(j));
@@ -1013,7 +1275,6 @@ int main(int argc, char *argv[])
 					rate /= 2;
 				}
 			}
-			eqs->m_mmu->ConfigNPort(eqs->GetNDevices()-1);
 			eqs->m_mmu->ConfigBufferSize(buffer_size* 1024 * 1024);
 			eqs->m_mmu->node_id = eqs->GetId();
 		}
@@ -1037,8 +1298,12 @@ int main(int argc, char *argv[])
 			rdmaHw->SetAttribute("RateAI", DataRateValue(DataRate(rate_ai)));
 			rdmaHw->SetAttribute("RateHAI", DataRateValue(DataRate(rate_hai)));
 			rdmaHw->SetAttribute("L2BackToZero", BooleanValue(l2_back_to_zero));
+			rdmaHw->SetAttribute("L2SelectiveRepeat", BooleanValue(l2_selective_repeat));
 			rdmaHw->SetAttribute("L2ChunkSize", UintegerValue(l2_chunk_size));
 			rdmaHw->SetAttribute("L2AckInterval", UintegerValue(l2_ack_interval));
+			rdmaHw->SetAttribute("L2AckCoalesceBytes", UintegerValue(l2_ack_coalesce_bytes));
+			rdmaHw->SetAttribute("L2AckCoalesceTime", DoubleValue(l2_ack_coalesce_time));
+			rdmaHw->SetAttribute("PathHash", BooleanValue(enc_path_hash));
 			rdmaHw->SetAttribute("CcMode", UintegerValue(cc_mode));
 			rdmaHw->SetAttribute("RateDecreaseInterval", DoubleValue(rate_decrease_interval));
 			rdmaHw->SetAttribute("MinRate", DataRateValue(DataRate(min_rate)));
@@ -1109,11 +1374,16 @@ int main(int argc, char *argv[])
 			Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(n.Get(i));
 			sw->SetAttribute("CcMode", UintegerValue(cc_mode));
 			sw->SetAttribute("MaxRtt", UintegerValue(maxRtt));
+			sw->SetAttribute("FlowletGap", UintegerValue(flowlet_gap));
+			sw->SetAttribute("FlowletTableSize", UintegerValue(flowlet_table_size));
+			sw->SetAttribute("FlowletFeedback", BooleanValue(flowlet_feedback));
 		}else if (n.Get(i)->GetNodeType() == 2)
 		{
 			Ptr<EnquserverNode> eqs = DynamicCast<EnquserverNode>(n.Get(i));
 			eqs->SetAttribute("CcMode", UintegerValue(cc_mode));
 			eqs->SetAttribute("MaxRtt", UintegerValue(maxRtt));
+			eqs->SetAttribute("NotifyWindow", DoubleValue(enc_notify_window));
+			eqs->SetAttribute("TableTimeout", DoubleValue(enc_table_timeout));
 		}
 		
 	}
@@ -1134,8 +1404,9 @@ int main(int argc, char *argv[])
 	}
 
 	FILE *trace_output = fopen(trace_output_file.c_str(), "w");
+	TraceWriter trace_writer(trace_output, trace_compress);
 	if (enable_trace)
-		qbb.EnableTracing(trace_output, trace_nodes);
+		qbb.EnableTracing(&trace_writer, trace_nodes);
 
 	// dump link speed to trace file
 	{
@@ -1158,19 +1429,10 @@ int main(int argc, char *argv[])
 
 	Time interPacketInterval = Seconds(0.0000005 / 2);
 
-	// maintain port number for each host
-	for (uint32_t i = 0; i < node_num; i++){
-		if (n.Get(i)->GetNodeType() == 0)
-			for (uint32_t j = 0; j < node_num; j++){
-				if (n.Get(j)->GetNodeType() == 0)
-					portNumder[i][j] = 10000; // each host pair use port number from 10000
-			}
-	}
-
-	flow_input.idx = 0;
+	flow_idx = 0;
 	if (flow_num > 0){
 		ReadFlowInput();
-		Simulator::Schedule(Seconds(flow_input.start_time)-Simulator::Now(), ScheduleFlowInputs);
+		Simulator::Schedule(TimeStep(flow_input.start) - Simulator::Now(), ScheduleFlowInputs);
 	}
 
 	topof.close();
@@ -1181,9 +1443,13 @@ int main(int argc, char *argv[])
 		Simulator::Schedule(Seconds(2) + MicroSeconds(link_down_time), &TakeDownLink, n, n.Get(link_down_A), n.Get(link_down_B));
 	}
 
-	// schedule buffer monitor
-	FILE* qlen_output = fopen(qlen_mon_file.c_str(), "w");
-	Simulator::Schedule(NanoSeconds(qlen_mon_start), &monitor_buffer, qlen_output, &n);
+	// schedule buffer monitor dumps
+	if (!qlen_mon_file.empty()){
+		FILE* qlen_output = fopen(qlen_mon_file.c_str(), "w");
+		uint64_t first_dump = (qlen_mon_start + qlen_dump_interval - 1) / qlen_dump_interval * qlen_dump_interval;
+		if (first_dump <= get_qlen_mon_last())
+			Simulator::Schedule(NanoSeconds(first_dump), &dump_qlen, qlen_output, &n);
+	}
 
 	//
 	// Now, do the actual simulation.
@@ -1195,7 +1461,26 @@ int main(int argc, char *argv[])
 	Simulator::Run();
 	Simulator::Destroy();
 	NS_LOG_INFO("Done.");
+	trace_writer.Close();
 	fclose(trace_output);
+	EventLog::Close();
+	if (PfcDeadlockDetector::s_mode != PfcDeadlockDetector::OFF)
+		std::cout << "PFC deadlocks: " << PfcDeadlockDetector::GetDeadlocks() << "\n";
+	uint64_t notify_sent = 0, notify_suppressed = 0;
+	for (uint32_t i = 0; i < n.GetN(); i++){
+		if (n.Get(i)->GetNodeType() == 2){
+			Ptr<EnquserverNode> eqs = DynamicCast<EnquserverNode>(n.Get(i));
+			notify_sent += eqs->GetNotifySent();
+			notify_suppressed += eqs->GetNotifySuppressed();
+			std::cout << "ENC node " << i << " shared table: " << eqs->GetSharedTableFlows() << " flows on " << eqs->GetSharedTableSize() << " links at the end, peak " << eqs->GetSharedTablePeak()
+				<< " flows, removed " << eqs->GetFinFlows() << " on FIN, " << eqs->GetAgedFlows() << " aged out\n";
+			if (enc_path_hash)
+				std::cout << "ENC node " << i << " paths learned: " << eqs->GetPathsLearned() << ", probes asked: " << eqs->GetProbesAsked() << "\n";
+		}
+	}
+	if (notify_sent + notify_suppressed > 0)
+		std::cout << "ENC notifications sent: " << notify_sent << ", suppressed: " << notify_suppressed << "\n";
+	std::cout << "Flows finished: " << std::count(flow_done.begin(), flow_done.end(), 1) << "/" << flow_num << "\n";
 
 	endt = clock();
 	std::cout << (double)(endt - begint) / CLOCKS_PER_SEC << "\n";
@@ -25,6 +25,7 @@
 
 #include "ptr.h"
 #include "pointer.h"
+#include "boolean.h"
 #include "assert.h"
 #include "log.h"
 
@@ -40,12 +41,24 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (DefaultSimulatorImpl);
 
+// uids of the events of a node have this bit set, then the creating
+// context + 1 above UID_CONTEXT_SHIFT, 0 for the main program, and a
+// counter of that context below; see MultithreadedSimulatorImpl
+static const uint64_t UID_NODE_EVENT = (uint64_t)1 << 63;
+static const uint32_t UID_CONTEXT_SHIFT = 40;
+
 TypeId
 DefaultSimulatorImpl::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::DefaultSimulatorImpl")
     .SetParent<SimulatorImpl> ()
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("OrderByContext",
+                   "Order the events of the same timestamp as the MultithreadedSimulatorImpl does: "
+                   "by the context that created them, then FIFO. If false, they are run in FIFO order.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DefaultSimulatorImpl::m_orderByContext),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -127,6 +140,27 @@ DefaultSimulatorImpl::GetSystemId (void) const
   return 0;
 }
 
+uint64_t
+DefaultSimulatorImpl::AllocateUid (uint32_t context)
+{
+  if (!m_orderByContext)
+    {
+      return m_uid++;
+    }
+  // the events of the same timestamp run in the same order as with the
+  // MultithreadedSimulatorImpl, whatever the number of its partitions
+  uint64_t uid = context == 0xffffffff ? 0 : UID_NODE_EVENT;
+  if (m_currentContext == 0xffffffff)
+    {
+      return uid | m_uid++;
+    }
+  if (m_currentContext >= m_contextUid.size ())
+    {
+      m_contextUid.resize (m_currentContext + 1, 0);
+    }
+  return uid | (static_cast<uint64_t> (m_currentContext + 1) << UID_CONTEXT_SHIFT) | m_contextUid[m_currentContext]++;
+}
+
 void
 DefaultSimulatorImpl::ProcessOneEvent (void)
 {
@@ -176,8 +210,7 @@ DefaultSimulatorImpl::ProcessEventsWithContext (void)
        ev.impl = event.event;
        ev.key.m_ts = m_currentTs + event.timestamp;
        ev.key.m_context = event.context;
-       ev.key.m_uid = m_uid;
-       m_uid++;
+       ev.key.m_uid = (m_orderByContext && event.context != 0xffffffff ? UID_NODE_EVENT : 0) | m_uid++;
        m_unscheduledEvents++;
        m_events->Insert (ev);
     }
@@ -236,8 +269,7 @@ DefaultSimulatorImpl::Schedule (Time const &time, EventImpl *event)
   ev.impl = event;
   ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
   ev.key.m_context = GetContext ();
-  ev.key.m_uid = m_uid;
-  m_uid++;
+  ev.key.m_uid = AllocateUid (ev.key.m_context);
   m_unscheduledEvents++;
   m_events->Insert (ev);
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
@@ -256,8 +288,7 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, E
       ev.impl = event;
       ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
       ev.key.m_context = context;
-      ev.key.m_uid = m_uid;
-      m_uid++;
+      ev.key.m_uid = AllocateUid (context);
       m_unscheduledEvents++;
       m_events->Insert (ev);
     }
@@ -284,8 +315,7 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, E
   ev.impl = event;
   ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
   ev.key.m_context = context;
-  ev.key.m_uid = m_uid;
-  m_uid++;
+  ev.key.m_uid = AllocateUid (context);
   m_unscheduledEvents++;
   m_events->Insert (ev);
 }
@@ -302,8 +332,7 @@ DefaultSimulatorImpl::ScheduleNow (EventImpl *event)
   ev.impl = event;
   ev.key.m_ts = m_currentTs;
   ev.key.m_context = GetContext ();
-  ev.key.m_uid = m_uid;
-  m_uid++;
+  ev.key.m_uid = AllocateUid (ev.key.m_context);
   m_unscheduledEvents++;
   m_events->Insert (ev);
   return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
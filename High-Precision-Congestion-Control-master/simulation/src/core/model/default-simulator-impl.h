@@ -32,11 +32,19 @@
 #include "ptr.h"
 
 #include <list>
+#include <vector>
 
 namespace ns3 {
 
 /**
  * \ingroup simulator
+ *
+ * With the OrderByContext attribute, the events of the same timestamp
+ * run in the order of the MultithreadedSimulatorImpl instead of FIFO:
+ * the events with context 0xffffffff first, then the events created by
+ * the main program, then by the id of the node that created them, each
+ * node's in FIFO order. A sequential run then gives the same result as
+ * a multithreaded one.
  */
 class DefaultSimulatorImpl : public SimulatorImpl
 {
@@ -69,6 +77,7 @@ private:
   virtual void DoDispose (void);
   void ProcessOneEvent (void);
   void ProcessEventsWithContext (void);
+  uint64_t AllocateUid (uint32_t context);
  
   struct EventWithContext {
     uint32_t context;
@@ -87,8 +96,13 @@ private:
   bool m_stop;
   Ptr<Scheduler> m_events;
 
-  uint32_t m_uid;
-  uint32_t m_currentUid;
+  bool m_orderByContext;
+  // uid of the events of the main program and of the other threads, of
+  // all the events unless m_orderByContext
+  uint64_t m_uid;
+  // next uid of the events created by each context
+  std::vector<uint64_t> m_contextUid;
+  uint64_t m_currentUid;
   uint64_t m_currentTs;
   uint32_t m_currentContext;
   // number of events that have been inserted but not yet scheduled,
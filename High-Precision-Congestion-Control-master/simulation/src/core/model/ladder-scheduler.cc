@@ -0,0 +1,277 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include <algorithm>
+#include "assert.h"
+#include "log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+// a bucket with more events than this is split into a new rung
+static const uint32_t LADDER_THRESHOLD = 50;
+static const uint32_t LADDER_MAX_RUNGS = 8;
+
+static bool
+EventGreater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key > b.key;
+}
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (~(uint64_t)0),
+    m_topMax (0),
+    m_nRungs (0),
+    m_qSize (0)
+{
+  NS_LOG_FUNCTION (this);
+  // allocated once, so that references to rungs stay valid while a new one is built
+  m_rungs.resize (LADDER_MAX_RUNGS);
+}
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::GetRungCur (const Rung &rung) const
+{
+  return rung.start + rung.cur * rung.width;
+}
+
+uint64_t
+LadderScheduler::GetLowestBound (void) const
+{
+  // events below this bound belong to the bottom
+  return m_nRungs > 0 ? GetRungCur (m_rungs[m_nRungs - 1]) : m_topStart;
+}
+
+// spread events of [start, end) over a new finest rung, returns the end of its range
+uint64_t
+LadderScheduler::BuildRung (Bucket &events, uint64_t start, uint64_t end)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << end);
+  NS_ASSERT (m_nRungs < LADDER_MAX_RUNGS && !events.empty () && end > start);
+  Rung &rung = m_rungs[m_nRungs++];
+  uint64_t width = (end - start) / events.size ();
+  if (width == 0)
+    {
+      width = 1;
+    }
+  uint32_t nBuckets = (end - start + width - 1) / width;
+  if (rung.buckets.size () < nBuckets)
+    {
+      rung.buckets.resize (nBuckets);
+    }
+  rung.start = start;
+  rung.width = width;
+  rung.cur = 0;
+  rung.count = events.size ();
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); i++)
+    {
+      rung.buckets[(i->key.m_ts - start) / width].push_back (*i);
+    }
+  events.clear ();
+  return start + nBuckets * width;
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  uint64_t bound = GetLowestBound ();
+  if (m_bottom.size () >= 2 * LADDER_THRESHOLD && m_nRungs < LADDER_MAX_RUNGS)
+    {
+      uint64_t start = std::min (m_bottom.back ().key.m_ts, ev.key.m_ts);
+      if (bound - start >= 2)
+        {
+          // the bottom grew too large to keep sorted
+          m_bottom.push_back (ev);
+          BuildRung (m_bottom, start, bound);
+          return;
+        }
+    }
+  m_bottom.insert (std::upper_bound (m_bottom.begin (), m_bottom.end (), ev, EventGreater), ev);
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_qSize++;
+  if (ts >= m_topStart)
+    {
+      m_top.push_back (ev);
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+      return;
+    }
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung &rung = m_rungs[i];
+      if (ts >= GetRungCur (rung))
+        {
+          rung.buckets[(ts - rung.start) / rung.width].push_back (ev);
+          rung.count++;
+          return;
+        }
+    }
+  InsertBottom (ev);
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_qSize == 0;
+}
+
+void
+LadderScheduler::Refill (void)
+{
+  NS_LOG_FUNCTION (this);
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          // the whole top becomes the first rung, the top restarts after it
+          m_topStart = BuildRung (m_top, m_topMin, m_topMax + 1);
+          m_topMin = ~(uint64_t)0;
+          m_topMax = 0;
+          continue;
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      if (rung.count == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung.buckets[rung.cur].empty ())
+        {
+          rung.cur++;
+        }
+      Bucket &bucket = rung.buckets[rung.cur];
+      uint64_t bucketStart = GetRungCur (rung);
+      rung.cur++;
+      rung.count -= bucket.size ();
+      if (bucket.size () > LADDER_THRESHOLD && rung.width > 1 && m_nRungs < LADDER_MAX_RUNGS)
+        {
+          BuildRung (bucket, bucketStart, bucketStart + rung.width);
+        }
+      else
+        {
+          m_bottom.swap (bucket);
+          std::sort (m_bottom.begin (), m_bottom.end (), EventGreater);
+        }
+    }
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  // moving events down the ladder does not change the set of events
+  const_cast<LadderScheduler *> (this)->Refill ();
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Refill ();
+  Scheduler::Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_qSize--;
+  NS_LOG_DEBUG ("remove ts=" << ev.key.m_ts <<
+                ", key=" << ev.key.m_uid <<
+                ", from ladder=" << m_nRungs);
+  return ev;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  uint64_t ts = ev.key.m_ts;
+  Bucket *bucket = &m_bottom;
+  Rung *rung = 0;
+  if (ts >= m_topStart)
+    {
+      bucket = &m_top;
+    }
+  else
+    {
+      for (uint32_t i = 0; i < m_nRungs; i++)
+        {
+          if (ts >= GetRungCur (m_rungs[i]))
+            {
+              rung = &m_rungs[i];
+              bucket = &rung->buckets[(ts - rung->start) / rung->width];
+              break;
+            }
+        }
+    }
+  for (Bucket::iterator i = bucket->begin (); i != bucket->end (); i++)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (ev.impl == i->impl);
+          // only the bottom needs to stay sorted
+          if (bucket == &m_bottom)
+            {
+              bucket->erase (i);
+            }
+          else
+            {
+              *i = bucket->back ();
+              bucket->pop_back ();
+            }
+          if (rung != 0)
+            {
+              rung->count--;
+            }
+          m_qSize--;
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue described in "Ladder
+ * Queue: An O(1) Priority Queue Structure for Large-Scale Discrete Event
+ * Simulation" by Tang, Goh and Thng (2005). Events are kept in three tiers:
+ *
+ *  - Top: an unsorted vector of the events beyond the range of the ladder,
+ *  - Ladder: rungs of buckets, each rung splitting one bucket of the rung
+ *    above it into finer buckets,
+ *  - Bottom: a small sorted vector holding the events dequeued next.
+ *
+ * Bucket widths are derived from the events themselves whenever a rung is
+ * created, so the queue adapts to the clustered timestamps of link events
+ * (tx time plus propagation delay) without the global resizes of the
+ * CalendarScheduler. Insert and RemoveNext are amortized O(1); Remove is
+ * linear in the size of the bucket holding the event.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Scheduler::Event> Bucket;
+  struct Rung
+  {
+    std::vector<Bucket> buckets;
+    // timestamp of the start of bucket 0
+    uint64_t start;
+    // duration of a bucket, at least 1
+    uint64_t width;
+    // index of the first bucket not yet moved down
+    uint32_t cur;
+    // number of events in the rung
+    uint32_t count;
+  };
+
+  void Refill (void);
+  uint64_t BuildRung (Bucket &events, uint64_t start, uint64_t end);
+  void InsertBottom (const Event &ev);
+  uint64_t GetRungCur (const Rung &rung) const;
+  uint64_t GetLowestBound (void) const;
+
+  Bucket m_top;
+  uint64_t m_topStart;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  // rungs in use are m_rungs[0..m_nRungs), the finest last;
+  // released rungs are kept to reuse their buckets
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  // sorted by decreasing key, the next event is at the back
+  Bucket m_bottom;
+  // number of events in queue
+  uint32_t m_qSize;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
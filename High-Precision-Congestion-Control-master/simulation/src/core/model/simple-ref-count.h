@@ -27,6 +27,9 @@
 #include "assert.h"
 #include <stdint.h>
 #include <limits>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 #ifdef WIN32
 #include "winport.h"
@@ -111,8 +114,13 @@ public:
    */
   inline void Unref (void) const
   {
+#ifdef NS3_MTP
+    // objects shared by the threads of the multithreaded simulator
+    if (m_count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+#else
     m_count--;
     if (m_count == 0)
+#endif
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
@@ -134,7 +142,11 @@ public:
 private:
   // Note we make this mutable so that the const methods can still
   // change it.
+#ifdef NS3_MTP
+  mutable std::atomic<uint32_t> m_count;
+#else
   mutable uint32_t m_count;
+#endif
 };
 
 } // namespace ns3
@@ -23,6 +23,11 @@
 #include "ns3/heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/config.h"
+#include "ns3/boolean.h"
+
+#include <sstream>
 
 namespace ns3 {
 
@@ -168,6 +173,81 @@ SimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_destroy, true, "Event should have run");
 }
 
+class SimulatorOrderTestCase : public TestCase
+{
+public:
+  SimulatorOrderTestCase (ObjectFactory schedulerFactory, bool orderByContext);
+  virtual void DoRun (void);
+  void Spawn (void);
+  void Record (std::string name);
+  void CheckExpired (void);
+  std::string m_order;
+  EventId m_global;
+  EventId m_late;
+  bool m_expired;
+  ObjectFactory m_schedulerFactory;
+  bool m_orderByContext;
+};
+
+SimulatorOrderTestCase::SimulatorOrderTestCase (ObjectFactory schedulerFactory, bool orderByContext)
+  : TestCase ("Check the order of simultaneous events with " +
+              schedulerFactory.GetTypeId ().GetName () +
+              (orderByContext ? " ordered by context" : " in FIFO order")),
+    m_schedulerFactory (schedulerFactory),
+    m_orderByContext (orderByContext)
+{
+}
+
+void
+SimulatorOrderTestCase::Spawn (void)
+{
+  // by context, the events of a node run by its id, then in the order it scheduled them
+  std::ostringstream oss;
+  oss << Simulator::GetContext ();
+  Simulator::Schedule (MicroSeconds (4), &SimulatorOrderTestCase::Record, this, oss.str () + "a");
+  Simulator::Schedule (MicroSeconds (4), &SimulatorOrderTestCase::Record, this, oss.str () + "b");
+  if (Simulator::GetContext () == 2)
+    {
+      m_late = Simulator::Schedule (MicroSeconds (4), &SimulatorOrderTestCase::Record, this, oss.str () + "c");
+    }
+}
+
+void
+SimulatorOrderTestCase::Record (std::string name)
+{
+  m_order += name + " ";
+}
+
+void
+SimulatorOrderTestCase::CheckExpired (void)
+{
+  m_expired = m_global.IsExpired () && !m_late.IsExpired ();
+}
+
+void
+SimulatorOrderTestCase::DoRun (void)
+{
+  m_order = "";
+  m_expired = false;
+
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::OrderByContext", BooleanValue (m_orderByContext));
+  Simulator::SetScheduler (m_schedulerFactory);
+
+  Simulator::ScheduleWithContext (2, MicroSeconds (1), &SimulatorOrderTestCase::Spawn, this);
+  Simulator::ScheduleWithContext (1, MicroSeconds (1), &SimulatorOrderTestCase::Spawn, this);
+  // by context, the events of context 0xffffffff run first, then the ones the main program created
+  Simulator::ScheduleWithContext (1, MicroSeconds (5), &SimulatorOrderTestCase::Record, this, std::string ("m"));
+  m_global = Simulator::Schedule (MicroSeconds (5), &SimulatorOrderTestCase::Record, this, std::string ("g"));
+  Simulator::ScheduleWithContext (2, MicroSeconds (5), &SimulatorOrderTestCase::CheckExpired, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::OrderByContext", BooleanValue (false));
+
+  NS_TEST_EXPECT_MSG_EQ (m_order, m_orderByContext ? "g m 1a 1b 2a 2b 2c " : "m g 2a 2b 2c 1a 1b ",
+                         "Simultaneous events out of order");
+  NS_TEST_EXPECT_MSG_EQ (m_expired, true, "Expired state of the events of the same time");
+}
+
 class SimulatorTemplateTestCase : public TestCase
 {
 public:
@@ -475,6 +555,23 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (ListScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory, false));
+    AddTestCase (new SimulatorOrderTestCase (factory, true));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory, false));
+    AddTestCase (new SimulatorOrderTestCase (factory, true));
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory, false));
+    AddTestCase (new SimulatorOrderTestCase (factory, true));
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory, false));
+    AddTestCase (new SimulatorOrderTestCase (factory, true));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorOrderTestCase (factory, false));
+    AddTestCase (new SimulatorOrderTestCase (factory, true));
   }
 } g_simulatorTestSuite;
 
@@ -91,10 +91,10 @@ SeqTsHeader::Print (std::ostream &os) const
 uint32_t
 SeqTsHeader::GetSerializedSize (void) const
 {
-	return GetHeaderSize();
+	return 6 + ih.GetSerializedSize();
 }
 uint32_t SeqTsHeader::GetHeaderSize(void){
-	return 6 + MyIntHeader::GetStaticSize();
+	return 6 + MyIntHeader::GetMaxSize();
 }
 
 void
@@ -59,7 +59,7 @@ public:
   virtual TypeId GetInstanceTypeId (void) const;
   virtual void Print (std::ostream &os) const;
   virtual uint32_t GetSerializedSize (void) const;
-  static uint32_t GetHeaderSize(void);
+  static uint32_t GetHeaderSize(void); // the largest size, with all the INT records
 private:
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
@@ -386,8 +386,7 @@ Ptr<TcpOption> TcpHeader::GetOption (TcpOption::Kind kind) const
 // add by niux
 void TcpHeader::SetFin (bool fin)
 {
-  uint16_t flag = 1?0:fin;
-  TcpHeader::SetFlags(flag);
+  SetFlags (fin ? (m_flags | FIN) : (m_flags & ~FIN));
 }
 
 } // namespace ns3
@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <vector>
+
+#include "mtp-interface.h"
+#include "mpi-receiver.h"
+#include "multithreaded-simulator-impl.h"
+
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/packet.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("MtpInterface");
+
+namespace ns3 {
+
+uint32_t              MtpInterface::m_size = 1;
+bool                  MtpInterface::m_enabled = false;
+
+uint32_t
+MtpInterface::GetSystemId ()
+{
+  return m_enabled ? Simulator::GetSystemId () : 0;
+}
+
+uint32_t
+MtpInterface::GetSize ()
+{
+  return m_size;
+}
+
+bool
+MtpInterface::IsEnabled ()
+{
+  return m_enabled;
+}
+
+void
+MtpInterface::Enable (uint32_t threads)
+{
+#ifdef NS3_MTP
+  NS_ASSERT (threads > 0);
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+  m_size = threads;
+  m_enabled = true;
+#else
+  NS_FATAL_ERROR ("Can't use multithreaded simulator without --enable-mtp");
+#endif
+}
+
+void
+MtpInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
+{
+  // the buffers of a packet are reference counted without locks, so the
+  // receiving thread gets a deep copy
+  static thread_local std::vector<uint8_t> buffer;
+  uint32_t serializedSize = p->GetSerializedSize ();
+  buffer.resize (serializedSize);
+  p->Serialize (&buffer[0], serializedSize);
+  Ptr<Packet> copy = Create<Packet> (&buffer[0], serializedSize, true);
+  Simulator::ScheduleWithContext (node, rxTime - Simulator::Now (), &MtpInterface::ReceivePacket, dev, copy);
+}
+
+void
+MtpInterface::ReceivePacket (uint32_t dev, Ptr<Packet> p)
+{
+  // runs in the context of the destination node
+  Ptr<Node> pNode = NodeList::GetNode (Simulator::GetContext ());
+  Ptr<MpiReceiver> pMpiRec = pNode->GetDevice (dev)->GetObject<MpiReceiver> ();
+  NS_ASSERT (pMpiRec != 0);
+  pMpiRec->Receive (p);
+}
+
+void
+MtpInterface::WriteFile (void *file, const void *data, uint32_t size)
+{
+  fwrite (data, 1, size, (FILE *)file);
+}
+
+void
+MtpInterface::Write (FILE *file, const void *data, uint32_t size)
+{
+  Write (&MtpInterface::WriteFile, file, data, size);
+}
+
+void
+MtpInterface::Write (Sink sink, void *object, const void *data, uint32_t size)
+{
+  if (m_enabled)
+    {
+      MultithreadedSimulatorImpl::Write (sink, object, data, size);
+    }
+  else
+    {
+      sink (object, data, size);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This object contains static methods that provide an easy interface
+// to the multithreaded simulator, the shared-memory counterpart of
+// MpiInterface.
+
+#ifndef NS3_MTP_INTERFACE_H
+#define NS3_MTP_INTERFACE_H
+
+#include <stdint.h>
+#include <cstdio>
+
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \ingroup mpi
+ *
+ * Interface between ns-3 and the MultithreadedSimulatorImpl
+ *
+ * Nodes are assigned to threads by their system id, which must be set
+ * when the node is created and be lower than the number of threads.
+ * Links between nodes of different threads use remote channels, as with
+ * MPI, and the smallest delay of these channels bounds the time the
+ * threads run between two synchronizations.
+ */
+class MtpInterface
+{
+public:
+  /**
+   * Receives the records passed to Write (); called by one thread at a time
+   */
+  typedef void (*Sink) (void *object, const void *data, uint32_t size);
+
+  /**
+   * \return the partition run by the calling thread, 0 outside of the run
+   */
+  static uint32_t GetSystemId ();
+  /**
+   * \return number of threads
+   */
+  static uint32_t GetSize ();
+  /**
+   * \return true if using the multithreaded simulator
+   */
+  static bool IsEnabled ();
+  /**
+   * \param threads number of threads
+   *
+   * Selects the MultithreadedSimulatorImpl; must be called before any
+   * event is scheduled. Needs a build configured with --enable-mtp.
+   */
+  static void Enable (uint32_t threads);
+  /**
+   * \param p packet to send
+   * \param rxTime received time at destination node
+   * \param node destination node
+   * \param dev destination device
+   *
+   * Copy a packet, so that no data is shared with the sending thread, and
+   * schedule its reception on the specified node and net device
+   */
+  static void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+  /**
+   * \param file output file
+   * \param data record to write
+   * \param size size of the record in bytes
+   *
+   * Write a record to a file; the records written by the nodes reach the
+   * file in the same order for any number of threads.
+   */
+  static void Write (FILE *file, const void *data, uint32_t size);
+  /**
+   * \param sink function receiving the record
+   * \param object first argument of the sink
+   * \param data record to write
+   * \param size size of the record in bytes
+   *
+   * Pass a record to a sink, in the same order for any number of threads.
+   */
+  static void Write (Sink sink, void *object, const void *data, uint32_t size);
+
+private:
+  static void ReceivePacket (uint32_t dev, Ptr<Packet> p);
+  static void WriteFile (void *file, const void *data, uint32_t size);
+
+  static uint32_t m_size;
+  static bool     m_enabled;
+};
+
+} // namespace ns3
+
+#endif /* NS3_MTP_INTERFACE_H */
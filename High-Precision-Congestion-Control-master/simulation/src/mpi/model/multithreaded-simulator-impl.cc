@@ -0,0 +1,749 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+#include "mtp-interface.h"
+
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/channel.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/node-list.h"
+#include "ns3/nstime.h"
+#include "ns3/pointer.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// Note:  Logging in this file is largely avoided due to the
+// number of calls that are made to these functions and the possibility
+// of causing recursions leading to stack overflow
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+// timestamp of an empty queue
+static const uint64_t NO_EVENT = ~(uint64_t)0;
+// event uids have this bit set for the events of a node, so that the
+// events of the global partition run first, then the creating context + 1
+// above UID_CONTEXT_SHIFT, 0 for the global partition, and a counter of
+// that context below
+static const uint64_t UID_NODE_EVENT = (uint64_t)1 << 63;
+static const uint32_t UID_CONTEXT_SHIFT = 40;
+
+// the partition run by this thread, 0 for the global one
+thread_local MultithreadedSimulatorImpl::Partition *MultithreadedSimulatorImpl::m_current = 0;
+
+// the wait at a barrier is short when the partitions are balanced, but
+// there may be more threads than cores
+static inline void
+Spin (uint32_t &spins)
+{
+  if (++spins > 1000)
+    {
+      std::this_thread::yield ();
+    }
+}
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_window (0),
+    m_finished (0),
+    m_done (false),
+    m_stop (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_global.index = 0;
+  // before ::Run is entered, the m_currentUid will be zero
+  m_global.currentTs = 0;
+  m_global.currentUid = 0;
+  m_global.currentContext = 0xffffffff;
+  m_global.currentEvent = 0;
+  m_global.minSent = NO_EVENT;
+  m_global.buffered = false;
+  // uids are allocated from 4.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  m_globalSeq = 4;
+  m_lookAhead = NO_EVENT;
+  m_windowEnd = 0;
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Partition *lp = m_partitions[i];
+      while (!lp->events->IsEmpty ())
+        {
+          Scheduler::Event next = lp->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (uint32_t parity = 0; parity < 2; parity++)
+        {
+          for (uint32_t j = 0; j < lp->mail[parity].size (); j++)
+            {
+              for (uint32_t k = 0; k < lp->mail[parity][j].size (); k++)
+                {
+                  lp->mail[parity][j][k].impl->Unref ();
+                }
+            }
+        }
+      delete lp;
+    }
+  m_partitions.clear ();
+  while (!m_global.events->IsEmpty ())
+    {
+      Scheduler::Event next = m_global.events->RemoveNext ();
+      next.impl->Unref ();
+    }
+  m_global.events = 0;
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  m_schedulerFactory = schedulerFactory;
+  std::vector<Partition *> lps (m_partitions);
+  lps.push_back (&m_global);
+  for (uint32_t i = 0; i < lps.size (); i++)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      if (lps[i]->events != 0)
+        {
+          while (!lps[i]->events->IsEmpty ())
+            {
+              Scheduler::Event next = lps[i]->events->RemoveNext ();
+              scheduler->Insert (next);
+            }
+        }
+      lps[i]->events = scheduler;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::CreatePartitions (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t nNodes = NodeList::GetNNodes ();
+  uint32_t n = std::max (MtpInterface::GetSize (), 1u);
+  m_partitionOf.resize (nNodes);
+  m_nodeSeq.assign (nNodes, 0);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      m_partitionOf[i] = NodeList::GetNode (i)->GetSystemId ();
+      n = std::max (n, m_partitionOf[i] + 1);
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Partition *lp = new Partition;
+      lp->events = m_schedulerFactory.Create<Scheduler> ();
+      lp->index = i;
+      lp->currentTs = 0;
+      lp->currentUid = 0;
+      lp->currentContext = 0xffffffff;
+      lp->currentEvent = 0;
+      // one mailbox per partition and one for the global partition
+      lp->mail[0].resize (n + 1);
+      lp->mail[1].resize (n + 1);
+      lp->minSent = NO_EVENT;
+      lp->buffered = n > 1;
+      m_partitions.push_back (lp);
+    }
+
+  // the events scheduled before the run go to the partition of their node
+  std::vector<Scheduler::Event> global;
+  while (!m_global.events->IsEmpty ())
+    {
+      Scheduler::Event ev = m_global.events->RemoveNext ();
+      Partition *lp = GetPartition (ev.key.m_context);
+      if (lp == &m_global)
+        {
+          global.push_back (ev);
+        }
+      else
+        {
+          lp->events->Insert (ev);
+        }
+    }
+  for (uint32_t i = 0; i < global.size (); i++)
+    {
+      m_global.events->Insert (global[i]);
+    }
+  NS_LOG_INFO (n << " partitions for " << nNodes << " nodes");
+}
+
+void
+MultithreadedSimulatorImpl::CalculateLookAhead (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_lookAhead = NO_EVENT;
+  for (NodeList::Iterator iter = NodeList::Begin (); iter != NodeList::End (); ++iter)
+    {
+      for (uint32_t i = 0; i < (*iter)->GetNDevices (); ++i)
+        {
+          Ptr<NetDevice> localNetDevice = (*iter)->GetDevice (i);
+          // only works for p2p links currently
+          if (!localNetDevice->IsPointToPoint ())
+            {
+              continue;
+            }
+          Ptr<Channel> channel = localNetDevice->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+
+          // grab the adjacent node
+          Ptr<Node> remoteNode;
+          if (channel->GetDevice (0) == localNetDevice)
+            {
+              remoteNode = (channel->GetDevice (1))->GetNode ();
+            }
+          else
+            {
+              remoteNode = (channel->GetDevice (0))->GetNode ();
+            }
+
+          // if it's in the same partition, don't consider it
+          if (remoteNode->GetSystemId () == (*iter)->GetSystemId ())
+            {
+              continue;
+            }
+
+          TimeValue delay;
+          if (!channel->GetAttributeFailSafe ("Delay", delay))
+            {
+              NS_FATAL_ERROR ("Channel between partitions without a delay: " << channel->GetInstanceTypeId ().GetName ());
+            }
+          m_lookAhead = std::min (m_lookAhead, (uint64_t)delay.Get ().GetTimeStep ());
+        }
+    }
+  if (m_lookAhead == 0)
+    {
+      NS_FATAL_ERROR ("Zero delay between partitions, no lookahead to run them in parallel");
+    }
+  NS_LOG_INFO ("lookahead " << m_lookAhead);
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context < m_partitionOf.size ())
+    {
+      return m_partitions[m_partitionOf[context]];
+    }
+  return const_cast<Partition *> (&m_global);
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetCurrent (void) const
+{
+  Partition *lp = m_current;
+  return lp != 0 ? lp : const_cast<Partition *> (&m_global);
+}
+
+uint64_t
+MultithreadedSimulatorImpl::AllocateUid (uint32_t context)
+{
+  Partition *lp = GetCurrent ();
+  uint64_t uid = context == 0xffffffff ? 0 : UID_NODE_EVENT;
+  if (lp == &m_global)
+    {
+      return uid | m_globalSeq++;
+    }
+  uint32_t creator = lp->currentContext;
+  return uid | (static_cast<uint64_t> (creator + 1) << UID_CONTEXT_SHIFT) | m_nodeSeq[creator]++;
+}
+
+void
+MultithreadedSimulatorImpl::Insert (Partition *lp, const Scheduler::Event &ev)
+{
+  Partition *current = GetCurrent ();
+  if (lp == current || current == &m_global)
+    {
+      // this thread runs the partition, or all partitions are stopped
+      lp->events->Insert (ev);
+      return;
+    }
+  if (ev.key.m_ts < m_windowEnd)
+    {
+      NS_FATAL_ERROR ("Event for context " << ev.key.m_context << " at " << ev.key.m_ts <<
+                      " is within the lookahead, the window ends at " << m_windowEnd);
+    }
+  uint32_t to = lp == &m_global ? m_partitions.size () : lp->index;
+  current->mail[m_window.load (std::memory_order_relaxed) & 1][to].push_back (ev);
+  current->minSent = std::min (current->minSent, ev.key.m_ts);
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (Partition *lp)
+{
+  Scheduler::Event next = lp->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= lp->currentTs);
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts);
+  lp->currentTs = next.key.m_ts;
+  lp->currentContext = next.key.m_context;
+  lp->currentUid = next.key.m_uid;
+  lp->currentEvent = next.impl;
+  next.impl->Invoke ();
+  // uids do not grow with time, so executed events are marked as such
+  next.impl->Cancel ();
+  next.impl->Unref ();
+  lp->currentEvent = 0;
+}
+
+void
+MultithreadedSimulatorImpl::ProcessWindow (Partition *lp)
+{
+  m_current = lp;
+  // deliver the events sent in the previous window
+  uint32_t parity = (m_window.load (std::memory_order_relaxed) + 1) & 1;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      std::vector<Scheduler::Event> &mail = m_partitions[i]->mail[parity][lp->index];
+      for (uint32_t j = 0; j < mail.size (); j++)
+        {
+          lp->events->Insert (mail[j]);
+        }
+      mail.clear ();
+    }
+  lp->minSent = NO_EVENT;
+  while (!lp->events->IsEmpty () && lp->events->PeekNext ().key.m_ts < m_windowEnd)
+    {
+      ProcessOneEvent (lp);
+    }
+  m_current = 0;
+}
+
+void
+MultithreadedSimulatorImpl::ProcessGlobal (uint64_t ts)
+{
+  while (!m_global.events->IsEmpty () && !m_stop.load (std::memory_order_relaxed)
+         && m_global.events->PeekNext ().key.m_ts == ts)
+    {
+      ProcessOneEvent (&m_global);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::ReceiveGlobal (void)
+{
+  uint32_t parity = m_window.load (std::memory_order_relaxed) & 1;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      std::vector<Scheduler::Event> &mail = m_partitions[i]->mail[parity][m_partitions.size ()];
+      for (uint32_t j = 0; j < mail.size (); j++)
+        {
+          m_global.events->Insert (mail[j]);
+        }
+      mail.clear ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::FlushOutput (void)
+{
+  // each partition wrote in the order of its events; merging the partitions
+  // by the key of their next event gives the order of the sequential run
+  uint32_t n = m_partitions.size ();
+  std::vector<size_t> pos (n, 0);
+  while (true)
+    {
+      uint32_t next = n;
+      const OutputRecord *nextRecord = 0;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          if (pos[i] == m_partitions[i]->output.size ())
+            {
+              continue;
+            }
+          const OutputRecord *record = reinterpret_cast<const OutputRecord *> (&m_partitions[i]->output[pos[i]]);
+          if (nextRecord == 0 || record->ts < nextRecord->ts
+              || (record->ts == nextRecord->ts && record->uid < nextRecord->uid))
+            {
+              next = i;
+              nextRecord = record;
+            }
+        }
+      if (nextRecord == 0)
+        {
+          break;
+        }
+      std::vector<uint8_t> &output = m_partitions[next]->output;
+      uint64_t ts = nextRecord->ts;
+      uint64_t uid = nextRecord->uid;
+      const OutputRecord *record = nextRecord;
+      do
+        {
+          record->sink (record->object, record + 1, record->size);
+          pos[next] += sizeof (OutputRecord) + ((record->size + 7) & ~7u);
+          record = reinterpret_cast<const OutputRecord *> (&output[0] + pos[next]);
+        }
+      while (pos[next] < output.size () && record->ts == ts && record->uid == uid);
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      m_partitions[i]->output.clear ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Write (MtpInterface::Sink sink, void *object, const void *data, uint32_t size)
+{
+  Partition *lp = m_current;
+  if (lp == 0 || !lp->buffered)
+    {
+      sink (object, data, size);
+      return;
+    }
+  size_t pos = lp->output.size ();
+  lp->output.resize (pos + sizeof (OutputRecord) + ((size + 7) & ~7u));
+  OutputRecord *record = reinterpret_cast<OutputRecord *> (&lp->output[pos]);
+  record->ts = lp->currentTs;
+  record->uid = lp->currentUid;
+  record->sink = sink;
+  record->object = object;
+  record->size = size;
+  std::memcpy (record + 1, data, size);
+}
+
+void
+MultithreadedSimulatorImpl::Worker (uint32_t index, uint64_t window)
+{
+  Partition *lp = m_partitions[index];
+  while (true)
+    {
+      uint32_t spins = 0;
+      while (m_window.load (std::memory_order_acquire) == window)
+        {
+          Spin (spins);
+        }
+      window++;
+      if (m_done.load (std::memory_order_relaxed))
+        {
+          break;
+        }
+      ProcessWindow (lp);
+      m_finished.fetch_add (1, std::memory_order_release);
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      if (!m_partitions[i]->events->IsEmpty () || m_partitions[i]->minSent != NO_EVENT)
+        {
+          return false;
+        }
+    }
+  return m_global.events->IsEmpty ();
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+      CalculateLookAhead ();
+    }
+  m_stop = false;
+  m_done = false;
+
+  uint32_t n = m_partitions.size ();
+  // the workers may start after the first window is opened
+  uint64_t window = m_window.load (std::memory_order_relaxed);
+  std::vector<std::thread> workers;
+  for (uint32_t i = 1; i < n; i++)
+    {
+      workers.push_back (std::thread (&MultithreadedSimulatorImpl::Worker, this, i, window));
+    }
+
+  while (!m_stop)
+    {
+      // the earliest event a partition may run next, including the
+      // events not yet delivered
+      uint64_t next = NO_EVENT;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          Partition *lp = m_partitions[i];
+          if (!lp->events->IsEmpty ())
+            {
+              next = std::min (next, lp->events->PeekNext ().key.m_ts);
+            }
+          next = std::min (next, lp->minSent);
+        }
+      uint64_t global = m_global.events->IsEmpty () ? NO_EVENT : m_global.events->PeekNext ().key.m_ts;
+      if (next == NO_EVENT && global == NO_EVENT)
+        {
+          break;
+        }
+      if (global <= next)
+        {
+          ProcessGlobal (global);
+          continue;
+        }
+
+      m_windowEnd = std::min (global, next + std::min (m_lookAhead, NO_EVENT - next));
+      m_finished.store (0, std::memory_order_relaxed);
+      m_window.fetch_add (1, std::memory_order_release);
+      ProcessWindow (m_partitions[0]);
+      uint32_t spins = 0;
+      while (m_finished.load (std::memory_order_acquire) != n - 1)
+        {
+          Spin (spins);
+        }
+      ReceiveGlobal ();
+      FlushOutput ();
+    }
+
+  m_done = true;
+  m_window.fetch_add (1, std::memory_order_release);
+  for (uint32_t i = 0; i < workers.size (); i++)
+    {
+      workers[i].join ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep ());
+  Simulator::Schedule (time, &Simulator::Stop);
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep () << event);
+  Partition *lp = GetCurrent ();
+  Time tAbsolute = time + TimeStep (lp->currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (lp->currentTs));
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_context = lp->currentContext;
+  ev.key.m_uid = AllocateUid (ev.key.m_context);
+  lp->events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+  Partition *lp = GetCurrent ();
+  Time tAbsolute = time + TimeStep (lp->currentTs);
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_context = context;
+  ev.key.m_uid = AllocateUid (context);
+  Insert (GetPartition (context), ev);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  Partition *lp = GetCurrent ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = lp->currentTs;
+  ev.key.m_context = lp->currentContext;
+  ev.key.m_uid = AllocateUid (ev.key.m_context);
+  lp->events->Insert (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  NS_ASSERT_MSG (m_current == 0, "Simulator::ScheduleDestroy called by a partition");
+  EventId id (Ptr<EventImpl> (event, false), m_global.currentTs, 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  return TimeStep (GetCurrent ()->currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - GetCurrent ()->currentTs);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Partition *lp = GetPartition (id.GetContext ());
+  NS_ASSERT_MSG (lp == GetCurrent () || m_current == 0, "Remove of an event of another partition");
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  lp->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0 ||
+          ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  // executed events are cancelled, see ProcessOneEvent
+  return ev.PeekEventImpl () == 0 ||
+         ev.PeekEventImpl ()->IsCancelled () ||
+         ev.PeekEventImpl () == GetCurrent ()->currentEvent;
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  Partition *lp = m_current;
+  return lp != 0 ? lp->index : 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrent ()->currentContext;
+}
+
+} // namespace ns3
@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/ptr.h"
+#include "mtp-interface.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <list>
+#include <vector>
+#include <atomic>
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief shared-memory parallel simulator implementation using lookahead
+ *
+ * The nodes are split into partitions by their system id, and each
+ * partition runs its events on its own thread. Partitions advance in
+ * windows: with T the earliest pending event of all partitions and L the
+ * smallest delay of the channels joining two partitions, no partition can
+ * receive an event earlier than T + L, so all of them run the events
+ * before T + L concurrently, then meet at a barrier. Events for another
+ * partition are posted to per-pair mailboxes, double-buffered so that no
+ * lock is taken, and delivered at the start of the next window.
+ *
+ * Events scheduled with context 0xffffffff (the ones scheduled by the main
+ * program) belong to a global partition, run by the main thread between
+ * windows while all partitions are stopped, before the node events of the
+ * same timestamp. They may access the state of any node.
+ *
+ * Event keys do not depend on the partitioning: an event is identified by
+ * the context which created it and a counter of that context, so every
+ * number of partitions runs the same events in the same order, and
+ * records written through Write () reach their sink in that order.
+ * The DefaultSimulatorImpl numbers its events the same way when its
+ * OrderByContext attribute is set, so a sequential run gives the same
+ * results.
+ *
+ * Simulator::Stop () called by a node takes effect at the end of the
+ * current window. The network module must be configured with
+ * --enable-mtp for packets to be shared safely between threads.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \brief Pass a record to a sink in the order of the sequential run
+   *
+   * Inside a window the record is buffered along with the key of the
+   * running event, and the buffers of all partitions are merged into their
+   * sinks at the next barrier. Sinks are only called by one thread at a time.
+   */
+  static void Write (MtpInterface::Sink sink, void *object, const void *data, uint32_t size);
+
+private:
+  struct Partition
+  {
+    Ptr<Scheduler> events;
+    uint32_t index;
+    uint64_t currentTs;
+    uint64_t currentUid;
+    uint32_t currentContext;
+    EventImpl *currentEvent;
+    // events sent to each partition, the global one last, by window parity
+    std::vector<std::vector<Scheduler::Event> > mail[2];
+    // earliest event sent in the last window
+    uint64_t minSent;
+    // records of Write (), each an OutputRecord followed by its data
+    std::vector<uint8_t> output;
+    bool buffered;
+  };
+  struct OutputRecord
+  {
+    uint64_t ts;
+    uint64_t uid;
+    MtpInterface::Sink sink;
+    void *object;
+    uint32_t size;
+  };
+  typedef std::list<EventId> DestroyEvents;
+
+  virtual void DoDispose (void);
+  void CreatePartitions (void);
+  void CalculateLookAhead (void);
+  Partition *GetPartition (uint32_t context) const;
+  Partition *GetCurrent (void) const;
+  uint64_t AllocateUid (uint32_t context);
+  void Insert (Partition *lp, const Scheduler::Event &ev);
+  void ProcessOneEvent (Partition *lp);
+  void ProcessWindow (Partition *lp);
+  void ProcessGlobal (uint64_t ts);
+  void ReceiveGlobal (void);
+  void FlushOutput (void);
+  void Worker (uint32_t index, uint64_t window);
+
+  static thread_local Partition *m_current;
+
+  Partition m_global;
+  std::vector<Partition *> m_partitions;
+  // partition of each node, by node id
+  std::vector<uint32_t> m_partitionOf;
+  // counter of the events created by each node, by node id
+  std::vector<uint64_t> m_nodeSeq;
+  uint64_t m_globalSeq;
+  ObjectFactory m_schedulerFactory;
+  DestroyEvents m_destroyEvents;
+  uint64_t m_lookAhead;
+  // end of the running window, exclusive
+  uint64_t m_windowEnd;
+  // number of windows started, its parity selects the mailboxes
+  std::atomic<uint64_t> m_window;
+  std::atomic<uint32_t> m_finished;
+  std::atomic<bool> m_done;
+  std::atomic<bool> m_stop;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
@@ -0,0 +1,223 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/config.h"
+#include "ns3/nstime.h"
+#include "ns3/node.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/error-model.h"
+#include "ns3/multithreaded-simulator-impl.h"
+
+#include <vector>
+
+namespace ns3 {
+
+// the partitions only run in parallel across point-to-point links with a delay
+class MtpTestChannel : public SimpleChannel
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::MtpTestChannel")
+      .SetParent<SimpleChannel> ()
+      .AddConstructor<MtpTestChannel> ()
+      .AddAttribute ("Delay", "The delay of the link",
+                     TimeValue (MicroSeconds (1)),
+                     MakeTimeAccessor (&MtpTestChannel::m_delay),
+                     MakeTimeChecker ())
+    ;
+    return tid;
+  }
+private:
+  Time m_delay;
+};
+
+class MtpTestNetDevice : public SimpleNetDevice
+{
+public:
+  virtual bool IsPointToPoint (void) const
+  {
+    return true;
+  }
+};
+
+class MultithreadedSimulatorTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorTestCase ();
+  virtual void DoRun (void);
+
+private:
+  struct Record
+  {
+    uint64_t ts;
+    uint32_t context;
+    uint32_t value;
+  };
+  static void Sink (void *object, const void *data, uint32_t size);
+  void Trace (uint32_t value);
+  void Tick (uint32_t value);
+  void Global (uint32_t value);
+  std::vector<Record> RunOnce (std::string impl, uint32_t partitions);
+
+  static const uint32_t m_nNodes = 8;
+  // random state of each node, only used by the events of that node
+  uint32_t m_state[m_nNodes];
+  std::vector<Record> m_trace;
+};
+
+MultithreadedSimulatorTestCase::MultithreadedSimulatorTestCase ()
+  : TestCase ("Check that the multithreaded simulator runs the events of the sequential one in the same order")
+{
+}
+
+void
+MultithreadedSimulatorTestCase::Sink (void *object, const void *data, uint32_t size)
+{
+  static_cast<std::vector<Record> *> (object)->push_back (*static_cast<const Record *> (data));
+}
+
+void
+MultithreadedSimulatorTestCase::Trace (uint32_t value)
+{
+  Record r;
+  r.ts = Simulator::Now ().GetTimeStep ();
+  r.context = Simulator::GetContext ();
+  r.value = value;
+  MultithreadedSimulatorImpl::Write (&MultithreadedSimulatorTestCase::Sink, &m_trace, &r, sizeof (r));
+}
+
+void
+MultithreadedSimulatorTestCase::Tick (uint32_t value)
+{
+  Trace (value);
+  if (Simulator::Now () >= MicroSeconds (30))
+    {
+      return;
+    }
+  // every tick schedules the next one, on the same node or a neighbour,
+  // on whole microseconds so that many events run at the same time
+  uint32_t node = Simulator::GetContext ();
+  uint32_t &s = m_state[node];
+  s = s * 1103515245 + 12345;
+  uint32_t r = s >> 16;
+  switch (r % 4)
+    {
+    case 0:
+      Simulator::ScheduleNow (&MultithreadedSimulatorTestCase::Tick, this, r);
+      break;
+    case 1:
+      Simulator::Schedule (MicroSeconds (1), &MultithreadedSimulatorTestCase::Tick, this, r);
+      break;
+    case 2:
+      Simulator::ScheduleWithContext ((node + 1) % m_nNodes, MicroSeconds (1), &MultithreadedSimulatorTestCase::Tick, this, r);
+      break;
+    default:
+      Simulator::ScheduleWithContext ((node + m_nNodes - 1) % m_nNodes, MicroSeconds (2), &MultithreadedSimulatorTestCase::Tick, this, r);
+      break;
+    }
+}
+
+void
+MultithreadedSimulatorTestCase::Global (uint32_t value)
+{
+  // runs while the partitions are stopped, and may schedule events on any node
+  Trace (value);
+  Simulator::ScheduleWithContext (value % m_nNodes, MicroSeconds (0), &MultithreadedSimulatorTestCase::Tick, this, value);
+}
+
+std::vector<MultithreadedSimulatorTestCase::Record>
+MultithreadedSimulatorTestCase::RunOnce (std::string impl, uint32_t partitions)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (impl));
+  m_trace.clear ();
+
+  // a ring of nodes, the neighbours in different partitions
+  std::vector<Ptr<Node> > nodes;
+  for (uint32_t i = 0; i < m_nNodes; i++)
+    {
+      nodes.push_back (CreateObject<Node> (i % partitions));
+    }
+  for (uint32_t i = 0; i < m_nNodes; i++)
+    {
+      Ptr<MtpTestChannel> channel = CreateObject<MtpTestChannel> ();
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<MtpTestNetDevice> device = CreateObject<MtpTestNetDevice> ();
+          device->SetChannel (channel);
+          nodes[(i + j) % m_nNodes]->AddDevice (device);
+        }
+    }
+
+  for (uint32_t i = 0; i < m_nNodes; i++)
+    {
+      m_state[i] = i + 1;
+      for (uint32_t j = 0; j < 3; j++)
+        {
+          Simulator::ScheduleWithContext (i, MicroSeconds (j % 2), &MultithreadedSimulatorTestCase::Tick, this, j);
+        }
+    }
+  for (uint32_t t = 0; t <= 30; t += 5)
+    {
+      Simulator::Schedule (MicroSeconds (t), &MultithreadedSimulatorTestCase::Global, this, t);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return m_trace;
+}
+
+void
+MultithreadedSimulatorTestCase::DoRun (void)
+{
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::OrderByContext", BooleanValue (true));
+  std::vector<Record> sequential = RunOnce ("ns3::DefaultSimulatorImpl", 1);
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::OrderByContext", BooleanValue (false));
+  NS_TEST_ASSERT_MSG_GT (sequential.size (), 500u, "Too few events to compare");
+
+  for (uint32_t partitions = 1; partitions <= 4; partitions *= 2)
+    {
+      std::vector<Record> parallel = RunOnce ("ns3::MultithreadedSimulatorImpl", partitions);
+      NS_TEST_ASSERT_MSG_EQ (parallel.size (), sequential.size (), "Different number of events with " << partitions << " partitions");
+      size_t i = 0;
+      while (i < sequential.size ()
+             && parallel[i].ts == sequential[i].ts
+             && parallel[i].context == sequential[i].context
+             && parallel[i].value == sequential[i].value)
+        {
+          i++;
+        }
+      NS_TEST_EXPECT_MSG_EQ (i, sequential.size (), "Event " << i << " differs with " << partitions << " partitions");
+    }
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorTestSuite ()
+    : TestSuite ("multithreaded-simulator")
+  {
+    AddTestCase (new MultithreadedSimulatorTestCase ());
+  }
+} g_multithreadedSimulatorTestSuite;
+
+} // namespace ns3
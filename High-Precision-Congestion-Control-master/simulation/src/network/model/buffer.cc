@@ -46,7 +46,11 @@ static struct Zeroes
 namespace ns3 {
 
 
+#ifdef NS3_MTP
+thread_local uint32_t Buffer::g_recommendedStart = 0;
+#else
 uint32_t Buffer::g_recommendedStart = 0;
+#endif
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
  * keep track of 3 possible states for the g_freeList variable:
@@ -71,9 +75,17 @@ uint32_t Buffer::g_recommendedStart = 0;
 #define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
 #define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
 #define UNINITIALIZED ((Buffer::FreeList*)0)
+#ifdef NS3_MTP
+/* with multiple threads, each one recycles into its own free list, which
+ * its g_localStaticDestructor clears when the thread exits. */
+thread_local uint32_t Buffer::g_maxSize = 0;
+thread_local Buffer::FreeList *Buffer::g_freeList = 0;
+thread_local struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
+#else
 uint32_t Buffer::g_maxSize = 0;
 Buffer::FreeList *Buffer::g_freeList = 0;
 struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
+#endif
 
 Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
 {
@@ -116,6 +128,8 @@ Buffer::Create (uint32_t dataSize)
   if (IS_UNINITIALIZED (g_freeList))
     {
       g_freeList = new Buffer::FreeList ();
+      /* a thread_local destructor is only registered once the object is used */
+      (void)&g_localStaticDestructor;
     }
   else if (IS_INITIALIZED (g_freeList))
     {
@@ -1185,7 +1199,15 @@ Buffer::Iterator::GetWriteErrorMessage (void) const
   return str;
 }
 
-uint8_t* Buffer::GetBuffer() const{
+uint8_t* Buffer::GetBuffer(){
+	if (m_data->m_count > 1){
+		struct Buffer::Data *newData = Buffer::Create (m_data->m_size);
+		memcpy (newData->m_data + m_start, m_data->m_data + m_start, GetInternalSize ());
+		m_data->m_count--;
+		m_data = newData;
+		m_data->m_dirtyStart = m_start;
+		m_data->m_dirtyEnd = m_end;
+	}
 	return m_data->m_data + m_start;
 }
 
@@ -25,7 +25,7 @@
 #include <ostream>
 #include "ns3/assert.h"
 
-#define noBUFFER_FREE_LIST 1
+#define BUFFER_FREE_LIST 1
 
 namespace ns3 {
 
@@ -523,7 +523,11 @@ private:
 
   uint32_t CopyData (uint8_t *buffer, uint32_t size) const;
 
-  uint8_t* GetBuffer() const;
+  /**
+   * \returns a pointer to the first byte of the buffer, to modify it in place. Data shared with
+   * copies of the buffer is copied first (copy on write).
+   */
+  uint8_t* GetBuffer();
 
   inline Buffer (Buffer const &o);
   Buffer &operator = (Buffer const &o);
@@ -596,7 +600,11 @@ private:
    * writing data. i.e., m_start should be initialized to this 
    * value.
    */
+#ifdef NS3_MTP
+  static thread_local uint32_t g_recommendedStart;
+#else
   static uint32_t g_recommendedStart;
+#endif
 
   /* offset to the start of the virtual zero area from the start 
    * of m_data->m_data
@@ -621,10 +629,16 @@ private:
   {
     ~LocalStaticDestructor ();
   };
+#ifdef NS3_MTP
+  static thread_local uint32_t g_maxSize;
+  static thread_local FreeList *g_freeList;
+  static thread_local struct LocalStaticDestructor g_localStaticDestructor;
+#else
   static uint32_t g_maxSize;
   static FreeList *g_freeList;
   static struct LocalStaticDestructor g_localStaticDestructor;
 #endif
+#endif
 };
 
 } // namespace ns3
@@ -38,12 +38,18 @@ struct ByteTagListData {
 };
 
 #ifdef USE_FREE_LIST
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
+class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
 {
 public:
   ~ByteTagListDataFreeList ();
-} g_freeList;
+};
+#ifdef NS3_MTP
+static thread_local ByteTagListDataFreeList g_freeList;
+static thread_local uint32_t g_maxSize = 0;
+#else
+static ByteTagListDataFreeList g_freeList;
 static uint32_t g_maxSize = 0;
+#endif
 
 ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 {
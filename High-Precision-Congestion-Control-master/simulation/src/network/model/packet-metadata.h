@@ -341,10 +341,21 @@ public:
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList;
   static bool m_enable;
   static bool m_enableChecking;
 
+#ifdef NS3_MTP
+  // each thread of the multithreaded simulator recycles its own buffers
+  static thread_local DataFreeList m_freeList;
+  static thread_local bool m_freeListDestroyed;
+  static thread_local bool m_metadataSkipped;
+  static thread_local uint32_t m_maxSize;
+  static thread_local uint16_t m_chunkUid;
+#else
+  static DataFreeList m_freeList;
+  // set by the destructor of m_freeList, after which data is deallocated
+  static bool m_freeListDestroyed;
+
   // set to true when adding metadata to a packet is skipped because
   // m_enable is false; used to detect enabling of metadata in the
   // middle of a simulation, which isn't allowed.
@@ -352,6 +363,7 @@ public:
 
   static uint32_t m_maxSize;
   static uint16_t m_chunkUid;
+#endif
 
   struct Data *m_data;
   /**
@@ -26,12 +26,19 @@
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
+#define USE_FREE_LIST 1
+
 namespace ns3 {
 
 #ifdef USE_FREE_LIST
 
+#ifdef NS3_MTP
+thread_local struct PacketTagList::TagData *PacketTagList::g_free = 0;
+thread_local uint32_t PacketTagList::g_nfree = 0;
+#else
 struct PacketTagList::TagData *PacketTagList::g_free = 0;
 uint32_t PacketTagList::g_nfree = 0;
+#endif
 
 struct PacketTagList::TagData *
 PacketTagList::AllocData (void) const
@@ -41,7 +48,7 @@ PacketTagList::AllocData (void) const
   if (g_free != 0) 
     {
       retval = g_free;
-      g_free = g_free->m_next;
+      g_free = g_free->next;
       g_nfree--;
     } 
   else 
@@ -64,8 +64,13 @@ private:
   struct PacketTagList::TagData *AllocData (void) const;
   void FreeData (struct TagData *data) const;
 
+#ifdef NS3_MTP
+  static thread_local struct PacketTagList::TagData *g_free;
+  static thread_local uint32_t g_nfree;
+#else
   static struct PacketTagList::TagData *g_free;
   static uint32_t g_nfree;
+#endif
 
   struct TagData *m_next;
 };
@@ -22,13 +22,19 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include <string>
+#include <cstring>
 #include <stdarg.h>
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
 
 namespace ns3 {
 
+#ifdef NS3_MTP
+// uids are unique per thread, the system id tells the threads apart
+thread_local uint32_t Packet::m_globalUid = 0;
+#else
 uint32_t Packet::m_globalUid = 0;
+#endif
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -905,8 +911,19 @@ Ptr<Packet> Create (uint32_t a1)
 	return Ptr<Packet> (new Packet (a1), false);
 }
 
-uint8_t* Packet::GetBuffer() const{
+uint8_t* Packet::GetBuffer(){
 	return m_buffer.GetBuffer();
 }
 
+uint8_t* Packet::GrowAt(uint32_t offset, uint32_t size){
+	uint32_t orgStart = m_buffer.GetCurrentStartOffset ();
+	bool resized = m_buffer.AddAtStart (size);
+	if (resized)
+		m_byteTagList.AddAtStart (m_buffer.GetCurrentStartOffset () + size - orgStart,
+		                          m_buffer.GetCurrentStartOffset () + size);
+	uint8_t *buf = m_buffer.GetBuffer ();
+	memmove (buf, buf + size, offset);
+	return buf;
+}
+
 } // namespace ns3
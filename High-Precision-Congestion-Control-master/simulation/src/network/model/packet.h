@@ -572,7 +572,21 @@ public:
   void SetNixVector (Ptr<NixVector>);
   Ptr<NixVector> GetNixVector (void) const; 
 
-  uint8_t* GetBuffer() const;
+  /**
+   * \returns a pointer to the first byte of the packet, to modify headers in place. The
+   * packet gets its own copy of a buffer it shares with copies of it (see Buffer::GetBuffer).
+   */
+  uint8_t* GetBuffer();
+  /**
+   * \param offset the offset of the bytes to insert, from the start of the packet
+   * \param size the number of bytes to insert
+   * \returns the buffer, as GetBuffer
+   *
+   * Insert size bytes in the headers at offset: the offset bytes before them move to the front.
+   * The new bytes are undefined. The metadata do not know of them, so this may not be used
+   * with Packet::EnablePrinting.
+   */
+  uint8_t* GrowAt(uint32_t offset, uint32_t size);
 
 private:
   Packet (const Buffer &buffer, const ByteTagList &byteTagList, 
@@ -588,7 +602,11 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
+#ifdef NS3_MTP
+  static thread_local uint32_t m_globalUid;
+#else
   static uint32_t m_globalUid;
+#endif
 };
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet);
@@ -0,0 +1,89 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/test.h"
+
+namespace ns3 {
+
+/*
+ * DataRate::TxTime against the exact transmission time, computed here with a
+ * division, for the line rates of the simulations and for the odd rates the
+ * congestion control sets.
+ */
+class DataRateTxTimeTestCase : public TestCase
+{
+public:
+  DataRateTxTimeTestCase ();
+private:
+  virtual void DoRun (void);
+  void Check (DataRate rate, uint32_t bytes);
+};
+
+DataRateTxTimeTestCase::DataRateTxTimeTestCase ()
+  : TestCase ("Check DataRate::TxTime")
+{
+}
+
+void
+DataRateTxTimeTestCase::Check (DataRate rate, uint32_t bytes)
+{
+  // ps = bytes * 8e12 / bps, without overflowing for the sizes checked
+  uint64_t ps = (uint64_t)bytes * 8000000 / rate.GetBitRate () * 1000000
+    + (uint64_t)bytes * 8000000 % rate.GetBitRate () * 1000000 / rate.GetBitRate ();
+  Time exact = Time::FromInteger (ps, Time::PS);
+  Time t = rate.TxTime (bytes);
+  NS_TEST_ASSERT_MSG_EQ (t.GetTimeStep (), exact.GetTimeStep (),
+                         rate << " " << bytes << " bytes: " << t << " instead of " << exact);
+}
+
+void
+DataRateTxTimeTestCase::DoRun (void)
+{
+  uint64_t rates[] = {1000000000ULL, 10000000000ULL, 25000000000ULL, 40000000000ULL,
+                      100000000000ULL, 400000000000ULL, 7300000000ULL, 37500000000ULL,
+                      1234567891ULL, 99999999999ULL};
+  uint32_t sizes[] = {0, 1, 60, 64, 82, 1000, 1048, 1500, 4096, 9000, 65536};
+  for (uint32_t i = 0; i < sizeof (rates) / sizeof (rates[0]); i++)
+    {
+      for (uint32_t j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++)
+        {
+          Check (DataRate (rates[i]), sizes[j]);
+        }
+    }
+
+  // the fixed-point value follows the rate
+  DataRate r ("100Gb/s");
+  NS_TEST_ASSERT_MSG_EQ (r.TxTime (1000), NanoSeconds (80), "100Gb/s");
+  r /= 4;
+  NS_TEST_ASSERT_MSG_EQ (r.TxTime (1000), NanoSeconds (320), "25Gb/s");
+  r += DataRate ("15Gb/s");
+  NS_TEST_ASSERT_MSG_EQ (r.TxTime (1000), NanoSeconds (200), "40Gb/s");
+  NS_TEST_ASSERT_MSG_EQ (DataRate ().TxTime (1000), Time (0), "rate 0");
+}
+
+static class DataRateTestSuite : public TestSuite
+{
+public:
+  DataRateTestSuite ()
+    : TestSuite ("data-rate", UNIT)
+  {
+    AddTestCase (new DataRateTxTimeTestCase (), TestCase::QUICK);
+  }
+} g_dataRateTestSuite;
+
+} // namespace ns3
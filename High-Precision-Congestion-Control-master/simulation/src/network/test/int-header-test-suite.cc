@@ -0,0 +1,228 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/buffer.h"
+#include "ns3/int-header-niux.h"
+
+#include <cstring>
+
+namespace ns3 {
+
+// compare the records hinfo counts, and the path hash if it is on the wire
+static bool
+IntHeaderEqual (const MyIntHeader &a, const MyIntHeader &b)
+{
+  if (a.hinfo.buf != b.hinfo.buf)
+    {
+      return false;
+    }
+  if ((a.hinfo.flags & MyIntHeader::PATH_HASH) && a.pathHash != b.pathHash)
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < a.hinfo.nodeNum; i++)
+    {
+      if (a.iinfo[i].buf != b.iinfo[i].buf)
+        {
+          return false;
+        }
+    }
+  for (uint32_t i = 0; i < a.hinfo.depthNum; i++)
+    {
+      if (a.dinfo[i].buf != b.dinfo[i].buf)
+        {
+          return false;
+        }
+    }
+  for (uint32_t i = 0; i < a.hinfo.ratioNum; i++)
+    {
+      if (a.rinfo[i].buf != b.rinfo[i].buf)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+class IntHeaderSerializeTestCase : public TestCase
+{
+public:
+  IntHeaderSerializeTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void Check (const MyIntHeader &h, uint32_t size, std::string name);
+};
+
+IntHeaderSerializeTestCase::IntHeaderSerializeTestCase ()
+  : TestCase ("Check that MyIntHeader writes only the records it has, and reads them back")
+{
+}
+
+void
+IntHeaderSerializeTestCase::Check (const MyIntHeader &h, uint32_t size, std::string name)
+{
+  NS_TEST_ASSERT_MSG_EQ (h.GetSerializedSize (), size, name << ": size");
+
+  // through a Buffer, as the headers of a packet
+  Buffer buffer;
+  buffer.AddAtStart (size);
+  h.Serialize (buffer.Begin ());
+  MyIntHeader fromBuffer;
+  NS_TEST_EXPECT_MSG_EQ (fromBuffer.Deserialize (buffer.Begin ()), size, name << ": Deserialize size");
+  NS_TEST_EXPECT_MSG_EQ (IntHeaderEqual (h, fromBuffer), true, name << ": Deserialize");
+
+  // in place in the bytes of a packet, as the switches do; the bytes after it are left alone
+  uint8_t bytes[128];
+  memset (bytes, 0xaa, sizeof (bytes));
+  NS_TEST_EXPECT_MSG_EQ (h.Write (bytes), size, name << ": Write size");
+  NS_TEST_EXPECT_MSG_EQ (bytes[size], 0xaa, name << ": Write past the records");
+  MyIntHeader fromBytes;
+  NS_TEST_EXPECT_MSG_EQ (fromBytes.Read (bytes), size, name << ": Read size");
+  NS_TEST_EXPECT_MSG_EQ (IntHeaderEqual (h, fromBytes), true, name << ": Read");
+
+  // both write the same bytes
+  uint8_t copy[128];
+  buffer.CopyData (copy, size);
+  NS_TEST_EXPECT_MSG_EQ (memcmp (copy, bytes, size), 0, name << ": Serialize and Write differ");
+}
+
+void
+IntHeaderSerializeTestCase::DoRun (void)
+{
+  MyIntHeader empty;
+  Check (empty, 2, "empty");
+
+  MyIntHeader sampled;
+  sampled.PushRoute (3, 4);
+  sampled.PushRoute (5, 6); // only sampleNum hops are kept
+  sampled.PushDepth (3, 4, 100000, 12345, 10);
+  Check (sampled, 2 + 2 + 8, "one hop and one depth");
+
+  // every record, and the path hash
+  MyIntHeader full;
+  full.hinfo.flags = MyIntHeader::PATH_HASH | MyIntHeader::PATH_PROBE;
+  for (uint32_t i = 0; i < MyIntHeader::idNum + 1; i++)
+    {
+      full.PushRoute (i + 1, i + 2);
+      full.FoldPath (i + 1, i + 2);
+    }
+  for (uint32_t i = 0; i < MyIntHeader::maxNum + 1; i++)
+    {
+      full.PushDepth (i + 1, 1, 1000 * (i + 1), 0xfedcba98 + i, i);
+      full.PushRatio (i + 1, 1, 100 * (i + 1), 0x123456 + i, i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (full.hinfo.nodeNum, MyIntHeader::idNum, "A probe lists idNum hops");
+  NS_TEST_ASSERT_MSG_EQ (full.hinfo.depthNum, MyIntHeader::maxNum, "maxNum depth records");
+  NS_TEST_ASSERT_MSG_EQ (full.hinfo.ratioNum, MyIntHeader::maxNum, "maxNum ratio records");
+  Check (full, MyIntHeader::GetMaxSize (), "full");
+}
+
+class IntHeaderClampTestCase : public TestCase
+{
+public:
+  IntHeaderClampTestCase ();
+  virtual void DoRun (void);
+};
+
+IntHeaderClampTestCase::IntHeaderClampTestCase ()
+  : TestCase ("Check that the counts of a corrupted MyIntHeader are clamped to its arrays")
+{
+}
+
+void
+IntHeaderClampTestCase::DoRun (void)
+{
+  // 4-bit counts of 15, beyond idNum and maxNum, then more bytes than a full header has
+  headerInfo h;
+  h.nodeNum = 15;
+  h.depthNum = 15;
+  h.ratioNum = 15;
+  uint8_t bytes[256];
+  for (uint32_t i = 0; i < sizeof (bytes); i++)
+    {
+      bytes[i] = i;
+    }
+  memcpy (bytes, &h.buf, sizeof (h.buf));
+
+  MyIntHeader fromBytes;
+  NS_TEST_EXPECT_MSG_EQ (fromBytes.Read (bytes), MyIntHeader::GetMaxSize () - 2, "Read size");
+  NS_TEST_EXPECT_MSG_EQ (fromBytes.hinfo.nodeNum, MyIntHeader::idNum, "Read nodeNum");
+  NS_TEST_EXPECT_MSG_EQ (fromBytes.hinfo.depthNum, MyIntHeader::maxNum, "Read depthNum");
+  NS_TEST_EXPECT_MSG_EQ (fromBytes.hinfo.ratioNum, MyIntHeader::maxNum, "Read ratioNum");
+
+  Buffer buffer;
+  buffer.AddAtStart (sizeof (bytes));
+  buffer.Begin ().Write (bytes, sizeof (bytes));
+  MyIntHeader fromBuffer;
+  NS_TEST_EXPECT_MSG_EQ (fromBuffer.Deserialize (buffer.Begin ()), MyIntHeader::GetMaxSize () - 2, "Deserialize size");
+  NS_TEST_EXPECT_MSG_EQ (IntHeaderEqual (fromBytes, fromBuffer), true, "Read and Deserialize differ");
+}
+
+class IntHeaderDepthTestCase : public TestCase
+{
+public:
+  IntHeaderDepthTestCase ();
+  virtual void DoRun (void);
+};
+
+IntHeaderDepthTestCase::IntHeaderDepthTestCase ()
+  : TestCase ("Check the log-scale depth code of MyIntHeader")
+{
+}
+
+void
+IntHeaderDepthTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::EncodeDepth (0), 0, "An empty queue");
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::EncodeDepth (MyIntHeader::qlenUnit - 1), 0, "A queue shorter than qlenUnit");
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::DecodeDepth (0), 0, "Code 0");
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::EncodeDepth (MyIntHeader::qlenUnit), 1, "qlenUnit");
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::DecodeDepth (1), MyIntHeader::qlenUnit, "Code 1");
+  NS_TEST_EXPECT_MSG_EQ (MyIntHeader::EncodeDepth (~(uint64_t)0), 0xffff, "The largest code");
+
+  // the decoded depth is at most the queue, and within a step of the code of the queue
+  uint16_t last = 0;
+  for (uint64_t bytes = MyIntHeader::qlenUnit; bytes < ((uint64_t)1 << 34); bytes = bytes * 5 / 4 + 7)
+    {
+      uint16_t code = MyIntHeader::EncodeDepth (bytes);
+      uint64_t decoded = MyIntHeader::DecodeDepth (code);
+      NS_TEST_ASSERT_MSG_EQ ((code > last), true, "Codes do not grow with " << bytes);
+      NS_TEST_ASSERT_MSG_EQ ((decoded <= bytes), true, "Decoded depth of " << bytes);
+      NS_TEST_ASSERT_MSG_EQ (((decoded + 1) * MyIntHeader::depthBase >= bytes), true, "Precision of " << bytes);
+      last = code;
+    }
+
+  // a depth record holds the code
+  depthInfo d;
+  d.Set (1, 2, MyIntHeader::EncodeDepth (1000000), 0, 0);
+  NS_TEST_EXPECT_MSG_EQ (d.GetBytes (), MyIntHeader::DecodeDepth (d.depth), "depthInfo::GetBytes");
+}
+
+class IntHeaderTestSuite : public TestSuite
+{
+public:
+  IntHeaderTestSuite ()
+    : TestSuite ("int-header", UNIT)
+  {
+    AddTestCase (new IntHeaderSerializeTestCase ());
+    AddTestCase (new IntHeaderClampTestCase ());
+    AddTestCase (new IntHeaderDepthTestCase ());
+  }
+} g_intHeaderTestSuite;
+
+} // namespace ns3
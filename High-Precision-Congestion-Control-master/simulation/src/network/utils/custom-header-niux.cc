@@ -91,9 +91,11 @@ uint32_t MyCustomHeader::GetSerializedSize (void) const{
 
 		if (l3Prot == 0x6) // TCP, ignore optional blocks
 
-			len += 20 + 6 + 36;
+			len += 20 + 6 + tcp.ih.GetSerializedSize();
 		else if (l3Prot == 0x11) // UDP
 			len += 8;
+		else if (l3Prot == 0xFE) // PFC
+			len += 9;
 	}
 	return len;
 }
@@ -160,6 +162,16 @@ void MyCustomHeader::Serialize (Buffer::Iterator start) const{
 		  i.WriteU16(ack.pg);
 		  i.WriteU32(ack.seq);
 		  ack.ih.Serialize(i);
+		  if ((ack.flags >> 3) & 1){ // encHeader::FLAG_SACK
+			  i.Next(ack.ih.GetSerializedSize());
+			  i.WriteU16(ack.nSack);
+			  for (uint32_t j = 0; j < 2 * ack.nSack; j++)
+				  i.WriteU32(ack.sack[j]);
+		  }
+	  } else if (l3Prot == 0xFE){ // PFC
+		  i.WriteU32 (pfc.time);
+		  i.WriteU32 (pfc.qlen);
+		  i.WriteU8 (pfc.qIndex);
 	  }
   }
 }
@@ -291,6 +303,21 @@ MyCustomHeader::Deserialize (Buffer::Iterator start)
 		  l4Size = 12;
 		  if (getInt)
 			l4Size += ack.ih.Deserialize(i);
+		  ack.nSack = 0;
+		  if (getInt && ((ack.flags >> 3) & 1)){ // encHeader::FLAG_SACK
+			  i.Next(ack.ih.GetSerializedSize());
+			  ack.nSack = i.ReadU16();
+			  if (ack.nSack > 4)
+				  ack.nSack = 4;
+			  for (uint32_t j = 0; j < 2 * ack.nSack; j++)
+				  ack.sack[j] = i.ReadU32();
+			  l4Size += 2 + 8 * ack.nSack;
+		  }
+	  } else if (l3Prot == 0xFE){ // PFC
+		  pfc.time = i.ReadU32 ();
+		  pfc.qlen = i.ReadU32 ();
+		  pfc.qIndex = i.ReadU8 ();
+		  l4Size = 9;
 	  }
   }
 
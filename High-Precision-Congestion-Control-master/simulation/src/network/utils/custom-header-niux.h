@@ -97,9 +97,6 @@ public:
       uint16_t ih_pg;
 	    uint32_t ih_seq;
 
-			uint32_t ih_seq;
-			uint16_t ih_pg;
-
 			MyIntHeader ih;
 	  } tcp;
 	  struct {
@@ -114,7 +111,15 @@ public:
 	    uint16_t pg;
 	    uint32_t seq;
       MyIntHeader ih;
+      uint16_t nSack; // SACK blocks, if the encHeader::FLAG_SACK bit of flags is set
+      uint32_t sack[8]; // [start, end) pairs
     } ack;
+    // PauseHeader
+    struct {
+      uint32_t time;
+      uint32_t qlen;
+      uint8_t qIndex;
+    } pfc;
   };
 
   uint8_t GetIpv4EcnBits (void) const;
@@ -182,13 +182,48 @@ namespace ns3 {
 ATTRIBUTE_HELPER_CPP (DataRate);
 
 DataRate::DataRate ()
-  : m_bps (0)
+  : m_bps (0),
+    m_psPerByte (0),
+    m_psPerByteFrac (0)
 {
 }
 
 DataRate::DataRate(uint64_t bps)
   : m_bps (bps)
 {
+  UpdatePsPerByte ();
+}
+
+void
+DataRate::UpdatePsPerByte (void)
+{
+  if (m_bps == 0)
+    {
+      m_psPerByte = m_psPerByteFrac = 0;
+      return;
+    }
+  const uint64_t psPerSecond = 1000000000000ULL;
+  m_psPerByte = psPerSecond * 8 / m_bps;
+  uint64_t r = psPerSecond * 8 % m_bps;
+  // m_psPerByteFrac = ceil (r * 2^64 / m_bps)
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 n = (unsigned __int128)r << 64;
+  m_psPerByteFrac = n / m_bps + (n % m_bps != 0);
+#else
+  m_psPerByteFrac = 0;
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      // r < m_bps, and m_bps < 2^63 for any rate this class is used with
+      r <<= 1;
+      m_psPerByteFrac <<= 1;
+      if (r >= m_bps)
+        {
+          r -= m_bps;
+          m_psPerByteFrac |= 1;
+        }
+    }
+  m_psPerByteFrac += r != 0;
+#endif
 }
 
 bool DataRate::operator < (const DataRate& rhs) const
@@ -226,6 +261,15 @@ double DataRate::CalculateTxTime (uint32_t bytes) const
   return static_cast<double>(bytes)*8/m_bps;
 }
 
+Time DataRate::TxTime (uint32_t bytes) const
+{
+  // the fractional part is multiplied in two halves, so that nothing overflows
+  uint64_t hi = bytes * (m_psPerByteFrac >> 32);
+  uint64_t lo = bytes * (m_psPerByteFrac & 0xffffffff);
+  uint64_t ps = bytes * m_psPerByte + ((hi + (lo >> 32)) >> 32);
+  return Time::FromInteger (ps, Time::PS);
+}
+
 uint64_t DataRate::GetBitRate () const
 {
   return m_bps;
@@ -238,6 +282,7 @@ DataRate::DataRate (std::string rate)
     {
       NS_FATAL_ERROR ("Could not parse rate: "<<rate);
     }
+  UpdatePsPerByte ();
 }
 
 std::ostream &operator << (std::ostream &os, const DataRate &rate)
@@ -262,12 +307,14 @@ std::istream &operator >> (std::istream &is, DataRate &rate)
 DataRate& DataRate::operator/=(const double& c)
 {
 	m_bps /= c;
+	UpdatePsPerByte ();
 	return *this;
 };
 
 DataRate& DataRate::operator+=(const DataRate& r)
 {
 	m_bps += r.m_bps;
+	UpdatePsPerByte ();
 	return *this;
 };
 
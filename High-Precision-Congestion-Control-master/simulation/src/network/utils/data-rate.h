@@ -102,6 +102,18 @@ public:
    */
   double CalculateTxTime (uint32_t bytes) const;
 
+  /**
+   * \brief Calculate transmission time
+   *
+   * Same as Seconds (CalculateTxTime (bytes)), in integer arithmetic: the
+   * picoseconds per byte are precomputed as a fixed-point value when the
+   * rate is set, so this is a multiplication. The exact time is truncated to
+   * the picosecond, then to the time resolution, and a rate of 0 gives 0.
+   * \param bytes The number of bytes (not bits) for which to calculate
+   * \return The transmission time for the number of bytes specified
+   */
+  Time TxTime (uint32_t bytes) const;
+
   /**
    * Get the underlying bitrate
    * \return The underlying bitrate in bits per second
@@ -109,7 +121,13 @@ public:
   uint64_t GetBitRate () const;
 
 private:
+  void UpdatePsPerByte (void);
+
   uint64_t m_bps;
+  // picoseconds per byte, 8e12 / m_bps, as an integer part and 64 fractional
+  // bits rounded up: exact enough that TxTime is the floor of the exact time
+  uint64_t m_psPerByte;
+  uint64_t m_psPerByteFrac;
   static uint64_t Parse (const std::string);
 };
 
@@ -1,10 +1,33 @@
+#include <cmath>
+#include <cstring>
+#include "ns3/simulator.h"
 #include "int-header-niux.h"
 
 namespace ns3 {
 
+const double MyIntHeader::depthBase = 1.0003;
+
+namespace {
+const double logDepthBase = std::log(MyIntHeader::depthBase);
+
+// the 4-bit counts of a header read from a packet could exceed the arrays
+void ClampCounts(headerInfo &h) {
+	if (h.nodeNum > MyIntHeader::idNum)
+		h.nodeNum = MyIntHeader::idNum;
+	if (h.depthNum > MyIntHeader::maxNum)
+		h.depthNum = MyIntHeader::maxNum;
+	if (h.ratioNum > MyIntHeader::maxNum)
+		h.ratioNum = MyIntHeader::maxNum;
+}
+}
+
+uint64_t depthInfo::GetBytes() const {
+	return MyIntHeader::DecodeDepth(depth);
+}
+
 MyIntHeader::MyIntHeader() {
 	hinfo.buf = 0;
-	hinfo.totalLength = 9;
+	pathHash = 0;
 	for (int i = 0; i < idNum; ++i)
 		iinfo[i].buf = 0;
 	for (int i = 0; i < maxNum; ++i) {
@@ -13,25 +36,57 @@ MyIntHeader::MyIntHeader() {
 	}
 }
 
-uint32_t MyIntHeader::GetStaticSize() {
-	return sizeof(hinfo)+sizeof(idInfo)+sizeof(dinfo)+sizeof(rinfo);
+uint32_t MyIntHeader::GetMaxSize() {
+	return sizeof(headerInfo) + sizeof(uint16_t) + sizeof(idInfo) * idNum + sizeof(depthInfo) * maxNum + sizeof(ratioInfo) * maxNum;
+}
+
+uint32_t MyIntHeader::GetSerializedSize() const {
+	return sizeof(hinfo) + ((hinfo.flags & PATH_HASH) ? sizeof(pathHash) : 0)
+		+ sizeof(idInfo) * hinfo.nodeNum + sizeof(depthInfo) * hinfo.depthNum + sizeof(ratioInfo) * hinfo.ratioNum;
+}
+
+uint16_t MyIntHeader::EncodeDepth(uint64_t bytes) {
+	if (bytes < qlenUnit)
+		return 0;
+	double code = 1 + std::log((double)bytes / qlenUnit) / logDepthBase;
+	return code < 0xffff ? (uint16_t)code : 0xffff;
+}
+
+uint64_t MyIntHeader::DecodeDepth(uint16_t code) {
+	if (code == 0)
+		return 0;
+	return (uint64_t)(qlenUnit * std::pow(depthBase, code - 1));
+}
+
+uint64_t MyIntHeader::GetTime(uint32_t ts) {
+	uint64_t now = Simulator::Now().GetTimeStep();
+	return now - ((now - ts) & tsMask);
 }
 
 void MyIntHeader::PushRoute(uint8_t _id, uint8_t _port) {
-	if (hinfo.nodeNum < idNum)
-		if (rand()%4 == 0)
-			iinfo[hinfo.nodeNum++].Set(_id, _port);
+	// the caller samples the hops to record, a probe records them all
+	if (hinfo.nodeNum < ((hinfo.flags & PATH_PROBE) ? idNum : sampleNum))
+		iinfo[hinfo.nodeNum++].Set(_id, _port);
+}
+
+void MyIntHeader::FoldPath(uint8_t _id, uint8_t _port) {
+	uint32_t h = (pathHash ^ (_id << 8 | _port)) * 0x9e3779b1u;
+	pathHash = h >> 16;
 }
 
-int MyIntHeader::PushDepth(uint8_t _id, uint8_t _port, uint16_t _depth, uint32_t _ts, uint8_t _maxRate) {
-	_depth = _depth / qlenUnit;
-	_depth = (_depth < 0xffff)? _depth : 0xffff;
-	
-	if (_depth <= 0) {
+int MyIntHeader::PushDepth(uint8_t _id, uint8_t _port, uint64_t _bytes, uint64_t _ts, uint8_t _maxRate) {
+	uint16_t depth = EncodeDepth(_bytes);
+	if (depth == 0) {
 		return -1;
 	}
-	else if (hinfo.depthNum < maxNum) {
-		dinfo[hinfo.depthNum++].Set(_id, _port, _depth, _ts, _maxRate);
+	depthInfo d;
+	d.Set(_id, _port, depth, _ts & tsMask, _maxRate);
+	return AddDepth(d);
+}
+
+int MyIntHeader::AddDepth(const depthInfo &d) {
+	if (hinfo.depthNum < maxNum) {
+		dinfo[hinfo.depthNum++] = d;
 		return 1;
 	}
 	else {
@@ -43,17 +98,23 @@ int MyIntHeader::PushDepth(uint8_t _id, uint8_t _port, uint16_t _depth, uint32_t
 				min_idx = i;
 			}
 		}
-		if (_depth > min_depth) {
-			dinfo[min_idx].Set(_id, _port, _depth, _ts, _maxRate);
+		if (d.depth > min_depth) {
+			dinfo[min_idx] = d;
 			return 1;
 		}
 		return 0;
 	}
 }
 
-int MyIntHeader::PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t _ts, uint8_t _maxRate) {
+int MyIntHeader::PushRatio(uint8_t _id, uint8_t _port, uint64_t _ratio, uint64_t _ts, uint8_t _maxRate) {
+	ratioInfo r;
+	r.Set(_id, _port, _ratio < 0xffff ? _ratio : 0xffff, _ts & tsMask, _maxRate);
+	return AddRatio(r);
+}
+
+int MyIntHeader::AddRatio(const ratioInfo &r) {
 	if (hinfo.ratioNum < maxNum) {
-		rinfo[hinfo.ratioNum++].Set(_id, _port, _ratio, _ts, _maxRate);
+		rinfo[hinfo.ratioNum++] = r;
 		return 1;
 	}
 	else {
@@ -65,35 +126,119 @@ int MyIntHeader::PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t
 				min_idx = i;
 			}
 		}
-		if (_ratio > min_ratio) {
-			rinfo[min_idx].Set(_id, _port, _ratio, _ts, _maxRate);
+		if (r.ratio > min_ratio) {
+			rinfo[min_idx] = r;
 			return 1;
 		}
 		return 0;
 	}
 }
 
+void MyIntHeader::Merge(const MyIntHeader &other) {
+	for (uint32_t j = 0; j < other.hinfo.depthNum; ++j) {
+		const depthInfo &d = other.dinfo[j];
+		uint32_t i = 0;
+		while (i < hinfo.depthNum && dinfo[i].iinfo.buf != d.iinfo.buf)
+			++i;
+		if (i == hinfo.depthNum)
+			AddDepth(d);
+		else if (d.depth >= dinfo[i].depth) // the later record of the same queue depth
+			dinfo[i] = d;
+	}
+	for (uint32_t j = 0; j < other.hinfo.ratioNum; ++j) {
+		const ratioInfo &r = other.rinfo[j];
+		uint32_t i = 0;
+		while (i < hinfo.ratioNum && rinfo[i].iinfo.buf != r.iinfo.buf)
+			++i;
+		if (i == hinfo.ratioNum)
+			AddRatio(r);
+		else if (r.ratio >= rinfo[i].ratio)
+			rinfo[i] = r;
+	}
+	if (other.hinfo.flags & PATH_PROBE) { // the hops of a probe are the path of its hash
+		hinfo.flags = other.hinfo.flags;
+		pathHash = other.pathHash;
+		hinfo.nodeNum = other.hinfo.nodeNum;
+		for (uint32_t j = 0; j < other.hinfo.nodeNum; ++j)
+			iinfo[j] = other.iinfo[j];
+		return;
+	}
+	if ((other.hinfo.flags & PATH_HASH) && !(hinfo.flags & PATH_PROBE)) {
+		hinfo.flags |= PATH_HASH;
+		pathHash = other.pathHash;
+	}
+	for (uint32_t j = 0; j < other.hinfo.nodeNum; ++j)
+		PushRoute(other.iinfo[j].id, other.iinfo[j].port);
+}
+
+uint32_t MyIntHeader::GetMaxDepth() const {
+	uint32_t depth = 0;
+	for (uint32_t i = 0; i < hinfo.depthNum; ++i)
+		if (dinfo[i].depth > depth)
+			depth = dinfo[i].depth;
+	return DecodeDepth(depth);
+}
+
 void MyIntHeader::Serialize (Buffer::Iterator start) const{
 	Buffer::Iterator i = start;
 	i.WriteU16(hinfo.buf);
-	for (int j = 0; j < idNum; ++j)
+	if (hinfo.flags & PATH_HASH)
+		i.WriteU16(pathHash);
+	for (int j = 0; j < hinfo.nodeNum; ++j)
 		i.WriteU16(iinfo[j].buf);
-	for (int j = 0; j < maxNum; ++j)
+	for (int j = 0; j < hinfo.depthNum; ++j)
 		i.WriteU64(dinfo[j].buf);
-	for (int j = 0; j < maxNum; ++j)
+	for (int j = 0; j < hinfo.ratioNum; ++j)
 		i.WriteU64(rinfo[j].buf);
 }
 
 uint32_t MyIntHeader::Deserialize (Buffer::Iterator start){
 	Buffer::Iterator i = start;
+	*this = MyIntHeader();
 	hinfo.buf = i.ReadU16();
-	for (int j = 0; j < idNum; ++j)
+	ClampCounts(hinfo);
+	if (hinfo.flags & PATH_HASH)
+		pathHash = i.ReadU16();
+	for (int j = 0; j < hinfo.nodeNum; ++j)
 		iinfo[j].buf = i.ReadU16();
-	for (int j = 0; j < maxNum; ++j)
+	for (int j = 0; j < hinfo.depthNum; ++j)
 		dinfo[j].buf = i.ReadU64();
-	for (int j = 0; j < maxNum; ++j)
+	for (int j = 0; j < hinfo.ratioNum; ++j)
 		rinfo[j].buf = i.ReadU64();
-	return sizeof(hinfo)+sizeof(iinfo)+sizeof(dinfo)+sizeof(rinfo);
+	return GetSerializedSize();
+}
+
+// the Buffer::Iterator writes little endian, as these copies do on the hosts the simulation runs on
+uint32_t MyIntHeader::Read(const uint8_t *buf){
+	*this = MyIntHeader();
+	memcpy(&hinfo.buf, buf, sizeof(hinfo));
+	buf += sizeof(hinfo);
+	ClampCounts(hinfo);
+	if (hinfo.flags & PATH_HASH) {
+		memcpy(&pathHash, buf, sizeof(pathHash));
+		buf += sizeof(pathHash);
+	}
+	memcpy(iinfo, buf, sizeof(idInfo) * hinfo.nodeNum);
+	buf += sizeof(idInfo) * hinfo.nodeNum;
+	memcpy(dinfo, buf, sizeof(depthInfo) * hinfo.depthNum);
+	buf += sizeof(depthInfo) * hinfo.depthNum;
+	memcpy(rinfo, buf, sizeof(ratioInfo) * hinfo.ratioNum);
+	return GetSerializedSize();
+}
+
+uint32_t MyIntHeader::Write(uint8_t *buf) const{
+	memcpy(buf, &hinfo.buf, sizeof(hinfo));
+	buf += sizeof(hinfo);
+	if (hinfo.flags & PATH_HASH) {
+		memcpy(buf, &pathHash, sizeof(pathHash));
+		buf += sizeof(pathHash);
+	}
+	memcpy(buf, iinfo, sizeof(idInfo) * hinfo.nodeNum);
+	buf += sizeof(idInfo) * hinfo.nodeNum;
+	memcpy(buf, dinfo, sizeof(depthInfo) * hinfo.depthNum);
+	buf += sizeof(depthInfo) * hinfo.depthNum;
+	memcpy(buf, rinfo, sizeof(ratioInfo) * hinfo.ratioNum);
+	return GetSerializedSize();
 }
 
 }
@@ -7,11 +7,16 @@
 
 namespace ns3 {
 
+// On the wire the INT is hinfo, the path hash if flags has PATH_HASH, and the records hinfo counts
+// only: a packet a switch has not pushed to carries 2 bytes. The switches update it in place in the
+// packet buffer (Read, push, Write), growing the packet by the records they add
+// (SwitchNode::SwitchNotifyDequeue).
+
 class headerInfo {
 public:
 	union {
 		struct {
-			uint16_t totalLength: 4,	// total length of this header in packet
+			uint16_t flags: 4,	// MyIntHeader::PATH_HASH, PATH_PROBE
 							 nodeNum: 4,	// nodes count for routing
 							 depthNum: 4,	// nodes count for depth info
 							 ratioNum: 4;	// nodes count for ratio info
@@ -20,7 +25,7 @@ public:
 	};
 
 	headerInfo() {
-		totalLength = 9;
+		flags = 0;
 		nodeNum = 0;
 		depthNum = 0;
 		ratioNum = 0;
@@ -49,8 +54,8 @@ public:
 	union {
 		struct {
 			idInfo iinfo;
-			uint16_t depth;
-			uint32_t ts: 24,
+			uint16_t depth;	// log-scale code of the queue length, see MyIntHeader::EncodeDepth
+			uint32_t ts: 24,	// the time in ns modulo 2^24, see MyIntHeader::GetTime
 							 maxRate: 8;
 		};
 		uint64_t buf;
@@ -61,6 +66,7 @@ public:
 		ts = _ts;
 		maxRate = _maxRate;
 	}
+	uint64_t GetBytes() const; // the queue length
 };
 
 class ratioInfo {
@@ -68,7 +74,7 @@ public:
 	union {
 		struct {
 			idInfo iinfo;
-			uint16_t ratio;
+			uint16_t ratio;	// rate over max rate, in 1/10000
 			uint32_t ts: 24,
 							 maxRate: 8;
 		};
@@ -84,27 +90,61 @@ public:
 
 class MyIntHeader {
 public:
-	static const uint32_t idNum = 1;
+	static const uint32_t idNum = 8; // hops a path probe lists
+	static const uint32_t sampleNum = 1; // hops the switches sample into the other packets
 	static const uint32_t maxNum = 2;
 
+	// Path-identifier mode: every switch folds its (id, port) into pathHash instead of sampling it
+	// into iinfo, and a probe, once per flow, also lists the hops in iinfo. The ENC node learns the
+	// path of a flow from its probe, and tells a new path by the hash of the other packets.
+	enum {
+		PATH_HASH = 1,
+		PATH_PROBE = 2
+	};
+
 	// headerInfo: 2 Bytes
 	headerInfo hinfo;
-	// idInfo: 2*1 = 2 Bytes
+	// path hash: 2 Bytes with PATH_HASH
+	uint16_t pathHash;
+	// idInfo: 2*nodeNum, Max 2*8 = 16 Bytes
 	idInfo iinfo[idNum];
-	// depthInfo: Max 8*2 = 16 Bytes
+	// depthInfo: 8*depthNum, Max 8*2 = 16 Bytes
 	depthInfo dinfo[maxNum];
-	// ratioInfo: Max 8*2 = 16 Bytes
+	// ratioInfo: 8*ratioNum, Max 8*2 = 16 Bytes
 	ratioInfo rinfo[maxNum];
 
+	// The depth is coded on a log scale, as PINT does: code c > 0 is a queue of
+	// qlenUnit * depthBase^(c-1) bytes, rounded down, which covers 28 GB at 0.03% precision.
+	// A queue shorter than qlenUnit is not recorded.
 	static const uint32_t qlenUnit = 80;
+	static const double depthBase;
+	static const uint32_t tsMask = 0xffffff;
 
 	MyIntHeader();
-	static uint32_t GetStaticSize();
+	static uint32_t GetMaxSize();
+	uint32_t GetSerializedSize() const;
+	static uint16_t EncodeDepth(uint64_t bytes);
+	static uint64_t DecodeDepth(uint16_t code);
+	// the time a record was taken at, from its 24 bits of ns: records are younger than 16.7 ms
+	static uint64_t GetTime(uint32_t ts);
 	void PushRoute(uint8_t _id, uint8_t _port);
-	int PushDepth(uint8_t _id, uint8_t _port, uint16_t _depth, uint32_t _ts, uint8_t _maxRate);
-	int PushRatio(uint8_t _id, uint8_t _port, uint16_t _ratio, uint32_t _ts, uint8_t _maxRate);
+	void FoldPath(uint8_t _id, uint8_t _port);
+	int PushDepth(uint8_t _id, uint8_t _port, uint64_t _bytes, uint64_t _ts, uint8_t _maxRate);
+	int PushRatio(uint8_t _id, uint8_t _port, uint64_t _ratio, uint64_t _ts, uint8_t _maxRate);
+	// Add the records of another packet of the same flow, keeping the deepest queues and the highest
+	// ratios as the Push functions do. A hop in both keeps its larger record. The hops of a probe
+	// replace the sampled ones.
+	void Merge(const MyIntHeader &other);
+	uint32_t GetMaxDepth() const; // the deepest queue reported, in bytes
 	void Serialize (Buffer::Iterator start) const;
 	uint32_t Deserialize (Buffer::Iterator start);
+	// the same from and to the bytes of a packet, returning the size
+	uint32_t Read(const uint8_t *buf);
+	uint32_t Write(uint8_t *buf) const;
+
+private:
+	int AddDepth(const depthInfo &d);
+	int AddRatio(const ratioInfo &r);
 };
 
 }
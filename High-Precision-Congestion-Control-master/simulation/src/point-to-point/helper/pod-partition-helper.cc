@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <queue>
+#include "pod-partition-helper.h"
+
+namespace ns3 {
+
+PodPartitionHelper::PodPartitionHelper(uint32_t nNodes) : m_isHost(nNodes, false), m_adj(nNodes) {}
+
+void PodPartitionHelper::SetHost(uint32_t node){
+	m_isHost[node] = true;
+}
+
+void PodPartitionHelper::AddLink(uint32_t a, uint32_t b){
+	m_adj[a].push_back(b);
+	m_adj[b].push_back(a);
+}
+
+uint32_t PodPartitionHelper::Find(uint32_t x){
+	while (m_group[x] != x){
+		m_group[x] = m_group[m_group[x]];
+		x = m_group[x];
+	}
+	return x;
+}
+
+void PodPartitionHelper::CutAbove(uint32_t level){
+	uint32_t n = m_adj.size();
+	m_group.resize(n);
+	for (uint32_t i = 0; i < n; i++)
+		m_group[i] = i;
+	for (uint32_t i = 0; i < n; i++){
+		if (m_level[i] >= level)
+			continue;
+		for (uint32_t j : m_adj[i]){
+			if (m_level[j] >= level)
+				continue;
+			uint32_t a = Find(i), b = Find(j);
+			// the lowest node id is the root, so groups do not depend on the link order
+			if (a < b)
+				m_group[b] = a;
+			else if (b < a)
+				m_group[a] = b;
+		}
+	}
+}
+
+std::vector<uint32_t> PodPartitionHelper::Partition(uint32_t n){
+	uint32_t nNodes = m_adj.size();
+	std::vector<uint32_t> sid(nNodes, 0);
+	if (n <= 1)
+		return sid;
+
+	// hops to the nearest host
+	m_level.assign(nNodes, UINT32_MAX);
+	std::queue<uint32_t> q;
+	for (uint32_t i = 0; i < nNodes; i++)
+		if (m_isHost[i]){
+			m_level[i] = 0;
+			q.push(i);
+		}
+	uint32_t maxLevel = 0;
+	while (!q.empty()){
+		uint32_t u = q.front();
+		q.pop();
+		maxLevel = std::max(maxLevel, m_level[u]);
+		for (uint32_t v : m_adj[u])
+			if (m_level[v] == UINT32_MAX){
+				m_level[v] = m_level[u] + 1;
+				q.push(v);
+			}
+	}
+	// nodes without a path to a host are cut off with the top layer
+	for (uint32_t i = 0; i < nNodes; i++)
+		if (m_level[i] == UINT32_MAX)
+			m_level[i] = maxLevel + 1;
+
+	// cut off layers from the top until there are enough groups
+	uint32_t cut = std::max(maxLevel, 1u);
+	uint32_t nGroups;
+	while (true){
+		CutAbove(cut);
+		nGroups = 0;
+		for (uint32_t i = 0; i < nNodes; i++)
+			if (m_level[i] >= cut || Find(i) == i)
+				nGroups++;
+		if (nGroups >= n || cut == 1)
+			break;
+		cut--;
+	}
+
+	// the nodes of each group, groups in the order of their lowest node id
+	std::vector<std::vector<uint32_t> > groups;
+	std::vector<uint32_t> groupOf(nNodes);
+	for (uint32_t i = 0; i < nNodes; i++){
+		uint32_t root = m_level[i] >= cut ? i : Find(i);
+		if (root == i){
+			groupOf[i] = groups.size();
+			groups.push_back(std::vector<uint32_t>());
+		}
+		groups[groupOf[root]].push_back(i);
+	}
+
+	// largest group first, to the least loaded partition
+	std::vector<uint32_t> order(groups.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&groups](uint32_t a, uint32_t b){
+		return groups[a].size() > groups[b].size();
+	});
+	std::vector<uint32_t> load(n, 0);
+	for (uint32_t g : order){
+		uint32_t p = std::min_element(load.begin(), load.end()) - load.begin();
+		load[p] += groups[g].size();
+		for (uint32_t node : groups[g])
+			sid[node] = p;
+	}
+	return sid;
+}
+
+} // namespace ns3
@@ -0,0 +1,41 @@
+#ifndef POD_PARTITION_HELPER_H
+#define POD_PARTITION_HELPER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/*
+ * Split a topology into partitions for the multithreaded simulator.
+ *
+ * Nodes are layered by their hop distance to the nearest host. The top
+ * layer is cut off, and the connected groups left below it (the pods of a
+ * fat-tree) are kept whole; if there are fewer groups than partitions, the
+ * next layer is cut off as well (down to racks). Groups are then assigned,
+ * largest first, to the least loaded partition, and the cut-off switches
+ * are spread one by one. Only links between a group and a cut-off switch
+ * cross partitions, so the lookahead is the delay of those links.
+ * The result depends only on the topology.
+ */
+class PodPartitionHelper{
+public:
+	PodPartitionHelper(uint32_t nNodes);
+	void SetHost(uint32_t node);
+	void AddLink(uint32_t a, uint32_t b);
+	// the system id of each node, below n
+	std::vector<uint32_t> Partition(uint32_t n);
+
+private:
+	uint32_t Find(uint32_t x);
+	void CutAbove(uint32_t level);
+
+	std::vector<bool> m_isHost;
+	std::vector<std::vector<uint32_t> > m_adj;
+	std::vector<uint32_t> m_level; // hops to the nearest host
+	std::vector<uint32_t> m_group; // union-find parent of the nodes below the cut
+};
+
+} // namespace ns3
+
+#endif /* POD_PARTITION_HELPER_H */
@@ -7,135 +7,13 @@
 
 NS_LOG_COMPONENT_DEFINE("encHeader");
 
-namespace ns3 {#include <stdint.h>
-#include <iostream>
-#include "enc-header.h"
-#include "ns3/buffer.h"
-#include "ns3/address-utils.h"
-#include "ns3/log.h"
-
-NS_LOG_COMPONENT_DEFINE("encHeader");
-
 namespace ns3 {
 
-	NS_OBJECT_ENSURE_REGISTERED(encHeader);
-
-	encHeader::encHeader()
-		:  sport(0), dport(0), flags(0), m_pg(0)
-	{}
-
-	encHeader::~encHeader()
-	{}
-
-	void encHeader::SetSport(uint32_t _sport){
-		sport = _sport;
-	}
-	void encHeader::SetDport(uint32_t _dport){
-		dport = _dport;
-	}
-
-	void encHeader::SetPG(uint16_t pg)
-	{
-		m_pg = pg;
-	}
-
-	void encHeader::SetSeq(uint32_t seq)
-	{
-		m_seq = seq;
-	}
-
-	void encHeader::SetFlags(uint16_t _flags) {
-        flags |= _flags;
-    }
-
-	void encHeader::SetMyIntHeader(const MyIntHeader &_ih){
-		ih = _ih;
-	}
-
-	void encHeader::SetFin(bool fin) {
-		uint16_t flag = 2?0:fin;
-		encHeader::SetFlags(flag);
-	}
-
-	uint16_t encHeader::GetSport() const{
-		return sport;
-	}
-	uint16_t encHeader::GetDport() const{
-		return dport;
-	}
-
-	uint16_t encHeader::GetFlags() const{
-        return flags;
-    }
-	uint16_t encHeader::GetPG() const
-	{
-		return m_pg;
-	}
-
-	uint32_t encHeader::GetSeq() const
-	{
-		return m_seq;
-	}
-
-	TypeId
-		encHeader::GetTypeId(void)
-	{
-		static TypeId tid = TypeId("ns3::encHeader")
-			.SetParent<Header>()
-			.AddConstructor<encHeader>()
-			;
-		return tid;
-	}
-	TypeId
-		encHeader::GetInstanceTypeId(void) const
-	{
-		return GetTypeId();
-	}
-	void encHeader::Print(std::ostream &os) const
-	{
-		os << "enc:" << "sport=" << sport << ",dport" << dport;
-	}
-	uint32_t encHeader::GetSerializedSize(void)  const
-	{
-		return GetBaseSize() + MyIntHeader::GetStaticSize();
-	}
-	uint32_t encHeader::GetBaseSize() {
-		encHeader tmp;
-		return sizeof(tmp.sport) + sizeof(tmp.dport) + sizeof(tmp.flags) + sizeof(tmp.m_pg) + sizeof(tmp.m_seq);
-	}
-	void encHeader::Serialize(Buffer::Iterator start)  const
-	{
-		Buffer::Iterator i = start;
-		i.WriteU16(sport);
-		i.WriteU16(dport);
-		i.WriteU16(flags);
-		i.WriteU16(m_pg);
-		i.WriteU32(m_seq);
-
-		// write MyIntHeader
-		ih.Serialize(i);
-	}
-
-	uint32_t encHeader::Deserialize(Buffer::Iterator start)
-	{
-		Buffer::Iterator i = start;
-		sport = i.ReadU16();
-		dport = i.ReadU16();
-		flags = i.ReadU16();
-		m_pg = i.ReadU16();
-		m_seq = i.ReadU32();
-
-		// read MyIntHeader
-		ih.Deserialize(i);
-		return GetSerializedSize();
-	}
-}; // namespace ns3
-
 
 	NS_OBJECT_ENSURE_REGISTERED(encHeader);
 
 	encHeader::encHeader()
-		:  sport(0), dport(0), flags(0), m_pg(0)
+		:  sport(0), dport(0), flags(0), m_pg(0), m_nSack(0)
 	{}
 
 	encHeader::~encHeader()
@@ -167,8 +45,17 @@ namespace ns3 {
 	}
 
 	void encHeader::SetFin(bool fin) {
-		uint16_t flag = 1?0:fin;
-		encHeader::SetFlags(flag);
+		if (fin)
+			flags |= 1 << FLAG_FIN;
+		else
+			flags &= ~(1 << FLAG_FIN);
+	}
+
+	void encHeader::SetSack(const uint32_t *blocks, uint32_t n) {
+		m_nSack = n < maxSack ? n : maxSack;
+		for (uint32_t j = 0; j < 2 * m_nSack; j++)
+			m_sack[j] = blocks[j];
+		flags |= 1 << FLAG_SACK;
 	}
 
 	uint16_t encHeader::GetSport() const{
@@ -211,7 +98,10 @@ namespace ns3 {
 	}
 	uint32_t encHeader::GetSerializedSize(void)  const
 	{
-		return GetBaseSize() + MyIntHeader::GetStaticSize();
+		uint32_t size = GetBaseSize() + ih.GetSerializedSize();
+		if ((flags >> FLAG_SACK) & 1)
+			size += 2 + 8 * m_nSack;
+		return size;
 	}
 	uint32_t encHeader::GetBaseSize() {
 		encHeader tmp;
@@ -228,6 +118,13 @@ namespace ns3 {
 
 		// write MyIntHeader
 		ih.Serialize(i);
+		i.Next(ih.GetSerializedSize());
+
+		if ((flags >> FLAG_SACK) & 1){
+			i.WriteU16(m_nSack);
+			for (uint32_t j = 0; j < 2 * m_nSack; j++)
+				i.WriteU32(m_sack[j]);
+		}
 	}
 
 	uint32_t encHeader::Deserialize(Buffer::Iterator start)
@@ -241,6 +138,16 @@ namespace ns3 {
 
 		// read MyIntHeader
 		ih.Deserialize(i);
+		i.Next(ih.GetSerializedSize());
+
+		m_nSack = 0;
+		if ((flags >> FLAG_SACK) & 1){
+			m_nSack = i.ReadU16();
+			if (m_nSack > maxSack)
+				m_nSack = maxSack;
+			for (uint32_t j = 0; j < 2 * m_nSack; j++)
+				m_sack[j] = i.ReadU32();
+		}
 		return GetSerializedSize();
 	}
 }; // namespace ns3
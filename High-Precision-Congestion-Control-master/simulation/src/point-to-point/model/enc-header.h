@@ -24,9 +24,15 @@ class encHeader : public Header
 {
 public:
  
+  // bits of the flags
   enum {
-	  FLAG_CNP = 0
+	  FLAG_SHARED = 0, // copied by the ENC switches from the ACK of another flow
+	  FLAG_FIN = 1,
+	  FLAG_CNP = 2, // ECN echo
+	  FLAG_SACK = 3, // selective repeat: SACK blocks follow the INT
+	  FLAG_PROBE = 4 // set by the ENC switches: they do not know the path of the hash, the sender probes it again
   };
+  enum { maxSack = 4 }; // SACK blocks in an ACK, MyCustomHeader::ack has room for as many
   encHeader (uint16_t pg);
   encHeader ();
   virtual ~encHeader ();
@@ -42,6 +48,7 @@ public:
   void SetDport(uint32_t _dport);
   void SetMyIntHeader(const MyIntHeader &_ih);
   void SetFin(bool fin);
+  void SetSack(const uint32_t *blocks, uint32_t n); // n [start, end) pairs, at most maxSack
 
 //Getters
   /**
@@ -67,6 +74,8 @@ private:
   uint16_t m_pg;
   uint32_t m_seq; // the sequence number.
   MyIntHeader ih;
+  uint16_t m_nSack;
+  uint32_t m_sack[2 * maxSack];
   
 };
 
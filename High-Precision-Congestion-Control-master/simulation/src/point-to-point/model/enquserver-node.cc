@@ -17,7 +17,10 @@
 #include "qbb-net-device.h"
 #include "ppp-header.h"
 #include "ns3/int-header-niux.h"
+#include "ns3/event-log.h"
+#include "ns3/simulator.h"
 #include <cmath>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -46,14 +49,31 @@ TypeId EnquserverNode::GetTypeId (void)
             UintegerValue(9000),
             MakeUintegerAccessor(&EnquserverNode::m_maxRtt),
             MakeUintegerChecker<uint32_t>())
+    .AddAttribute("NotifyWindow",
+            "Window in MaxRtt in which a sender is notified of a link once, 0: notify on every ACK",
+            DoubleValue(0),
+            MakeDoubleAccessor(&EnquserverNode::m_notifyWindow),
+            MakeDoubleChecker<double>(0))
+    .AddAttribute("TableTimeout",
+            "Time in MaxRtt after which a flow without ACKs leaves the shared table, 0: only on its FIN",
+            DoubleValue(0),
+            MakeDoubleAccessor(&EnquserverNode::m_tableTimeout),
+            MakeDoubleChecker<double>(0))
   ;
   return tid;
 }
 
-EnquserverNode::EnquserverNode(){
+EnquserverNode::EnquserverNode() : EnquserverNode(0) {}
+
+EnquserverNode::EnquserverNode(uint32_t systemId) : Node(systemId) {
     m_ecmpSeed = m_id;
     m_node_type = 2;
-    std::cout << "Current node type: " << m_node_type << std::endl;
+    m_notifySent = m_notifySuppressed = 0;
+    m_wheelTick = 0;
+    m_finFlows = m_agedFlows = 0;
+    m_peakFlows = 0;
+    m_pathsLearned = m_probesAsked = 0;
+    EVLOG(EVLOG_DEBUG, EvNodeCreate, m_id, m_node_type, 0, 0, 0);
     m_mmu = CreateObject<SwitchMmu>();
     // for (uint32_t i = 0; i < pCnt; i++)
     //     for (uint32_t j = 0; j < pCnt; j++)
@@ -115,64 +135,368 @@ void EnquserverNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch){
 
 //生成共享链路表操作
 
-void EnquserverNode::GetShareTable(Ptr<const Packet>p, MyCustomHeader &ch){
-    if (ch.l3Prot == 0xFC || ch.l3Prot == 0xFD) {//获取接收到的ack包中的路由id和port信息，在共享链路表对应的表项中查找，若没有，则直接添加
-        bool finFlag = (ch.ack.flags&0x2 == 2); // 用于判断流是否完成
-        if (finFlag) {
-            for (m_sharedTableEntry& p : m_sharedTable) {
-            /*p.flowInfos.erase(std::remove_if(p.flowInfos.begin(), p.flowInfos.end(),
-                                            [](const flowInfo& f) {
-                                                return f.sip == ch.dip && f.dip == ch.sip&& f.dport == ch.tcp.sport&& f.sport == ch.tcp.dport;
-                                            }),
-                                p.flowInfos.end());*/
-                for (auto f = p.flowInfos.begin(); f != p.flowInfos.end(); ) {
-                    if (f->sip == ch.dip && f->dip == ch.sip&& f->dport == ch.tcp.sport&& f->sport == ch.tcp.dport) {
-                        p.flowInfos.erase(f);
-                    }
-                    else {
-                        ++f;
-                    }
-                }
+uint32_t EnquserverNode::GetLinkKey(uint16_t rid, uint16_t port){
+    return ((uint32_t)rid << 16) | port;
+}
+
+void EnquserverNode::AddFlowToLink(uint16_t rid, uint16_t port, const flowInfo &f){
+    uint32_t key = GetLinkKey(rid, port);
+    auto it = m_sharedTable.find(key);
+    if (it == m_sharedTable.end()){
+        it = m_sharedTable.insert(std::make_pair(key, m_sharedTableEntry())).first;
+        it->second.rid = rid;
+        it->second.port = port;
+    }
+    m_sharedTableEntry &entry = it->second;
+    if (entry.flowIdx.find(f) != entry.flowIdx.end())
+        return; // 该流已经在表项中
+    entry.flowIdx[f] = entry.flowInfos.size();
+    entry.flowInfos.push_back(f); //将该数据包的四元组信息添加到对应的表项中
+    auto fl = m_flowLinks.find(f);
+    if (fl == m_flowLinks.end()){
+        fl = m_flowLinks.insert(std::make_pair(f, flowEntry())).first;
+        fl->second.lastSeen = Simulator::Now().GetTimeStep();
+        m_peakFlows = std::max(m_peakFlows, (uint32_t)m_flowLinks.size());
+        if (m_tableTimeout > 0){
+            if (!m_wheelEvent.IsRunning()){ // 时间轮从当前tick开始转
+                uint64_t tickLen = GetTickLen();
+                m_wheel.resize((uint64_t)(m_tableTimeout * m_maxRtt) / tickLen + 2);
+                m_wheelTick = Simulator::Now().GetTimeStep() / tickLen;
+                m_wheelEvent = Simulator::Schedule(NanoSeconds((m_wheelTick + 1) * tickLen) - Simulator::Now(), &EnquserverNode::AgeSharedTable, this);
             }
+            AddToWheel(f, fl->second);
         }
-        else if (ch.ack.ih.hinfo.nodeNum ==1) {
-            bool found = false;
-            for (m_sharedTableEntry& p : m_sharedTable) {
-                if (p.rid == ch.ack.ih.iinfo[0].id && p.port == ch.ack.ih.iinfo[0].port) {
-                    found = true;
-                    bool flowFound = false;
-                    for (flowInfo& info : p.flowInfos)
-                    {
-                        if (info.sip==ch.dip && info.dip==ch.sip && info.sport==ch.tcp.dport && info.dport==ch.tcp.sport)
-                        {
-                            flowFound = true;
-                            break;
-                        }
-                    }
-                    if (!flowFound)
-                    {
-                        p.flowInfos.push_back({ch.dip,ch.sip,ch.tcp.dport,ch.tcp.sport});//将该数据包的四元组信息添加到对应的表项中
-                        break; // 如果找到了，跳出循环
-                    }
+    }
+    fl->second.links.push_back(key);
+}
 
-                }
-            }
-            // 如果没找到，添加到向量中
-            if (!found) {
-                std::vector<flowInfo> info;
-                info.push_back({ch.dip,ch.sip,ch.tcp.dport,ch.tcp.sport}); //将四元组信息添加到Info中
-                m_sharedTable.push_back({ch.ack.ih.iinfo[0].id, ch.ack.ih.iinfo[0].port,info});
-            }
+uint64_t EnquserverNode::GetTickLen(){
+    return std::max((uint64_t)(m_tableTimeout * m_maxRtt) / wheelSlots, (uint64_t)1);
+}
+
+void EnquserverNode::AddToWheel(const flowInfo &f, flowEntry &e){
+    uint64_t tickLen = GetTickLen();
+    uint64_t deadline = e.lastSeen + (uint64_t)(m_tableTimeout * m_maxRtt);
+    e.tick = std::max((deadline + tickLen - 1) / tickLen, m_wheelTick + 1);
+    m_wheel[e.tick % m_wheel.size()].push_back(f);
+}
+
+void EnquserverNode::AgeSharedTable(){
+    uint64_t now = Simulator::Now().GetTimeStep();
+    uint64_t timeout = m_tableTimeout * m_maxRtt;
+    m_wheelTick++;
+    std::vector<flowInfo> slot;
+    slot.swap(m_wheel[m_wheelTick % m_wheel.size()]);
+    for (const flowInfo &f : slot){
+        auto it = m_flowLinks.find(f);
+        if (it == m_flowLinks.end() || it->second.tick != m_wheelTick)
+            continue; // 已经删除，或者已经在别的槽中
+        if (it->second.lastSeen + timeout <= now){
+            RemoveFlow(f);
+            m_agedFlows++;
+        }else
+            AddToWheel(f, it->second);
+    }
+    if (m_flowLinks.empty()){ // 表空了，时间轮停下，有流加入时再转
+        for (auto &s : m_wheel)
+            s.clear();
+    }else
+        m_wheelEvent = Simulator::Schedule(NanoSeconds(GetTickLen()), &EnquserverNode::AgeSharedTable, this);
+}
+
+void EnquserverNode::RemoveFromLinks(const flowInfo &f, flowEntry &e){
+    // 只访问该流经过的表项，用最后一个元素填补空位
+    for (uint32_t key : e.links){
+        auto it = m_sharedTable.find(key);
+        if (it == m_sharedTable.end())
+            continue;
+        m_sharedTableEntry &entry = it->second;
+        auto pos = entry.flowIdx.find(f);
+        if (pos == entry.flowIdx.end())
+            continue;
+        uint32_t idx = pos->second;
+        entry.flowIdx.erase(pos);
+        if (idx + 1 != entry.flowInfos.size()){
+            entry.flowInfos[idx] = entry.flowInfos.back();
+            entry.flowIdx[entry.flowInfos[idx]] = idx;
+        }
+        entry.flowInfos.pop_back();
+        if (entry.flowInfos.empty())
+            m_sharedTable.erase(it);
+    }
+    e.links.clear();
+}
+
+void EnquserverNode::RemoveFlow(const flowInfo &f){
+    auto links = m_flowLinks.find(f);
+    if (links == m_flowLinks.end())
+        return;
+    RemoveFromLinks(f, links->second);
+    m_flowLinks.erase(links);
+    auto state = m_notify.find(f);
+    if (state != m_notify.end()){
+        Simulator::Cancel(state->second.flush); // 流已结束，不再发送被抑制的记录
+        m_notify.erase(state);
+    }
+}
+
+// 路径探测包列出了流经过的每条链路：流换了路径时先从旧路径的表项中删除
+void EnquserverNode::LearnPath(const flowInfo &f, const MyIntHeader &ih){
+    auto it = m_flowLinks.find(f);
+    if (it != m_flowLinks.end()){
+        if (it->second.hasPath && it->second.pathHash == ih.pathHash)
+            return;
+        RemoveFromLinks(f, it->second);
+    }
+    for (uint32_t i = 0; i < ih.hinfo.nodeNum; ++i)
+        AddFlowToLink(ih.iinfo[i].id, ih.iinfo[i].port, f);
+    it = m_flowLinks.find(f);
+    if (it != m_flowLinks.end()){
+        it->second.hasPath = true;
+        it->second.pathHash = ih.pathHash;
+        m_pathsLearned++;
+    }
+}
+
+void EnquserverNode::GetShareTable(Ptr<Packet>p, MyCustomHeader &ch){
+    if (ch.l3Prot == 0xFC || ch.l3Prot == 0xFD) {//获取接收到的ack包中的路由id和port信息，在共享链路表对应的表项中查找，若没有，则直接添加
+        bool finFlag = (ch.ack.flags >> encHeader::FLAG_FIN) & 1; // 用于判断流是否完成
+        flowInfo f = {ch.dip, ch.sip, ch.ack.dport, ch.ack.sport};
+        if (finFlag) {
+            if (m_flowLinks.find(f) != m_flowLinks.end())
+                m_finFlows++;
+            RemoveFlow(f);
+        }
+        else {
+            auto it = m_flowLinks.find(f);
+            if (it != m_flowLinks.end())
+                it->second.lastSeen = Simulator::Now().GetTimeStep();
+            const MyIntHeader &ih = ch.ack.ih;
+            if (ih.hinfo.flags & MyIntHeader::PATH_PROBE)
+                LearnPath(f, ih);
+            else if (ih.hinfo.flags & MyIntHeader::PATH_HASH){
+                // 路径哈希与学到的不同：流换了路径，或者探测包没有经过本节点
+                if (it == m_flowLinks.end() || !it->second.hasPath || it->second.pathHash != ih.pathHash)
+                    AskProbe(p, ch);
+            }else if (ih.hinfo.nodeNum ==1)
+                AddFlowToLink(ih.iinfo[0].id, ih.iinfo[0].port, f);
         }
     }
     
 }
 
+uint32_t EnquserverNode::GetSharedTableSize(){
+    return m_sharedTable.size();
+}
+
+uint32_t EnquserverNode::GetSharedTableFlows(){
+    return m_flowLinks.size();
+}
+
+uint32_t EnquserverNode::GetSharedTablePeak(){
+    return m_peakFlows;
+}
+
+uint64_t EnquserverNode::GetFinFlows(){
+    return m_finFlows;
+}
+
+uint64_t EnquserverNode::GetAgedFlows(){
+    return m_agedFlows;
+}
+
+uint64_t EnquserverNode::GetPathsLearned(){
+    return m_pathsLearned;
+}
+
+uint64_t EnquserverNode::GetProbesAsked(){
+    return m_probesAsked;
+}
+
+uint64_t EnquserverNode::GetNotifySent(){
+    return m_notifySent;
+}
+
+uint64_t EnquserverNode::GetNotifySuppressed(){
+    return m_notifySuppressed;
+}
+
+namespace {
+
+// ACK中pick为真的链路的深度和速率比值记录，原样复制，不含路由信息
+template <typename Pick>
+MyIntHeader PickRecords(const MyIntHeader &from, Pick pick){
+    MyIntHeader ih;
+    for (uint32_t i = 0; i < from.hinfo.depthNum; ++i)
+        if (pick(from.dinfo[i].iinfo))
+            ih.dinfo[ih.hinfo.depthNum++] = from.dinfo[i];
+    for (uint32_t i = 0; i < from.hinfo.ratioNum; ++i)
+        if (pick(from.rinfo[i].iinfo))
+            ih.rinfo[ih.hinfo.ratioNum++] = from.rinfo[i];
+    return ih;
+}
+
+// 与Buffer::Iterator的WriteHtonU32和WriteU16字节序相同
+void WriteHtonU32(uint8_t *buf, uint32_t v){
+    buf[0] = v >> 24;
+    buf[1] = v >> 16;
+    buf[2] = v >> 8;
+    buf[3] = v;
+}
+
+void WriteU16(uint8_t *buf, uint16_t v){
+    buf[0] = v;
+    buf[1] = v >> 8;
+}
+
+} // anonymous namespace
+
+// 在转发的ACK中置FLAG_PROBE，发送方的下一个数据包重新探测路径
+void EnquserverNode::AskProbe(Ptr<Packet> p, MyCustomHeader &ch){
+    ch.ack.flags |= 1 << encHeader::FLAG_PROBE;
+    uint8_t *buf = p->GetBuffer();
+    WriteU16(&buf[PppHeader::GetStaticSize() + Ipv4Header().GetSerializedSize() + 4], ch.ack.flags); // encHeader的flags
+    m_probesAsked++;
+}
+
+//把ACK中发送方经过的链路的记录合并到一个通知中。窗口内已通知过的链路的记录先保存在pending中，
+//窗口结束时，或该发送方有新的链路要通知时，一起发送
+void EnquserverNode::NotifySender(const relatedSenderHeaderInfo &info, const MyIntHeader &ackIh){
+    auto shared = [&info](const idInfo &link){
+        for (const auto& pair : info.rIdAndPort)
+            if (pair.first == link.id && pair.second == link.port)
+                return true;
+        return false;
+    };
+    uint64_t window = m_notifyWindow * m_maxRtt;
+    if (window == 0){
+        SendNotification(info.fInfo, PickRecords(ackIh, shared));
+        return;
+    }
+    uint64_t now = Simulator::Now().GetTimeStep();
+    notifyState &state = m_notify[info.fInfo];
+    auto lastSent = [&state](const idInfo &link) -> uint64_t* {
+        uint32_t key = GetLinkKey(link.id, link.port);
+        for (auto &s : state.lastSent)
+            if (s.first == key)
+                return &s.second;
+        return NULL;
+    };
+    auto held = [&](const idInfo &link){
+        uint64_t *t = lastSent(link);
+        return t != NULL && now < *t + window;
+    };
+    MyIntHeader fresh = PickRecords(ackIh, [&](const idInfo &link){ return shared(link) && !held(link); });
+    state.pending.Merge(PickRecords(ackIh, [&](const idInfo &link){ return shared(link) && held(link); }));
+    if (fresh.hinfo.depthNum + fresh.hinfo.ratioNum == 0){
+        m_notifySuppressed++;
+        if (!state.flush.IsRunning()){ // 最早结束的窗口结束时发送
+            uint64_t end = now + window;
+            for (uint32_t i = 0; i < state.pending.hinfo.depthNum; ++i)
+                end = std::min(end, *lastSent(state.pending.dinfo[i].iinfo) + window);
+            for (uint32_t i = 0; i < state.pending.hinfo.ratioNum; ++i)
+                end = std::min(end, *lastSent(state.pending.rinfo[i].iinfo) + window);
+            state.flush = Simulator::Schedule(NanoSeconds(end - now), &EnquserverNode::FlushPending, this, info.fInfo);
+        }
+        return;
+    }
+    state.pending.Merge(fresh);
+    FlushNotification(info.fInfo);
+}
+
+void EnquserverNode::FlushNotification(flowInfo f){
+    notifyState &state = m_notify[f];
+    uint64_t now = Simulator::Now().GetTimeStep();
+    Simulator::Cancel(state.flush);
+    const MyIntHeader &ih = state.pending;
+    std::vector<uint32_t> keys;
+    for (uint32_t i = 0; i < ih.hinfo.depthNum; ++i)
+        keys.push_back(GetLinkKey(ih.dinfo[i].iinfo.id, ih.dinfo[i].iinfo.port));
+    for (uint32_t i = 0; i < ih.hinfo.ratioNum; ++i)
+        keys.push_back(GetLinkKey(ih.rinfo[i].iinfo.id, ih.rinfo[i].iinfo.port));
+    for (uint32_t key : keys){
+        uint32_t i = 0;
+        while (i < state.lastSent.size() && state.lastSent[i].first != key)
+            ++i;
+        if (i == state.lastSent.size())
+            state.lastSent.push_back(std::make_pair(key, now));
+        else
+            state.lastSent[i].second = now;
+    }
+    SendNotification(f, ih);
+    state.pending = MyIntHeader();
+}
+
+//窗口结束时由定时器发送：模板只在这一次发送中有效
+void EnquserverNode::FlushPending(flowInfo f){
+    FlushNotification(f);
+    m_notifyTemplates.clear();
+}
+
+void EnquserverNode::SendNotification(const flowInfo &f, const MyIntHeader &ih){
+    m_notifySent++;
+    std::string key((const char*)&ih.hinfo.buf, sizeof(ih.hinfo.buf));
+    for (uint32_t i = 0; i < ih.hinfo.depthNum; ++i)
+        key.append((const char*)&ih.dinfo[i].buf, sizeof(ih.dinfo[i].buf));
+    for (uint32_t i = 0; i < ih.hinfo.ratioNum; ++i)
+        key.append((const char*)&ih.rinfo[i].buf, sizeof(ih.rinfo[i].buf));
+    auto it = m_notifyTemplates.find(key);
+    if (it == m_notifyTemplates.end()){
+        it = m_notifyTemplates.insert(std::make_pair(key, notifyTemplate())).first;
+        BuildNotification(f, ih, it->second);
+        // 第一个通知的地址和端口就是模板的
+        MyCustomHeader ch = it->second.ch;
+        SendToDev(it->second.p->Copy(), ch);
+        return;
+    }
+    // 拷贝与模板共用buffer，改写时才复制（Buffer::GetBuffer）
+    Ptr<Packet> newp = it->second.p->Copy();
+    uint8_t *buf = newp->GetBuffer();
+    uint32_t ipOffset = PppHeader::GetStaticSize();
+    uint32_t encOffset = ipOffset + Ipv4Header().GetSerializedSize();
+    WriteHtonU32(&buf[ipOffset + 12], f.dip); // Ipv4Header的源地址和目的地址
+    WriteHtonU32(&buf[ipOffset + 16], f.sip);
+    WriteU16(&buf[encOffset], f.dport); // encHeader的sport和dport
+    WriteU16(&buf[encOffset + 2], f.sport);
+    MyCustomHeader newch = it->second.ch;
+    newch.sip = f.dip;
+    newch.dip = f.sip;
+    newch.ack.sport = f.dport;
+    newch.ack.dport = f.sport;
+    SendToDev(newp, newch);
+}
+
+void EnquserverNode::BuildNotification(const flowInfo &f, const MyIntHeader &ih, notifyTemplate &t){
+    encHeader encH;
+    encH.SetFlags(1);
+    encH.SetSport(f.dport);
+    encH.SetDport(f.sport);
+    encH.SetMyIntHeader(ih);
+
+    Ptr<Packet> newp = Create<Packet>(0);
+    newp->AddHeader(encH); //将ppp头部的上述信息写入到buffer中，方便后续在receive数据包时，ch从buffer中读取
+
+    Ipv4Header head;    // Prepare IPv4 header
+    head.SetDestination(Ipv4Address(f.sip));
+    head.SetSource(Ipv4Address(f.dip));
+    head.SetProtocol(0xFC); //ack=0xFC nack=0xFD
+    head.SetTtl(64);
+    head.SetPayloadSize(newp->GetSize());
+
+    newp->AddHeader(head);
+    PppHeader ppp;
+    ppp.SetProtocol (0x0021);//IPv4
+    newp->AddHeader (ppp);
+    t.ch = MyCustomHeader(MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header);
+    newp->PeekHeader(t.ch);
+    t.p = newp;
+}
+
 
 //对携带链路信息的数据包中的信息和共享链路表进行查找匹配，返回HeaderLinkInfo结构体类型中的数据
 void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device, Ptr<Packet>p, MyCustomHeader &ch){
     GetShareTable(p, ch);
-    std::cout << "node:" << m_id<< " sip:" << ch.sip << "  dip:"<< ch.dip << std::endl;
+    EVLOG(EVLOG_DEBUG, EvEncAck, m_id, ch.sip, ch.dip, ch.ack.sport, ch.ack.dport);
     // std::cout << "packet of RID: " << ch.ack.ih.iinfo[0].id << ", Port: " << ch.ack.ih.iinfo[0].port << std::endl;
     //  for (const auto& entry : m_sharedTable) {
     //     std::cout << "RID: " << entry.rid << ", Port: " << entry.port << std::endl;
@@ -188,125 +512,52 @@ void EnquserverNode::MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device,
     if (ch.ack.ih.hinfo.depthNum !=0 || ch.ack.ih.hinfo.ratioNum!=0 ){
         // std::cout<<"depthNum size:"<<ch.ack.ih.hinfo.depthNum<<std::endl;
         // std::cout<<"ratioNum size:"<<ch.ack.ih.hinfo.ratioNum<<std::endl;
-        std::vector<m_sharedTableEntry> matchedEntries;//根据从数据包获取的路由器二元组信息，和共享链路表比配，获取数据包中路由节点二元组对应的所有主机地址四元组
+        std::vector<const m_sharedTableEntry*> matchedEntries;//根据从数据包获取的路由器二元组信息，和共享链路表比配，获取数据包中路由节点二元组对应的所有主机地址四元组
         for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) {
-            for (const auto& sharedEntry : m_sharedTable) {
-                // std::cout<<"depth routerID:"<<ch.ack.ih.dinfo[i].iinfo.id<<std::endl;
-                // std::cout<<"sharedTable routerID:"<<sharedEntry.rid<<std::endl;
-                // std::cout<<"depth routerPORT:"<<ch.ack.ih.dinfo[i].iinfo.port<<std::endl;
-                // std::cout<<"sharedTable routerPORT:"<<sharedEntry.port<<std::endl;
-                if (ch.ack.ih.dinfo[i].iinfo.id == sharedEntry.rid && ch.ack.ih.dinfo[i].iinfo.port == sharedEntry.port) {
-                    matchedEntries.push_back(sharedEntry);
-
-                }
-            }
+            auto it = m_sharedTable.find(GetLinkKey(ch.ack.ih.dinfo[i].iinfo.id, ch.ack.ih.dinfo[i].iinfo.port));
+            if (it != m_sharedTable.end())
+                matchedEntries.push_back(&it->second);
         }
         for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) {
-            for (const auto& sharedEntry : m_sharedTable) {
-                if (ch.ack.ih.rinfo[i].iinfo.id == sharedEntry.rid && ch.ack.ih.rinfo[i].iinfo.port == sharedEntry.port) {
-                    matchedEntries.push_back(sharedEntry);
-                }
-            }
+            auto it = m_sharedTable.find(GetLinkKey(ch.ack.ih.rinfo[i].iinfo.id, ch.ack.ih.rinfo[i].iinfo.port));
+            if (it != m_sharedTable.end())
+                matchedEntries.push_back(&it->second);
         }
         // std::cout<<"matchedEntries size:"<<matchedEntries.size()<<std::endl;
         std::vector<relatedSenderHeaderInfo> relatedSenderHeaderInfos;
-        for (const auto& sharedEntry : matchedEntries) {
-            for (const auto& flow : sharedEntry.flowInfos) {
-                relatedSenderHeaderInfo relatedInfo;
-
-                // 设置 fInfo
-                relatedInfo.fInfo = flow;
-
-                // 查找是否已经存在对应的 rIdAndPort
-                auto it = std::find_if(
-                    relatedSenderHeaderInfos.begin(),
-                    relatedSenderHeaderInfos.end(),
-                    [flow](const relatedSenderHeaderInfo& info) {
-                        return info.fInfo == flow;
-                    }
-                );
-
+        std::unordered_map<flowInfo, uint32_t, flowInfoHash> relatedIdx; // 流在relatedSenderHeaderInfos中的下标
+        for (const m_sharedTableEntry* sharedEntry : matchedEntries) {
+            for (const auto& flow : sharedEntry->flowInfos) {
                 // 如果存在，直接添加 rIdAndPort，否则添加新的记录
-                if (it != relatedSenderHeaderInfos.end()) {
-                    
-                    it->rIdAndPort.push_back({sharedEntry.rid, sharedEntry.port});
+                auto it = relatedIdx.find(flow);
+                if (it != relatedIdx.end()) {
+                    relatedSenderHeaderInfos[it->second].rIdAndPort.push_back({sharedEntry->rid, sharedEntry->port});
                 } else {
-                    relatedInfo.rIdAndPort.push_back({sharedEntry.rid, sharedEntry.port});
+                    relatedSenderHeaderInfo relatedInfo;
+                    relatedInfo.fInfo = flow;
+                    relatedInfo.rIdAndPort.push_back({sharedEntry->rid, sharedEntry->port});
+                    relatedIdx[flow] = relatedSenderHeaderInfos.size();
                     relatedSenderHeaderInfos.push_back(relatedInfo);
                 }
             }
         }
-        // std::cout<<"relatedSenderHeaderInfos size:"<<relatedSenderHeaderInfos.size()<<std::endl;
+        EVLOG(EVLOG_DEBUG, EvEncMatch, m_id, matchedEntries.size(), relatedSenderHeaderInfos.size(), 0, 0);
         if (relatedSenderHeaderInfos.size() !=0){
             /* code */
         
         
+            bool own = false;
             for (const auto& info : relatedSenderHeaderInfos) { //需要加判断，如果sip。。。。==原数据包中的sip。。。。，则直接转发
-                std::cout<<"matchedEntries size:*******************************"<<std::endl;
                 if (info.fInfo.sip == ch.dip && info.fInfo.dip == ch.sip && info.fInfo.sport == ch.ack.dport && info.fInfo.dport == ch.ack.sport) {
-                    // 这里这个转发没有看懂是啥意思，就暂时没改ch，用给的ch去转发
-                    // SendToDev(p, info.fInfo.sip); //直接转发
                     SendToDev(p, ch);
+                    own = true;
                 }else{
-                    encHeader encH;
-            //        seqh.SetSeq(rxQp->ReceiverNextExpectedSeq);
-                    encH.SetFlags(1);
-            //        seqh.SetPG(ch.udp.pg);
-                    encH.SetSport(info.fInfo.dport);
-                    encH.SetDport(info.fInfo.sport);
-                    
-                    MyIntHeader ih;
-                    for (const auto& pair : info.rIdAndPort) {
-                        bool isFind = 0;
-                        for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i){
-                            if (pair.first == ch.ack.ih.dinfo[i].iinfo.id && pair.second == ch.ack.ih.dinfo[i].iinfo.port) {
-                                ih.PushDepth(ch.ack.ih.dinfo[i].iinfo.id,ch.ack.ih.dinfo[i].iinfo.port,ch.ack.ih.dinfo[i].depth,ch.ack.ih.dinfo[i].ts,ch.ack.ih.dinfo[i].maxRate);
-                                isFind = 1;
-                                break;
-                            }
-                        }
-                        if (isFind == 1) {
-                            break;
-                        }
-                        for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i){
-                            if (pair.first == ch.ack.ih.rinfo[i].iinfo.id && pair.second == ch.ack.ih.rinfo[i].iinfo.port) {
-                                ih.PushDepth(ch.ack.ih.rinfo[i].iinfo.id,ch.ack.ih.rinfo[i].iinfo.port,ch.ack.ih.rinfo[i].ratio,ch.ack.ih.rinfo[i].ts,ch.ack.ih.rinfo[i].maxRate);
-                                break;
-                            }
-                        }
-                    }
-                    encH.SetMyIntHeader(ih);
-            //        if (ecnbits)
-            //            seqh.SetCnp();
-
-                    Ptr<Packet> newp = Create<Packet>(0);
-                    newp->AddHeader(encH); //将ppp头部的上述信息写入到buffer中，方便后续在receive数据包时，ch从buffer中读取
-
-                    Ipv4Header head;    // Prepare IPv4 header
-                    head.SetDestination(Ipv4Address(info.fInfo.sip));
-                    head.SetSource(Ipv4Address(info.fInfo.dip));
-                    head.SetProtocol(0xFC); //ack=0xFC nack=0xFD
-                    head.SetTtl(64);
-                    head.SetPayloadSize(newp->GetSize());
-            //        head.SetIdentification(rxQp->m_ipid++);
-
-                    newp->AddHeader(head);
-                    PppHeader ppp;
-                    ppp.SetProtocol (0x0021);//IPv4
-                    newp->AddHeader (ppp);
-                    MyCustomHeader newch(MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header);
-                    newp->PeekHeader(newch);
-            //        AddHeader(newp, 0x800);    // Attach PPP header
-                    
-        //            MyCustomHeader ch(MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header);
-        //            ch.getInt = 1; // parse INT header
-        //            newp->PeekHeader(ch); //把packet中的相关信息read到ch中
-                    SendToDev(newp, newch);
-        //            uint32_t nic_idx = GetNicIdxOfRxQp(info.fInfo.dip);
-        //            m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
-        //            m_nic[nic_idx].dev->TriggerTransmit();
+                    NotifySender(info, ch.ack.ih);
                 }
             }
+            if (!own) // 该ACK的流不在匹配的表项中时也要转发
+                SendToDev(p, ch);
+            m_notifyTemplates.clear();
         }else{
             SendToDev(p, ch);
         }
@@ -374,6 +625,10 @@ void EnquserverNode::AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx){
     m_routerMap[dip] = outPort;
 }
 
+void EnquserverNode::ClearTableEntry(Ipv4Address &dstAddr){
+    m_routerMap.erase(dstAddr.Get());
+}
+
 void EnquserverNode::ClearTable(){
     m_routerMap.clear();
 }
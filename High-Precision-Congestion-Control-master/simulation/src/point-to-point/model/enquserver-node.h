@@ -10,11 +10,14 @@
 
 #include <unordered_map>
 #include <ns3/node.h>
+#include "ns3/event-id.h"
 #include "qbb-net-device.h"
 #include "enc-header.h"
 #include "switch-mmu.h"
 #include "pint.h"
 #include <vector>
+#include <tuple>
+#include <string>
 
 namespace ns3 {
 
@@ -57,10 +60,19 @@ class EnquserverNode : public Node{
     };
     
     
+    struct flowInfoHash{
+        size_t operator()(const flowInfo& f) const {
+            uint64_t a = ((uint64_t)f.sip << 32) | f.dip;
+            uint64_t b = ((uint64_t)f.sport << 16) | f.dport;
+            return std::hash<uint64_t>()(a ^ (b * 0x9e3779b97f4a7c15ull));
+        }
+    };
+    
     struct m_sharedTableEntry{
         uint16_t rid;
         uint16_t port;
         std::vector<flowInfo> flowInfos;
+        std::unordered_map<flowInfo, uint32_t, flowInfoHash> flowIdx; // 流在flowInfos中的下标，O(1)判断成员和删除
     };
     
     struct relatedSenderHeaderInfo{
@@ -68,7 +80,44 @@ class EnquserverNode : public Node{
         std::vector<std::pair<uint16_t, uint16_t>> rIdAndPort;
     };
     
-    std::vector<m_sharedTableEntry> m_sharedTable;
+    // 通知限速：每个发送方每条链路在一个窗口内只通知一次，窗口内的记录合并到一个通知中，窗口结束时发送
+    struct notifyState{
+        std::vector<std::pair<uint32_t, uint64_t>> lastSent; // 链路key，最近一次通知该链路的时间
+        MyIntHeader pending; // 窗口内被抑制的记录
+        EventId flush; // 发送pending的事件
+    };
+    
+    std::unordered_map<uint32_t, m_sharedTableEntry> m_sharedTable; // key: GetLinkKey(rid, port)
+    struct flowEntry{
+        std::vector<uint32_t> links; // 流所经过的链路key
+        uint64_t lastSeen; // 最近一次收到该流的ACK的时间
+        uint64_t tick; // 在老化时间轮中到期的tick
+        bool hasPath; // links是路径探测包列出的完整路径，MyIntHeader::PATH_PROBE
+        uint16_t pathHash; // 该路径的哈希
+    };
+    
+    std::unordered_map<flowInfo, flowEntry, flowInfoHash> m_flowLinks; // 反向索引：每条流所经过的链路，流结束时只需访问这些表项
+    // 老化：空闲超过TableTimeout的流从共享链路表中删除。所有流的超时时间相同，时间轮转一圈就覆盖了超时时间，
+    // 每个tick一个事件，只检查该tick到期的流；收到ACK时只更新lastSeen，到期时再按lastSeen放到新的槽中
+    static const uint32_t wheelSlots = 16; // 一个超时时间的tick数
+    std::vector<std::vector<flowInfo>> m_wheel; // 下标: tick % m_wheel.size()，可能有已删除或已移走的流
+    uint64_t m_wheelTick; // 最近处理的tick
+    EventId m_wheelEvent;
+    uint64_t m_finFlows; // 因FIN删除的流
+    uint64_t m_agedFlows; // 因空闲超时删除的流
+    uint32_t m_peakFlows; // 表中流数的最大值
+    uint64_t m_pathsLearned; // 从路径探测包学到的路径
+    uint64_t m_probesAsked; // 因路径哈希未知而要求发送方重新探测的ACK
+    std::unordered_map<flowInfo, notifyState, flowInfoHash> m_notify; // 只在NotifyWindow > 0时使用
+    
+    // 一个ACK的INT记录相同的通知只构造一次，其余的是它的拷贝，只改写地址和端口
+    struct notifyTemplate{
+        Ptr<Packet> p;
+        MyCustomHeader ch;
+    };
+    std::unordered_map<std::string, notifyTemplate> m_notifyTemplates; // key: INT记录的字节，处理完一个ACK或一次定时发送后清空
+    uint64_t m_notifySent; // 发出的通知数据包
+    uint64_t m_notifySuppressed; // 因窗口未结束而没有立即发出的通知
 //
 //
 //    struct HeaderLinkInfo{
@@ -89,6 +138,8 @@ protected:
     bool m_ecnEnabled;
     uint32_t m_ccMode;
     uint64_t m_maxRtt;
+    double m_notifyWindow; // in MaxRtt
+    double m_tableTimeout; // in MaxRtt
 
     uint32_t m_ackHighPrio; // set high priority for ACK/NACK
 
@@ -98,7 +149,21 @@ private:
     static uint32_t EcmpHash(const uint8_t* key, size_t len, uint32_t seed);
     void CheckAndSendPfc(uint32_t inDev, uint32_t qIndex);
     void CheckAndSendResume(uint32_t inDev, uint32_t qIndex);
-    void GetShareTable(Ptr<const Packet>p, MyCustomHeader &ch);//获取共享链路表的函数，参数为数据包包头的广域网节点ID，目的地址端口号
+    void GetShareTable(Ptr<Packet>p, MyCustomHeader &ch);//获取共享链路表的函数，参数为数据包包头的广域网节点ID，目的地址端口号
+    static uint32_t GetLinkKey(uint16_t rid, uint16_t port);
+    void AddFlowToLink(uint16_t rid, uint16_t port, const flowInfo &f);
+    void RemoveFromLinks(const flowInfo &f, flowEntry &e);
+    void RemoveFlow(const flowInfo &f);
+    void LearnPath(const flowInfo &f, const MyIntHeader &ih);
+    void AskProbe(Ptr<Packet>p, MyCustomHeader &ch);
+    uint64_t GetTickLen();
+    void AddToWheel(const flowInfo &f, flowEntry &e);
+    void AgeSharedTable();
+    void NotifySender(const relatedSenderHeaderInfo &info, const MyIntHeader &ackIh);
+    void FlushNotification(flowInfo f);
+    void FlushPending(flowInfo f); // FlushNotification的定时器
+    void SendNotification(const flowInfo &f, const MyIntHeader &ih);
+    void BuildNotification(const flowInfo &f, const MyIntHeader &ih, notifyTemplate &t);
 //    void MatchSharedTableSendToRelatedSender(Ptr<Packet>p, MyCustomHeader &ch);
     //对携带链路信息的数据包中的信息和共享链路表进行查找匹配，返回HeaderLinkInfo结构体类型中的数据
     
@@ -107,9 +172,20 @@ public:
 
     static TypeId GetTypeId (void);
     EnquserverNode();
+    EnquserverNode(uint32_t systemId);
     void SetEcmpSeed(uint32_t seed);
     void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
+    void ClearTableEntry(Ipv4Address &dstAddr); // dstAddr is unreachable
     void ClearTable();
+    uint32_t GetSharedTableSize(); // number of (router id, port) links currently tracked
+    uint32_t GetSharedTableFlows(); // number of flows currently tracked
+    uint32_t GetSharedTablePeak(); // most flows tracked at a time
+    uint64_t GetFinFlows(); // flows removed when their FIN ACK passed
+    uint64_t GetAgedFlows(); // flows removed after TableTimeout without an ACK
+    uint64_t GetPathsLearned(); // full paths learned from the probes of RdmaHw::PathHash
+    uint64_t GetProbesAsked(); // ACKs whose path hash was unknown, marked for the sender to probe again
+    uint64_t GetNotifySent(); // notifications sent to the senders sharing a link with an ACK
+    uint64_t GetNotifySuppressed(); // notifications held back by NotifyWindow, their records go out merged later
 //    bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, MyCustomHeader &ch);
     void MatchSharedTableSendToRelatedSender(Ptr<NetDevice> device, Ptr<Packet>p, MyCustomHeader &ch);
 
@@ -0,0 +1,54 @@
+#ifndef EVENT_LOG_FORMAT_H
+#define EVENT_LOG_FORMAT_H
+#include <stdint.h>
+
+namespace ns3{
+
+/*
+ * Binary event log, written by EventLog (event-log.h) and read by analysis/event_log_reader.
+ * The file is a sequence of blocks, each flushed by one thread:
+ *   EventLogBlock, then EventLogBlock::count EventLogRecord
+ */
+
+enum EventLogLevel{
+	EVLOG_ERROR = 1,
+	EVLOG_INFO = 2,
+	EVLOG_DEBUG = 3
+};
+
+enum EventLogType{
+	EvNodeCreate = 0,	// a0: node type
+	EvRxData = 1,		// a0: seq, a1: payload size, a2: INT hops, a3: sip
+	EvTxAck = 2,		// a0: ack seq, a1: sport, a2: dport, a3: fin
+	EvRxAck = 3,		// a0: seq, a1: pg, a2: dport, a3: flags
+	EvEncAck = 4,		// a0: sip, a1: dip, a2: sport, a3: dport
+	EvEncMatch = 5,		// a0: matched links, a1: related senders
+	EvMmuDrop = 6,		// a0: port, a1: qIndex, a2: headroom bytes, a3: ingress bytes
+	EvTypeN
+};
+
+static const uint32_t EVENT_LOG_MAGIC = 0x474c5645; // "EVLG"
+
+struct EventLogBlock{
+	uint32_t magic;
+	uint32_t thread;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct EventLogRecord{
+	uint64_t time; // ns
+	uint32_t node;
+	uint16_t type;
+	uint8_t level;
+	uint8_t reserved;
+	uint64_t arg[4];
+};
+
+static inline const char* EventLogTypeName(uint16_t type){
+	static const char* name[EvTypeN] = {"node", "rx-data", "tx-ack", "rx-ack", "enc-ack", "enc-match", "mmu-drop"};
+	return type < EvTypeN ? name[type] : "unknown";
+}
+
+}
+#endif /* EVENT_LOG_FORMAT_H */
@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "ns3/simulator.h"
+#include "event-log.h"
+
+namespace ns3 {
+
+uint32_t EventLog::s_level = 0;
+
+namespace {
+
+const uint32_t kBufRecords = 4096; // 192 KB per thread
+
+std::mutex g_fileMutex;
+FILE *g_file = NULL;
+std::atomic<uint32_t> g_nextThread(0);
+
+void WriteBlock(uint32_t thread, const EventLogRecord *rec, uint32_t n){
+	if (n == 0)
+		return;
+	EventLogBlock b;
+	b.magic = EVENT_LOG_MAGIC;
+	b.thread = thread;
+	b.count = n;
+	b.reserved = 0;
+	std::lock_guard<std::mutex> lock(g_fileMutex);
+	if (g_file == NULL)
+		return;
+	fwrite(&b, sizeof(b), 1, g_file);
+	fwrite(rec, sizeof(EventLogRecord), n, g_file);
+}
+
+struct ThreadBuf{
+	uint32_t thread;
+	uint32_t n;
+	std::vector<EventLogRecord> rec;
+
+	ThreadBuf() : thread(g_nextThread++), n(0), rec(kBufRecords) {}
+	~ThreadBuf(){ Flush(); }
+	void Flush(){
+		WriteBlock(thread, &rec[0], n);
+		n = 0;
+	}
+};
+
+ThreadBuf& GetThreadBuf(){
+	static thread_local ThreadBuf buf;
+	return buf;
+}
+
+} // anonymous namespace
+
+void EventLog::Open(std::string filename, uint32_t level){
+	std::lock_guard<std::mutex> lock(g_fileMutex);
+	if (g_file != NULL)
+		fclose(g_file);
+	g_file = fopen(filename.c_str(), "wb");
+	s_level = g_file != NULL ? level : 0;
+}
+
+void EventLog::Close(void){
+	Flush();
+	std::lock_guard<std::mutex> lock(g_fileMutex);
+	if (g_file != NULL)
+		fclose(g_file);
+	g_file = NULL;
+	s_level = 0;
+}
+
+void EventLog::Flush(void){
+	GetThreadBuf().Flush();
+}
+
+void EventLog::Write(uint8_t level, uint16_t type, uint32_t node, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3){
+	ThreadBuf &buf = GetThreadBuf();
+	EventLogRecord &r = buf.rec[buf.n];
+	r.time = Simulator::Now().GetTimeStep();
+	r.node = node;
+	r.type = type;
+	r.level = level;
+	r.reserved = 0;
+	r.arg[0] = a0;
+	r.arg[1] = a1;
+	r.arg[2] = a2;
+	r.arg[3] = a3;
+	if (++buf.n == kBufRecords)
+		buf.Flush();
+}
+
+} /* namespace ns3 */
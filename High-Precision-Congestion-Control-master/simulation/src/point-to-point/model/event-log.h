@@ -0,0 +1,46 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <string>
+#include "ns3/event-log-format.h"
+
+/*
+ * Structured event log for the RDMA/switch hot paths.
+ *
+ * EVLOG(level, type, node, a0, a1, a2, a3) records one EventLogRecord. Records
+ * with level > NS3_EVLOG_MAX_LEVEL compile to nothing, so with the default of 0
+ * the log has no cost at all. Configure with --event-log-level=N to keep levels
+ * 1..N, then select the file and a runtime level with EventLog::Open.
+ *
+ * Records are buffered per thread and appended to the file block by block.
+ */
+#ifndef NS3_EVLOG_MAX_LEVEL
+#define NS3_EVLOG_MAX_LEVEL 0
+#endif
+
+#if NS3_EVLOG_MAX_LEVEL > 0
+#define EVLOG(level, type, node, a0, a1, a2, a3) \
+	do { \
+		if ((level) <= NS3_EVLOG_MAX_LEVEL && (level) <= ns3::EventLog::s_level) \
+			ns3::EventLog::Write((level), (type), (node), (a0), (a1), (a2), (a3)); \
+	} while (0)
+#else
+#define EVLOG(level, type, node, a0, a1, a2, a3) do {} while (0)
+#endif
+
+namespace ns3 {
+
+class EventLog {
+public:
+	static uint32_t s_level; // records above this level are dropped at runtime, 0 until Open
+
+	static void Open(std::string filename, uint32_t level);
+	static void Close(void); // flush the calling thread and close the file
+	static void Flush(void); // flush the calling thread's buffer
+	static void Write(uint8_t level, uint16_t type, uint32_t node, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3);
+};
+
+} /* namespace ns3 */
+
+#endif /* EVENT_LOG_H */
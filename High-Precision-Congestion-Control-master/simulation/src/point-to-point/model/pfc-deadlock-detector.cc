@@ -0,0 +1,175 @@
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "ns3/simulator.h"
+#include "ns3/mtp-interface.h"
+#include "pfc-deadlock-detector.h"
+
+namespace ns3 {
+
+uint32_t PfcDeadlockDetector::s_mode = PfcDeadlockDetector::OFF;
+
+namespace {
+
+enum { OP_PAUSE, OP_RESUME, OP_ADD, OP_REMOVE };
+
+struct Record{
+	uint64_t time;
+	uint32_t node, port, peer, peerPort;
+	uint8_t op, qIndex;
+};
+
+struct Vertex{
+	bool paused;
+	std::vector<uint64_t> out; // the ingresses its packets wait for
+	uint64_t search; // last search that reached it
+	uint64_t parent; // the vertex that search reached it from
+	Vertex() : paused(false), search(0), parent(0) {}
+};
+
+// only changed by Sink, which the threads do not run concurrently with
+std::unordered_map<uint64_t, Vertex> g_graph;
+std::unordered_map<uint64_t, uint64_t> g_marked; // the time each ingress was marked at
+uint64_t g_delay = 0;
+FILE *g_out = NULL;
+uint64_t g_search = 0;
+uint64_t g_deadlocks = 0;
+
+uint64_t GetKey(uint32_t node, uint32_t port, uint32_t qIndex){
+	return ((uint64_t)node << 32) | ((uint64_t)port << 8) | qIndex;
+}
+
+// whether the paused ingresses reachable from those in `from` lead back to `to`, the parents tell
+// the way. One search visits each of them once, whatever the number of ingresses it starts from.
+bool FindPath(const std::vector<uint64_t> &from, uint64_t to){
+	g_search++;
+	std::vector<uint64_t> stack;
+	for (auto w = from.rbegin(); w != from.rend(); ++w){ // the first ingress is searched first
+		auto it = g_graph.find(*w);
+		if (it == g_graph.end() || !it->second.paused || it->second.search == g_search)
+			continue;
+		it->second.search = g_search;
+		it->second.parent = to;
+		stack.push_back(*w);
+	}
+	while (!stack.empty()){
+		uint64_t u = stack.back();
+		stack.pop_back();
+		if (u == to)
+			return true;
+		for (uint64_t w : g_graph[u].out){
+			auto jt = g_graph.find(w);
+			if (jt == g_graph.end() || !jt->second.paused || jt->second.search == g_search)
+				continue;
+			jt->second.search = g_search;
+			jt->second.parent = u;
+			stack.push_back(w);
+		}
+	}
+	return false;
+}
+
+// v closed the cycle found by FindPath(..., v), the parents lead from v back to it
+void ReportCycle(uint64_t time, uint64_t v){
+	g_deadlocks++;
+	std::vector<uint64_t> cycle(1, v);
+	for (uint64_t u = g_graph[v].parent; u != v; u = g_graph[u].parent)
+		cycle.push_back(u);
+	std::reverse(cycle.begin(), cycle.end());
+	if (g_out != NULL){
+		fprintf(g_out, "PFC deadlock at %lu:", time);
+		for (uint64_t u : cycle)
+			fprintf(g_out, " %u:%u:%u", (uint32_t)(u >> 32), (uint32_t)(u >> 8) & 0xffffff, (uint32_t)u & 0xff);
+		fprintf(g_out, "\n");
+	}
+	if (PfcDeadlockDetector::s_mode == PfcDeadlockDetector::BREAK)
+		g_marked[v] = time;
+}
+
+void Sink(void *object, const void *data, uint32_t size){
+	const Record &r = *(const Record*)data;
+	uint64_t v = GetKey(r.node, r.port, r.qIndex);
+	switch (r.op){
+		case OP_PAUSE: {
+			Vertex &x = g_graph[v];
+			x.paused = true;
+			if (FindPath(x.out, v))
+				ReportCycle(r.time, v);
+			break;
+		}
+		case OP_RESUME:
+			g_graph.erase(v);
+			g_marked.erase(v);
+			break;
+		case OP_ADD: {
+			uint64_t w = GetKey(r.peer, r.peerPort, r.qIndex);
+			g_graph[v].out.push_back(w);
+			if (g_graph[v].paused && FindPath(std::vector<uint64_t>(1, w), v))
+				ReportCycle(r.time, v);
+			break;
+		}
+		case OP_REMOVE: {
+			auto it = g_graph.find(v);
+			if (it == g_graph.end())
+				break;
+			std::vector<uint64_t> &out = it->second.out;
+			auto jt = std::find(out.begin(), out.end(), GetKey(r.peer, r.peerPort, r.qIndex));
+			if (jt != out.end()){
+				*jt = out.back();
+				out.pop_back();
+			}
+			break;
+		}
+	}
+}
+
+void Write(uint8_t op, uint32_t node, uint32_t port, uint32_t peer, uint32_t peerPort, uint32_t qIndex){
+	Record r;
+	r.time = Simulator::Now().GetTimeStep();
+	r.node = node;
+	r.port = port;
+	r.peer = peer;
+	r.peerPort = peerPort;
+	r.op = op;
+	r.qIndex = qIndex;
+	MtpInterface::Write(&Sink, NULL, &r, sizeof(r));
+}
+
+} // anonymous namespace
+
+void PfcDeadlockDetector::Enable(uint32_t mode, FILE *out, Time delay){
+	s_mode = mode;
+	g_out = out;
+	g_delay = delay.GetTimeStep();
+}
+
+void PfcDeadlockDetector::Pause(uint32_t node, uint32_t port, uint32_t qIndex){
+	Write(OP_PAUSE, node, port, 0, 0, qIndex);
+}
+
+void PfcDeadlockDetector::Resume(uint32_t node, uint32_t port, uint32_t qIndex){
+	Write(OP_RESUME, node, port, 0, 0, qIndex);
+}
+
+void PfcDeadlockDetector::AddEdge(uint32_t node, uint32_t port, uint32_t peer, uint32_t peerPort, uint32_t qIndex){
+	Write(OP_ADD, node, port, peer, peerPort, qIndex);
+}
+
+void PfcDeadlockDetector::RemoveEdge(uint32_t node, uint32_t port, uint32_t peer, uint32_t peerPort, uint32_t qIndex){
+	Write(OP_REMOVE, node, port, peer, peerPort, qIndex);
+}
+
+bool PfcDeadlockDetector::IsMarked(uint32_t node, uint32_t port, uint32_t qIndex, Time since){
+	if (g_marked.empty())
+		return false;
+	auto it = g_marked.find(GetKey(node, port, qIndex));
+	// a mark older than the pause is from a pause whose Resume the threads have not passed on yet
+	return it != g_marked.end() && it->second >= (uint64_t)since.GetTimeStep()
+		&& it->second + g_delay < (uint64_t)Simulator::Now().GetTimeStep();
+}
+
+uint64_t PfcDeadlockDetector::GetDeadlocks(void){
+	return g_deadlocks;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,52 @@
+#ifndef PFC_DEADLOCK_DETECTOR_H
+#define PFC_DEADLOCK_DETECTOR_H
+
+#include <stdint.h>
+#include <cstdio>
+#include "ns3/nstime.h"
+
+/*
+ * Online detection of PFC deadlocks on the graph of the paused switch ingresses.
+ *
+ * A vertex is an ingress (node, port, qIndex) of a switch that sent PAUSE upstream. It has an
+ * edge to the ingress of the next switch behind every egress port it holds bytes for
+ * (SwitchNode::m_bytes): these packets cannot leave while that ingress is paused too. A cycle
+ * of paused ingresses is a cyclic buffer dependency that holds the pause of all of them; it only
+ * drains if one of them also holds bytes for a port that is not paused.
+ *
+ * The switches report the changes of their paused ingresses only: Pause, Resume, and the edges
+ * that appear or go away while the ingress is paused. The reports go through MtpInterface::Write,
+ * so the graph is updated by one thread at a time, in the order of the sequential run. A pause
+ * with edges, or a new edge of a paused ingress, starts a search for the way back to it from the
+ * ingresses it waits for, over the paused ingresses reachable from them only.
+ *
+ * The cycles found are printed. In the BREAK mode the ingress whose pause or edge closed the cycle
+ * is marked: if it is still paused when its switch refreshes the PAUSE, the switch lets the
+ * upstream send again (SwitchNode::RefreshPause) and drops what exceeds the headroom until the
+ * ingress drains, as a PFC watchdog does. A mark only counts once the delay given to Enable has
+ * passed, so that the threads, which see the records at the end of their window only, break the
+ * same pauses as the sequential run: the delay must not be shorter than a link.
+ */
+
+namespace ns3 {
+
+class PfcDeadlockDetector {
+public:
+	enum Mode { OFF = 0, REPORT = 1, BREAK = 2 };
+
+	static uint32_t s_mode; // OFF until Enable
+
+	static void Enable(uint32_t mode, FILE *out, Time delay);
+	static void Pause(uint32_t node, uint32_t port, uint32_t qIndex);
+	static void Resume(uint32_t node, uint32_t port, uint32_t qIndex);
+	// the packets of the ingress (node, port) wait for the ingress (peer, peerPort) of the next switch
+	static void AddEdge(uint32_t node, uint32_t port, uint32_t peer, uint32_t peerPort, uint32_t qIndex);
+	static void RemoveEdge(uint32_t node, uint32_t port, uint32_t peer, uint32_t peerPort, uint32_t qIndex);
+	// the ingress closed a cycle since the time it paused at and is to be let go, only read while the nodes run
+	static bool IsMarked(uint32_t node, uint32_t port, uint32_t qIndex, Time since);
+	static uint64_t GetDeadlocks(void); // cycles found so far
+};
+
+} /* namespace ns3 */
+
+#endif /* PFC_DEADLOCK_DETECTOR_H */
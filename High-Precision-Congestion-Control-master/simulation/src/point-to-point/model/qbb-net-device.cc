@@ -37,7 +37,6 @@
 #include "ns3/point-to-point-channel.h"
 #include "ns3/qbb-channel.h"
 #include "ns3/random-variable.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/qbb-header.h"
 #include "ns3/error-model.h"
 #include "ns3/cn-header.h"
@@ -45,6 +44,7 @@
 #include "ns3/udp-header.h"
 #include "ns3/seq-ts-header.h"
 #include "ns3/pointer.h"
+#include "ns3/abort.h"
 #include "ns3/custom-header.h"
 #include "ns3/custom-header-niux.h"
 
@@ -55,11 +55,17 @@ NS_LOG_COMPONENT_DEFINE("QbbNetDevice");
 namespace ns3 {
     
     uint32_t RdmaEgressQueue::ack_q_idx = 3;
+    NS_OBJECT_ENSURE_REGISTERED(RdmaEgressQueue);
     // RdmaEgressQueue
     TypeId RdmaEgressQueue::GetTypeId (void)
     {
         static TypeId tid = TypeId ("ns3::RdmaEgressQueue")
             .SetParent<Object> ()
+            .AddAttribute ("QpScheduler",
+                    "How to pick the next qp: 0 = scan all qps, 1 = event-driven, 2 = both, abort on mismatch.",
+                    UintegerValue (0),
+                    MakeUintegerAccessor (&RdmaEgressQueue::m_qpScheduler),
+                    MakeUintegerChecker<uint32_t> (0, 2))
             .AddTraceSource ("RdmaEnqueue", "Enqueue a packet in the RdmaEgressQueue.",
                     MakeTraceSourceAccessor (&RdmaEgressQueue::m_traceRdmaEnqueue))
             .AddTraceSource ("RdmaDequeue", "Dequeue a packet in the RdmaEgressQueue.",
@@ -73,6 +79,17 @@ namespace ns3 {
         m_qlast = 0;
         m_ackQ = CreateObject<DropTailQueue>();
         m_ackQ->SetAttribute("MaxBytes", UintegerValue(0xffffffff)); // queue limit is on a higher level, not here
+        m_qpScheduler = 0;
+        for (uint32_t i = 0; i < QP_STATE_N; i++)
+            m_nState[i] = 0;
+        for (uint32_t i = 0; i < qCnt; i++)
+            m_pausedCache[i] = false;
+        // seq starts from 1, so that m_lastSeq = 1 is the first qp, same as m_rrlast = 0
+        m_nextSeq = 1;
+        m_lastSeq = 1;
+        m_rebaseSeq = 1;
+        m_rebase = false;
+        m_nFinished = 0;
     }
 
     Ptr<Packet> RdmaEgressQueue::DequeueQindex(int qIndex){
@@ -83,30 +100,46 @@ namespace ns3 {
             return p;
         }
         if (qIndex >= 0){ // qp
-            Ptr<Packet> p = m_rdmaGetNxtPkt(m_qpGrp->Get(qIndex));
+            Ptr<RdmaQueuePair> qp = m_qpGrp->Get(qIndex);
+            Ptr<Packet> p = m_rdmaGetNxtPkt(qp);
             m_rrlast = qIndex;
+            m_lastSeq = qp->m_schedSeq;
             m_qlast = qIndex;
-            m_traceRdmaDequeue(p, m_qpGrp->Get(qIndex)->m_pg);
+            m_traceRdmaDequeue(p, qp->m_pg);
             return p;
         }
         return 0;
     }
     int RdmaEgressQueue::GetNextQindex(bool paused[]){
-        bool found = false;
-        uint32_t qIndex;
         if (!paused[ack_q_idx] && m_ackQ->GetNPackets() > 0)
             return -1;
 
         // no pkt in highest priority queue, do rr for each qp
+        if (m_qpScheduler == 0)
+            return GetNextQindexScan(paused);
+        uint64_t seq = GetNextQpEvent(paused);
+        if (m_qpScheduler == 1)
+            return seq == 0 ? -1024 : (int)m_sched[seq].idx;
+
+        // verify: the scan decides, the event-driven scheduler must agree
+        int res = GetNextQindexScan(paused);
+        RdmaQueuePair *expect = res >= 0 ? PeekPointer(m_qpGrp->Get(res)) : 0;
+        RdmaQueuePair *got = seq != 0 ? PeekPointer(m_sched[seq].qp) : 0;
+        NS_ABORT_MSG_IF(expect != got, "RdmaEgressQueue: event-driven scheduler picked qp "
+                << (got ? got->m_schedSeq : 0) << " instead of " << (expect ? expect->m_schedSeq : 0)
+                << " at " << Simulator::Now().GetTimeStep());
+        return res;
+    }
+
+    int RdmaEgressQueue::GetNextQindexScan(bool paused[]){
+        uint32_t qIndex;
         int res = -1024;
         uint32_t fcount = m_qpGrp->GetN();//qp的数量
         uint32_t min_finish_id = 0xffffffff;
         for (qIndex = 1; qIndex <= fcount; qIndex++){
             uint32_t idx = (qIndex + m_rrlast) % fcount;
             Ptr<RdmaQueuePair> qp = m_qpGrp->Get(idx);
-            if (!paused[qp->m_pg] && qp->GetBytesLeft() > 0 && !qp->IsWinBound()){
-                if (m_qpGrp->Get(idx)->m_nextAvail.GetTimeStep() > Simulator::Now().GetTimeStep()) //not available now
-                    continue;
+            if (IsSendable(qp, paused)){
                 res = idx;
                 break;
             }else if (qp->IsFinished()){
@@ -116,19 +149,225 @@ namespace ns3 {
 
         // clear the finished qp
         if (min_finish_id < 0xffffffff){
-            int nxt = min_finish_id;
+            uint32_t nxt = min_finish_id;
             auto &qps = m_qpGrp->m_qps;
-            for (int i = min_finish_id + 1; i < fcount; i++) if (!qps[i]->IsFinished()){
-                if (i == res) // update res to the idx after removing finished qp
-                    res = nxt;
-                qps[nxt] = qps[i];
-                nxt++;
+            // the scan started after m_rrlast % fcount; count the qps kept up to it, so that
+            // rr continues after the same qp (or the last one before it if it is removed)
+            uint32_t rrlast = m_rrlast % fcount;
+            uint32_t kept = rrlast < min_finish_id ? rrlast + 1 : min_finish_id;
+            for (uint32_t i = min_finish_id + 1; i < fcount; i++){
+                if (!qps[i]->IsFinished()){
+                    if ((int)i == res) // update res to the idx after removing finished qp
+                        res = nxt;
+                    qps[nxt] = qps[i];
+                    nxt++;
+                    if (i <= rrlast)
+                        kept++;
+                }
             }
             qps.resize(nxt);
+            if (kept > 0)
+                m_rrlast = kept - 1;
+            else // every qp up to m_rrlast is removed: continue from the first one, as after the last one
+                m_rrlast = nxt > 0 ? nxt - 1 : 0;
         }
         return res;
     }
 
+    bool RdmaEgressQueue::IsSendable(Ptr<RdmaQueuePair> qp, bool paused[]){
+        return !paused[qp->m_pg] && qp->GetBytesLeft() > 0 && !qp->IsWinBound()
+            && qp->m_nextAvail.GetTimeStep() <= Simulator::Now().GetTimeStep();
+    }
+
+    uint64_t RdmaEgressQueue::GetNextQpEvent(bool paused[]){
+        SyncPaused(paused);
+        PopTimers();
+        if (m_rebase && m_qpGrp->GetN() > 0){
+            // same starting point as the scan with the m_rrlast left before ClearQps
+            m_lastSeq = m_rebaseSeq + (uint32_t)(m_rrlast + 1) % m_qpGrp->GetN() - 1;
+            m_rebase = false;
+        }
+        if (m_qpScheduler == 1 && m_nFinished > 64 && m_nFinished * 2 > m_qpGrp->GetN())
+            CompactQps();
+
+        // first READY qp after the last one dequeued, wrapping around
+        uint32_t n = m_ready.size();
+        std::set<uint64_t>::iterator it = m_ready.upper_bound(m_lastSeq);
+        for (uint32_t i = 0; i < n; i++){
+            if (it == m_ready.end())
+                it = m_ready.begin();
+            uint64_t seq = *it;
+            ++it;
+            SchedEntry &e = m_sched[seq];
+            if (IsSendable(e.qp, paused))
+                return seq;
+            // paused, or changed by someone who did not call UpdateQp
+            Classify(seq, e);
+        }
+        return 0;
+    }
+
+    void RdmaEgressQueue::Classify(uint64_t seq, SchedEntry &e){
+        if (e.state == QP_READY)
+            m_ready.erase(seq);
+        m_nState[e.state]--;
+        e.stamp++;
+
+        Ptr<RdmaQueuePair> qp = e.qp;
+        if (qp->IsFinished()){
+            m_sched.erase(seq);
+            m_nFinished++;
+            return;
+        }
+        if (qp->GetBytesLeft() == 0){
+            e.state = QP_IDLE;
+        }else if (qp->m_nextAvail.GetTimeStep() > Simulator::Now().GetTimeStep()){
+            e.state = QP_TIMER;
+            TimerItem t = {(uint64_t)qp->m_nextAvail.GetTimeStep(), seq, e.stamp};
+            m_timer.push(t);
+        }else if (qp->IsWinBound()){
+            e.state = QP_WINBOUND;
+        }else if (m_pausedCache[qp->m_pg]){
+            e.state = QP_PAUSED;
+            m_pausedQps[qp->m_pg].push_back(std::make_pair(seq, e.stamp));
+        }else {
+            e.state = QP_READY;
+            m_ready.insert(seq);
+        }
+        m_nState[e.state]++;
+    }
+
+    void RdmaEgressQueue::SyncPaused(bool paused[]){
+        for (uint32_t i = 0; i < qCnt; i++){
+            bool was = m_pausedCache[i];
+            m_pausedCache[i] = paused[i];
+            if (!was || paused[i])
+                continue;
+            // resumed: reclassify the qps parked on this pg
+            std::vector<std::pair<uint64_t, uint32_t> > parked;
+            parked.swap(m_pausedQps[i]);
+            for (uint32_t j = 0; j < parked.size(); j++){
+                auto it = m_sched.find(parked[j].first);
+                if (it != m_sched.end() && it->second.stamp == parked[j].second)
+                    Classify(it->first, it->second);
+            }
+        }
+    }
+
+    void RdmaEgressQueue::PopTimers(){
+        uint64_t now = Simulator::Now().GetTimeStep();
+        while (!m_timer.empty() && m_timer.top().ts <= now){
+            TimerItem t = m_timer.top();
+            m_timer.pop();
+            auto it = m_sched.find(t.seq);
+            if (it != m_sched.end() && it->second.stamp == t.stamp)
+                Classify(t.seq, it->second);
+        }
+        // drop stale items once they dominate the heap
+        if (m_timer.size() > 2 * m_nState[QP_TIMER] + 64){
+            std::priority_queue<TimerItem> timer;
+            for (auto it = m_sched.begin(); it != m_sched.end(); it++){
+                if (it->second.state != QP_TIMER)
+                    continue;
+                TimerItem t = {(uint64_t)it->second.qp->m_nextAvail.GetTimeStep(), it->first, it->second.stamp};
+                timer.push(t);
+            }
+            m_timer.swap(timer);
+        }
+    }
+
+    void RdmaEgressQueue::CompactQps(){
+        auto &qps = m_qpGrp->m_qps;
+        uint32_t nxt = 0;
+        for (uint32_t i = 0; i < qps.size(); i++){
+            auto it = m_sched.find(qps[i]->m_schedSeq);
+            if (it == m_sched.end() || it->second.qp != qps[i])
+                continue;
+            it->second.idx = nxt;
+            qps[nxt++] = qps[i];
+        }
+        qps.resize(nxt);
+        m_nFinished = 0;
+    }
+
+    void RdmaEgressQueue::AddQp(Ptr<RdmaQueuePair> qp){
+        if (m_qpScheduler == 0)
+            return;
+        NS_ASSERT_MSG(m_qpGrp->GetN() > 0 && m_qpGrp->Get(m_qpGrp->GetN() - 1) == qp, "RdmaEgressQueue::AddQp: qp is not the last one in m_qpGrp");
+        uint64_t seq = m_nextSeq++;
+        qp->m_schedSeq = seq;
+        SchedEntry &e = m_sched[seq];
+        e.qp = qp;
+        e.idx = m_qpGrp->GetN() - 1;
+        e.state = QP_IDLE;
+        e.stamp = 0;
+        m_nState[QP_IDLE]++;
+        Classify(seq, e);
+    }
+
+    void RdmaEgressQueue::UpdateQp(Ptr<RdmaQueuePair> qp){
+        if (m_qpScheduler == 0)
+            return;
+        auto it = m_sched.find(qp->m_schedSeq);
+        if (it == m_sched.end() || it->second.qp != qp)
+            return;
+        Classify(it->first, it->second);
+    }
+
+    void RdmaEgressQueue::ClearQps(){
+        if (m_qpScheduler == 0)
+            return;
+        m_sched.clear();
+        m_ready.clear();
+        m_timer = std::priority_queue<TimerItem>();
+        for (uint32_t i = 0; i < qCnt; i++)
+            m_pausedQps[i].clear();
+        for (uint32_t i = 0; i < QP_STATE_N; i++)
+            m_nState[i] = 0;
+        m_nFinished = 0;
+        m_rebase = true;
+        m_rebaseSeq = m_nextSeq;
+    }
+
+    Time RdmaEgressQueue::GetNextAvail(){
+        if (m_qpScheduler == 0)
+            return GetNextAvailScan();
+        Time t = GetNextAvailEvent();
+        if (m_qpScheduler == 2){
+            Time expect = GetNextAvailScan();
+            // only the time of a future wakeup matters
+            NS_ABORT_MSG_IF((expect > Simulator::Now() || t > Simulator::Now()) && expect != t,
+                    "RdmaEgressQueue: event-driven scheduler wakes up at " << t.GetTimeStep()
+                    << " instead of " << expect.GetTimeStep());
+        }
+        return t;
+    }
+
+    Time RdmaEgressQueue::GetNextAvailScan(){
+        Time t = Simulator::GetMaximumSimulationTime();
+        for (uint32_t i = 0; i < m_qpGrp->GetN(); i++){
+            Ptr<RdmaQueuePair> qp = m_qpGrp->Get(i);
+            if (qp->GetBytesLeft() == 0)
+                continue;
+            t = Min(qp->m_nextAvail, t);
+        }
+        return t;
+    }
+
+    Time RdmaEgressQueue::GetNextAvailEvent(){
+        // some qp with bytes left is already past its m_nextAvail, the scan would not set a timer either
+        if (m_nState[QP_READY] + m_nState[QP_WINBOUND] + m_nState[QP_PAUSED] > 0)
+            return Simulator::Now();
+        while (!m_timer.empty()){
+            const TimerItem &t = m_timer.top();
+            auto it = m_sched.find(t.seq);
+            if (it != m_sched.end() && it->second.stamp == t.stamp)
+                return TimeStep(t.ts);
+            m_timer.pop();
+        }
+        return Simulator::GetMaximumSimulationTime();
+    }
+
     int RdmaEgressQueue::GetLastQueue(){
         return m_qlast;
     }
@@ -282,15 +521,10 @@ namespace ns3 {
 
                 // update for the next avail time
                 m_rdmaPktSent(lastQp, p, m_tInterframeGap);
+                m_rdmaEQ->UpdateQp(lastQp);
             }else { // no packet to send
                 NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-                Time t = Simulator::GetMaximumSimulationTime();
-                for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++){
-                    Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-                    if (qp->GetBytesLeft() == 0)
-                        continue;
-                    t = Min(qp->m_nextAvail, t);
-                }
+                Time t = m_rdmaEQ->GetNextAvail();
                 if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()){
                     m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
                 }
@@ -301,20 +535,9 @@ namespace ns3 {
             if (p != 0){
                 m_snifferTrace(p);
                 m_promiscSnifferTrace(p);
-                Ipv4Header h;
-                Ptr<Packet> packet = p->Copy();
-                uint16_t protocol = 0;
-                ProcessHeader(packet, protocol);// 为什么要copy一份packet
-                packet->RemoveHeader(h);
-                FlowIdTag t;
                 uint32_t qIndex = m_queue->GetLastQueue();
-                if (qIndex == 0){//this is a pause or cnp, send it immediately!
-                    m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);//将INT的信息写入到buffer中
-                    p->RemovePacketTag(t);
-                }else{
-                    m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
-                    p->RemovePacketTag(t);
-                }
+                // 更新MMU计数并将INT的信息直接写入到buffer中，不再拷贝和解析packet
+                m_node->SwitchNotifyDequeue(m_ifIndex, qIndex, p);
                 m_traceDequeue(p, qIndex);
                 TransmitStart(p);
                 return;
@@ -338,12 +561,6 @@ namespace ns3 {
             if (p != 0){
                 m_snifferTrace(p);
                 m_promiscSnifferTrace(p);
-                Ipv4Header h;
-                Ptr<Packet> packet = p->Copy();
-                uint16_t protocol = 0;
-                ProcessHeader(packet, protocol);// 为什么要copy一份packet
-                packet->RemoveHeader(h);
-                FlowIdTag t;
                 uint32_t qIndex = m_queue->GetLastQueue();
                 m_traceDequeue(p, qIndex);
                 TransmitStart(p);
@@ -372,7 +589,9 @@ namespace ns3 {
         QbbNetDevice::Resume(unsigned qIndex)
     {
         NS_LOG_FUNCTION(this << qIndex);
-        NS_ASSERT_MSG(m_paused[qIndex], "Must be PAUSEd");
+        m_resumeEvent[qIndex].Cancel();
+        if (!m_paused[qIndex]) // the pause expired before the RESUME
+            return;
         m_paused[qIndex] = false;
         NS_LOG_INFO("Node " << m_node->GetId() << " dev " << m_ifIndex << " queue " << qIndex <<
             " resumed at " << Simulator::Now().GetSeconds());
@@ -403,18 +622,20 @@ namespace ns3 {
         ch.getInt = 1; // parse INT header
         packet->PeekHeader(ch);
         if (ch.l3Prot == 0xFE){ // PFC
-            /*if (!m_qbbEnabled) return;
+            if (!m_qbbEnabled) return;
             unsigned qIndex = ch.pfc.qIndex;
             if (ch.pfc.time > 0){
+                // paused for the time in the frame, the sender refreshes it while it is congested
                 m_tracePfc(1);
                 m_paused[qIndex] = true;
+                m_resumeEvent[qIndex].Cancel();
+                m_resumeEvent[qIndex] = Simulator::Schedule(MicroSeconds(ch.pfc.time), &QbbNetDevice::Resume, this, qIndex);
             }else{
                 m_tracePfc(0);
                 Resume(qIndex);
-            }*/
+            }
         }else { // non-PFC packets (data, ACK, NACK, CNP...)
             if (m_node->GetNodeType() == 1){ // switch
-                packet->AddPacketTag(FlowIdTag(m_ifIndex));
                 m_node->SwitchReceiveFromDevice(this, packet, ch);
             }else if(m_node->GetNodeType() == 2){ //出入口路由器
                 m_node->MatchSharedTableSendToRelatedSender(this, packet, ch);//生成共享链路表，和共享链路表匹配，调用sendtodev-switchsend
@@ -442,21 +663,27 @@ namespace ns3 {
     }
 
     void QbbNetDevice::SendPfc(uint32_t qIndex, uint32_t type){
-        /*Ptr<Packet> p = Create<Packet>(0);
+        if (!m_qbbEnabled) return;
+        Ptr<Packet> p = Create<Packet>(0);
         PauseHeader pauseh((type == 0 ? m_pausetime : 0), m_queue->GetNBytes(qIndex), qIndex);
         p->AddHeader(pauseh);
         Ipv4Header ipv4h;  // Prepare IPv4 header
         ipv4h.SetProtocol(0xFE);
-        ipv4h.SetSource(m_node->GetObject<Ipv4>()->GetAddress(m_ifIndex, 0).GetLocal());
+        // the frame does not leave the link, switch ports have no address
+        ipv4h.SetSource(Ipv4Address::GetAny());
         ipv4h.SetDestination(Ipv4Address("255.255.255.255"));
         ipv4h.SetPayloadSize(p->GetSize());
         ipv4h.SetTtl(1);
-        ipv4h.SetIdentification(UniformVariable(0, 65536).GetValue());
+        ipv4h.SetIdentification(0);
         p->AddHeader(ipv4h);
         AddHeader(p, 0x800);
-        CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+        MyCustomHeader ch(MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header);
         p->PeekHeader(ch);
-        SwitchSend(0, p, ch);*/
+        SwitchSend(0, p, ch);
+    }
+
+    uint32_t QbbNetDevice::GetPauseTime(void) const{
+        return m_qbbEnabled ? m_pausetime : 0;
     }
 
     bool
@@ -483,7 +710,7 @@ namespace ns3 {
         m_txMachineState = BUSY;
         m_currentPkt = p;
         m_phyTxBeginTrace(m_currentPkt);
-        Time txTime = Seconds(m_bps.CalculateTxTime(p->GetSize()));
+        Time txTime = m_bps.TxTime(p->GetSize());
         Time txCompleteTime = txTime + m_tInterframeGap;
         NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
         Simulator::Schedule(txCompleteTime, &QbbNetDevice::TransmitComplete, this);
@@ -508,9 +735,11 @@ namespace ns3 {
 
    void QbbNetDevice::NewQp(Ptr<RdmaQueuePair> qp){
        qp->m_nextAvail = Simulator::Now();
+       m_rdmaEQ->AddQp(qp);
        DequeueAndTransmit();
    }
    void QbbNetDevice::ReassignedQp(Ptr<RdmaQueuePair> qp){
+       m_rdmaEQ->AddQp(qp);
        DequeueAndTransmit();
    }
    void QbbNetDevice::TriggerTransmit(void){
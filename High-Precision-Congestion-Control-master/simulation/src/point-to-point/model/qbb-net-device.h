@@ -31,6 +31,9 @@
 #include "ns3/rdma-queue-pair.h"
 #include <vector>
 #include<map>
+#include <set>
+#include <queue>
+#include <unordered_map>
 #include <ns3/rdma.h>
 #include "ns3/custom-header-niux.h"
 
@@ -49,6 +52,10 @@ public:
     typedef Callback<Ptr<Packet>, Ptr<RdmaQueuePair> > RdmaGetNxtPkt;
     RdmaGetNxtPkt m_rdmaGetNxtPkt;
 
+    // qp scheduler: 0 = scan every qp on each dequeue, 1 = event-driven,
+    // 2 = run both and abort as soon as they pick a different qp
+    uint32_t m_qpScheduler;
+
     static TypeId GetTypeId (void);
     RdmaEgressQueue();
     Ptr<Packet> DequeueQindex(int qIndex);
@@ -61,8 +68,64 @@ public:
     void EnqueueHighPrioQ(Ptr<Packet> p);
     void CleanHighPrio(TracedCallback<Ptr<const Packet>, uint32_t> dropCb);
 
+    // event-driven scheduler hooks, no-ops when m_qpScheduler == 0
+    void AddQp(Ptr<RdmaQueuePair> qp); // qp has just been appended to m_qpGrp
+    void UpdateQp(Ptr<RdmaQueuePair> qp); // snd_nxt/snd_una/m_rate/m_nextAvail of qp changed
+    void ClearQps(); // m_qpGrp has been cleared
+    Time GetNextAvail(); // earliest time a qp with bytes left may send, used when nothing is sendable
+
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceRdmaDequeue;
+
+private:
+    /*
+     * Event-driven scheduler. Every qp of m_qpGrp is in exactly one state:
+     *   READY    in m_ready, can send now
+     *   TIMER    in m_timer, rate limited until m_nextAvail
+     *   WINBOUND waiting for an ACK to open the window
+     *   PAUSED   in m_pausedQps[pg], waiting for the pg to resume
+     *   IDLE     all bytes sent, waiting for ACK/NACK
+     * Qps are ordered by m_schedSeq, which follows their order in m_qpGrp, so
+     * taking the first READY qp after m_lastSeq is the same round robin as
+     * the scan. Heap and pause-list items carry the stamp of the entry when
+     * pushed and are dropped lazily once the entry has been reclassified.
+     */
+    enum {QP_READY = 0, QP_TIMER, QP_WINBOUND, QP_PAUSED, QP_IDLE, QP_STATE_N};
+    struct SchedEntry{
+        Ptr<RdmaQueuePair> qp;
+        uint32_t idx; // index in m_qpGrp
+        uint32_t state;
+        uint32_t stamp;
+    };
+    struct TimerItem{
+        uint64_t ts;
+        uint64_t seq;
+        uint32_t stamp;
+        bool operator < (const TimerItem &o) const { // min-heap on (ts, seq)
+            return ts > o.ts || (ts == o.ts && seq > o.seq);
+        }
+    };
+    std::unordered_map<uint64_t, SchedEntry> m_sched;
+    std::set<uint64_t> m_ready;
+    std::priority_queue<TimerItem> m_timer;
+    std::vector<std::pair<uint64_t, uint32_t> > m_pausedQps[qCnt];
+    uint32_t m_nState[QP_STATE_N];
+    bool m_pausedCache[qCnt];
+    uint64_t m_nextSeq; // seq of the next qp added
+    uint64_t m_lastSeq; // seq of the last qp dequeued
+    uint64_t m_rebaseSeq; // seq of the first qp added after ClearQps
+    bool m_rebase;
+    uint32_t m_nFinished; // finished qps still in m_qpGrp
+
+    int GetNextQindexScan(bool paused[]);
+    uint64_t GetNextQpEvent(bool paused[]);
+    Time GetNextAvailScan();
+    Time GetNextAvailEvent();
+    bool IsSendable(Ptr<RdmaQueuePair> qp, bool paused[]);
+    void Classify(uint64_t seq, SchedEntry &e);
+    void SyncPaused(bool paused[]);
+    void PopTimers();
+    void CompactQps();
 };
 
 /**
@@ -127,6 +190,7 @@ public:
    void TriggerTransmit(void);
 
     void SendPfc(uint32_t qIndex, uint32_t type); // type: 0 = pause, 1 = resume
+    uint32_t GetPauseTime(void) const; // us a PAUSE holds the peer for, 0 if PFC is disabled
 
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceEnqueue;
     TracedCallback<Ptr<const Packet>, uint32_t> m_traceDequeue;
@@ -164,6 +228,7 @@ protected:
   bool m_dynamicth;
   uint32_t m_pausetime;    //< Time for each Pause
   bool m_paused[qCnt];    //< Whether a queue paused
+  EventId m_resumeEvent[qCnt];    //< End of the pause time of the last PAUSE
 
   //qcn
 
@@ -0,0 +1,708 @@
+#include <ns3/simulator.h>
+#include <ns3/custom-header-niux.h>
+#include "rdma-cc.h"
+#include "rdma-hw.h"
+#include "enc-header.h"
+#include "pint.h"
+
+namespace ns3{
+
+RdmaCc::RdmaCc(RdmaHw *hw) : m_hw(hw) {
+}
+
+RdmaCc::~RdmaCc(){
+}
+
+void RdmaCc::Init(Ptr<RdmaQueuePair> qp){
+}
+
+void RdmaCc::HandleSharedAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+}
+
+void RdmaCc::Stop(Ptr<RdmaQueuePair> qp){
+}
+
+void RdmaCc::PktSent(Ptr<RdmaQueuePair> qp){
+}
+
+// Utilization of the bottleneck seen by an ACK, for HPCC and HPCC-PINT. The ENC INT only has the
+// deepest queues of the path: a hop with a queue is sending at line rate, so its utilization is 1
+// plus the queue over the BDP of the qp, and a path with no queue reported is taken as idle.
+static double GetUtil(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch){
+    uint64_t depth = ch.ack.ih.GetMaxDepth();
+    if (depth == 0)
+        return 0;
+    double bdp = qp->m_max_rate.GetBitRate() / 8e9 * qp->m_baseRtt; // bytes
+    return 1 + depth / bdp;
+}
+
+#define PRINT_LOG 0
+/******************************
+ * Mellanox's version of DCQCN
+ *****************************/
+RdmaCcDcqcn::RdmaCcDcqcn(RdmaHw *hw) : RdmaCc(hw) {
+    m_alpha = 1;
+    m_alpha_cnp_arrived = false;
+    m_first_cnp = true;
+    m_decrease_cnp_arrived = false;
+    m_rpTimeStage = 0;
+}
+
+void RdmaCcDcqcn::Init(Ptr<RdmaQueuePair> qp){
+    m_targetRate = qp->m_rate;
+}
+
+void RdmaCcDcqcn::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    uint8_t cnp = (ch.ack.flags >> encHeader::FLAG_CNP) & 1;
+    if (cnp)
+        CnpReceived(qp);
+}
+
+void RdmaCcDcqcn::Stop(Ptr<RdmaQueuePair> qp){
+    Simulator::Cancel(m_eventUpdateAlpha);
+    Simulator::Cancel(m_eventDecreaseRate);
+    Simulator::Cancel(m_rpTimer);
+}
+
+void RdmaCcDcqcn::UpdateAlpha(Ptr<RdmaQueuePair> qp){
+    #if PRINT_LOG
+    //std::cout << Simulator::Now() << " alpha update:" << m_node->GetId() << ' ' << m_alpha << ' ' << (int)m_alpha_cnp_arrived << '\n';
+    //printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_alpha);
+    #endif
+    if (m_alpha_cnp_arrived){
+        m_alpha = (1 - m_hw->m_g)*m_alpha + m_hw->m_g;     //binary feedback
+    }else {
+        m_alpha = (1 - m_hw->m_g)*m_alpha;     //binary feedback
+    }
+    #if PRINT_LOG
+    //printf("%.6lf\n", m_alpha);
+    #endif
+    m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
+    ScheduleUpdateAlpha(qp);
+}
+void RdmaCcDcqcn::ScheduleUpdateAlpha(Ptr<RdmaQueuePair> qp){
+    m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_hw->m_alpha_resume_interval), &RdmaCcDcqcn::UpdateAlpha, this, qp);
+}
+
+void RdmaCcDcqcn::CnpReceived(Ptr<RdmaQueuePair> qp){
+    m_alpha_cnp_arrived = true; // set CNP_arrived bit for alpha update
+    m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
+    if (m_first_cnp){
+        // init alpha
+        m_alpha = 1;
+        m_alpha_cnp_arrived = false;
+        // schedule alpha update
+        ScheduleUpdateAlpha(qp);
+        // schedule rate decrease
+        ScheduleDecreaseRate(qp, 1); // add 1 ns to make sure rate decrease is after alpha update
+        // set rate on first CNP
+        m_targetRate = qp->m_rate = m_hw->m_rateOnFirstCNP * qp->m_rate;
+        m_first_cnp = false;
+    }
+}
+
+void RdmaCcDcqcn::CheckRateDecrease(Ptr<RdmaQueuePair> qp){
+    ScheduleDecreaseRate(qp, 0);
+    if (m_decrease_cnp_arrived){
+        #if PRINT_LOG
+        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+        #endif
+        bool clamp = true;
+        if (!m_hw->m_EcnClampTgtRate){
+            if (m_rpTimeStage == 0)
+                clamp = false;
+        }
+        if (clamp)
+            m_targetRate = qp->m_rate;
+        qp->m_rate = std::max(m_hw->m_minRate, qp->m_rate * (1 - m_alpha / 2));
+        // reset rate increase related things
+        m_rpTimeStage = 0;
+        m_decrease_cnp_arrived = false;
+        Simulator::Cancel(m_rpTimer);
+        m_rpTimer = Simulator::Schedule(MicroSeconds(m_hw->m_rpgTimeReset), &RdmaCcDcqcn::RateIncEventTimer, this, qp);
+        #if PRINT_LOG
+        printf("(%.3lf %.3lf)\n", m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+        #endif
+        m_hw->m_nic[m_hw->GetNicIdxOfQp(qp)].dev->m_rdmaEQ->UpdateQp(qp);
+    }
+}
+void RdmaCcDcqcn::ScheduleDecreaseRate(Ptr<RdmaQueuePair> qp, uint32_t delta){
+    m_eventDecreaseRate = Simulator::Schedule(MicroSeconds(m_hw->m_rateDecreaseInterval) + NanoSeconds(delta), &RdmaCcDcqcn::CheckRateDecrease, this, qp);
+}
+
+void RdmaCcDcqcn::RateIncEventTimer(Ptr<RdmaQueuePair> qp){
+    m_rpTimer = Simulator::Schedule(MicroSeconds(m_hw->m_rpgTimeReset), &RdmaCcDcqcn::RateIncEventTimer, this, qp);
+    RateIncEvent(qp);
+    m_rpTimeStage++;
+    m_hw->m_nic[m_hw->GetNicIdxOfQp(qp)].dev->m_rdmaEQ->UpdateQp(qp);
+}
+void RdmaCcDcqcn::RateIncEvent(Ptr<RdmaQueuePair> qp){
+    // check which increase phase: fast recovery, active increase, hyper increase
+    if (m_rpTimeStage < m_hw->m_rpgThreshold){ // fast recovery
+        FastRecovery(qp);
+    }else if (m_rpTimeStage == m_hw->m_rpgThreshold){ // active increase
+        ActiveIncrease(qp);
+    }else { // hyper increase
+        HyperIncrease(qp);
+    }
+}
+
+void RdmaCcDcqcn::FastRecovery(Ptr<RdmaQueuePair> qp){
+    #if PRINT_LOG
+    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+    qp->m_rate = (qp->m_rate / 2) + (m_targetRate / 2);
+    #if PRINT_LOG
+    printf("(%.3lf %.3lf)\n", m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+}
+void RdmaCcDcqcn::ActiveIncrease(Ptr<RdmaQueuePair> qp){
+    #if PRINT_LOG
+    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+    // get NIC
+    uint32_t nic_idx = m_hw->GetNicIdxOfQp(qp);
+    Ptr<QbbNetDevice> dev = m_hw->m_nic[nic_idx].dev;
+    // increate rate
+    m_targetRate += m_hw->m_rai;
+    if (m_targetRate > dev->GetDataRate())
+        m_targetRate = dev->GetDataRate();
+    qp->m_rate = (qp->m_rate / 2) + (m_targetRate / 2);
+    #if PRINT_LOG
+    printf("(%.3lf %.3lf)\n", m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+}
+void RdmaCcDcqcn::HyperIncrease(Ptr<RdmaQueuePair> qp){
+    #if PRINT_LOG
+    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+    // get NIC
+    uint32_t nic_idx = m_hw->GetNicIdxOfQp(qp);
+    Ptr<QbbNetDevice> dev = m_hw->m_nic[nic_idx].dev;
+    // increate rate
+    m_targetRate += m_hw->m_rhai;
+    if (m_targetRate > dev->GetDataRate())
+        m_targetRate = dev->GetDataRate();
+    qp->m_rate = (qp->m_rate / 2) + (m_targetRate / 2);
+    #if PRINT_LOG
+    printf("(%.3lf %.3lf)\n", m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
+    #endif
+}
+
+/***********************
+ * High Precision CC
+ ***********************/
+RdmaCcHpcc::RdmaCcHpcc(RdmaHw *hw) : RdmaCc(hw) {
+    m_lastUpdateSeq = 0;
+    m_incStage = 0;
+    u = 1;
+    m_lastFeedback = 0;
+}
+
+void RdmaCcHpcc::Init(Ptr<RdmaQueuePair> qp){
+    m_curRate = qp->m_rate;
+}
+
+void RdmaCcHpcc::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    uint32_t ack_seq = ch.ack.seq;
+    // update rate
+    if (ack_seq > m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
+        UpdateRate(qp, ch, false);
+    }else if (m_hw->m_fast_react){ // do fast react
+        UpdateRate(qp, ch, true);
+    }
+}
+
+void RdmaCcHpcc::UpdateRate(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch, bool fast_react){
+    uint32_t next_seq = qp->snd_nxt;
+    uint64_t now = Simulator::Now().GetTimeStep();
+    if (m_lastUpdateSeq == 0){ // first RTT
+        m_lastUpdateSeq = next_seq;
+        m_lastFeedback = now;
+        return;
+    }
+    double U = GetUtil(qp, ch);
+    if (m_hw->m_sampleFeedback && U == 0 && fast_react)
+        return;
+    uint64_t dt = std::min(now - m_lastFeedback, qp->m_baseRtt);
+    m_lastFeedback = now;
+    u = (u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
+    double max_c = u / m_hw->m_targetUtil;
+
+    DataRate new_rate;
+    uint32_t new_incStage;
+    if (max_c >= 1 || m_incStage >= m_hw->m_miThresh){
+        new_rate = max_c > 0 ? m_curRate / max_c + m_hw->m_rai : qp->m_max_rate;
+        new_incStage = 0;
+    }else{
+        new_rate = m_curRate + m_hw->m_rai;
+        new_incStage = m_incStage+1;
+    }
+    if (new_rate < m_hw->m_minRate)
+        new_rate = m_hw->m_minRate;
+    if (new_rate > qp->m_max_rate)
+        new_rate = qp->m_max_rate;
+    #if PRINT_LOG
+    printf("%lu %s %08x %08x %u %u u=%.6lf U=%.3lf dt=%lu max_c=%.3lf rate:%.3lf->%.3lf\n", now, fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, u, U, dt, max_c, m_curRate.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
+    #endif
+    m_hw->ChangeRate(qp, new_rate);
+    if (!fast_react){
+        m_curRate = new_rate;
+        m_incStage = new_incStage;
+        if (next_seq > m_lastUpdateSeq)
+            m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
+    }
+}
+
+/**********************
+ * TIMELY
+ *********************/
+RdmaCcTimely::RdmaCcTimely(RdmaHw *hw) : RdmaCc(hw) {
+    m_rttSeq = 0;
+    m_rttTime = 0;
+    m_rtt = 0;
+    m_lastUpdateSeq = 0;
+    m_incStage = 0;
+    lastRtt = 0;
+    rttDiff = 0;
+}
+
+void RdmaCcTimely::Init(Ptr<RdmaQueuePair> qp){
+    m_curRate = qp->m_rate;
+}
+
+void RdmaCcTimely::PktSent(Ptr<RdmaQueuePair> qp){
+    if (m_rttSeq == 0){
+        m_rttSeq = qp->snd_nxt;
+        m_rttTime = Simulator::Now().GetTimeStep();
+    }
+}
+
+void RdmaCcTimely::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    uint32_t ack_seq = ch.ack.seq;
+    if (m_rttSeq != 0 && ack_seq >= m_rttSeq){
+        m_rtt = Simulator::Now().GetTimeStep() - m_rttTime;
+        m_rttSeq = 0;
+    }
+    // update rate once per RTT, TIMELY has no fast react
+    if (ack_seq > m_lastUpdateSeq && m_rtt != 0)
+        UpdateRate(qp);
+}
+
+void RdmaCcTimely::UpdateRate(Ptr<RdmaQueuePair> qp){
+    uint32_t next_seq = qp->snd_nxt;
+    uint64_t rtt = m_rtt;
+    if (m_lastUpdateSeq != 0){ // not first RTT
+        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)lastRtt;
+        double rtt_diff = (1 - m_hw->m_tmly_alpha) * rttDiff + m_hw->m_tmly_alpha * new_rtt_diff;
+        double gradient = rtt_diff / m_hw->m_tmly_minRtt;
+        bool inc = false;
+        double c = 0;
+        #if PRINT_LOG
+        printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf", Simulator::Now().GetTimeStep(), m_hw->m_node->GetId(), rtt, rtt_diff, gradient, m_curRate.GetBitRate() * 1e-9);
+        #endif
+        if (rtt < m_hw->m_tmly_TLow){
+            inc = true;
+        }else if (rtt > m_hw->m_tmly_THigh){
+            c = 1 - m_hw->m_tmly_beta * (1 - (double)m_hw->m_tmly_THigh / rtt);
+            inc = false;
+        }else if (gradient <= 0){
+            inc = true;
+        }else{
+            c = 1 - m_hw->m_tmly_beta * gradient;
+            if (c < 0)
+                c = 0;
+            inc = false;
+        }
+        if (inc){
+            if (m_incStage < 5){
+                qp->m_rate = m_curRate + m_hw->m_rai;
+            }else{
+                qp->m_rate = m_curRate + m_hw->m_rhai;
+            }
+            if (qp->m_rate > qp->m_max_rate)
+                qp->m_rate = qp->m_max_rate;
+            m_incStage++;
+        }else{
+            qp->m_rate = std::max(m_hw->m_minRate, m_curRate * c);
+            m_incStage = 0;
+        }
+        m_curRate = qp->m_rate;
+        rttDiff = rtt_diff;
+        #if PRINT_LOG
+        printf(" %c %.3lf\n", inc? '^':'v', qp->m_rate.GetBitRate() * 1e-9);
+        #endif
+    }
+    if (next_seq > m_lastUpdateSeq){
+        m_lastUpdateSeq = next_seq;
+        // update
+        lastRtt = rtt;
+    }
+}
+
+/**********************
+ * DCTCP
+ *********************/
+RdmaCcDctcp::RdmaCcDctcp(RdmaHw *hw) : RdmaCc(hw) {
+    m_lastUpdateSeq = 0;
+    m_caState = 0;
+    m_highSeq = 0;
+    m_alpha = 1;
+    m_ecnCnt = 0;
+    m_batchSizeOfAlpha = 0;
+}
+
+void RdmaCcDctcp::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    uint32_t ack_seq = ch.ack.seq;
+    uint8_t cnp = (ch.ack.flags >> encHeader::FLAG_CNP) & 1;
+    bool new_batch = false;
+
+    // update alpha
+    m_ecnCnt += (cnp > 0);
+    if (ack_seq > m_lastUpdateSeq){ // if full RTT feedback is ready, do alpha update
+        #if PRINT_LOG
+        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->", Simulator::Now().GetTimeStep(), "alpha", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, m_lastUpdateSeq, ch.ack.seq, qp->snd_nxt, m_alpha);
+        #endif
+        new_batch = true;
+        if (m_lastUpdateSeq == 0){ // first RTT
+            m_lastUpdateSeq = qp->snd_nxt;
+            m_batchSizeOfAlpha = qp->snd_nxt / m_hw->m_mtu + 1;
+        }else {
+            double frac = std::min(1.0, double(m_ecnCnt) / m_batchSizeOfAlpha);
+            m_alpha = (1 - m_hw->m_g) * m_alpha + m_hw->m_g * frac;
+            m_lastUpdateSeq = qp->snd_nxt;
+            m_ecnCnt = 0;
+            m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_hw->m_mtu + 1;
+            #if PRINT_LOG
+            printf("%.3lf F:%.3lf", m_alpha, frac);
+            #endif
+        }
+        #if PRINT_LOG
+        printf("\n");
+        #endif
+    }
+
+    // check cwr exit
+    if (m_caState == 1){
+        if (ack_seq > m_highSeq)
+            m_caState = 0;
+    }
+
+    // check if need to reduce rate: ECN and not in CWR
+    if (cnp && m_caState == 0){
+        #if PRINT_LOG
+        printf("%lu %s %08x %08x %u %u %.3lf->", Simulator::Now().GetTimeStep(), "rate", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->m_rate.GetBitRate()*1e-9);
+        #endif
+        qp->m_rate = std::max(m_hw->m_minRate, qp->m_rate * (1 - m_alpha / 2));
+        #if PRINT_LOG
+        printf("%.3lf\n", qp->m_rate.GetBitRate() * 1e-9);
+        #endif
+        m_caState = 1;
+        m_highSeq = qp->snd_nxt;
+    }
+
+    // additive inc
+    if (m_caState == 0 && new_batch)
+        qp->m_rate = std::min(qp->m_max_rate, qp->m_rate + m_hw->m_dctcp_rai);
+}
+
+/*********************
+ * HPCC-PINT
+ ********************/
+RdmaCcHpccPint::RdmaCcHpccPint(RdmaHw *hw) : RdmaCc(hw) {
+    m_lastUpdateSeq = 0;
+    m_incStage = 0;
+}
+
+void RdmaCcHpccPint::Init(Ptr<RdmaQueuePair> qp){
+    m_curRate = qp->m_rate;
+}
+
+void RdmaCcHpccPint::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    uint32_t ack_seq = ch.ack.seq;
+    if (rand() % 65536 >= m_hw->pint_smpl_thresh)
+        return;
+    // update rate
+    if (ack_seq > m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
+        UpdateRate(qp, ch, false);
+    }else{ // do fast react
+        UpdateRate(qp, ch, true);
+    }
+}
+
+void RdmaCcHpccPint::UpdateRate(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch, bool fast_react){
+    uint32_t next_seq = qp->snd_nxt;
+    if (m_lastUpdateSeq == 0){ // first RTT
+        m_lastUpdateSeq = next_seq;
+    }else {
+        double U = Pint::decode_u(Pint::encode_u(GetUtil(qp, ch)));
+
+        DataRate new_rate;
+        int32_t new_incStage;
+        double max_c = U / m_hw->m_targetUtil;
+
+        if (max_c >= 1 || m_incStage >= m_hw->m_miThresh){
+            new_rate = m_curRate / max_c + m_hw->m_rai;
+            new_incStage = 0;
+        }else{
+            new_rate = m_curRate + m_hw->m_rai;
+            new_incStage = m_incStage+1;
+        }
+        if (new_rate < m_hw->m_minRate)
+            new_rate = m_hw->m_minRate;
+        if (new_rate > qp->m_max_rate)
+            new_rate = qp->m_max_rate;
+        m_hw->ChangeRate(qp, new_rate);
+        if (!fast_react){
+            m_curRate = new_rate;
+            m_incStage = new_incStage;
+        }
+        if (!fast_react){
+            if (next_seq > m_lastUpdateSeq)
+                m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
+        }
+    }
+}
+
+/***********************
+ * My CC
+ ***********************/
+RdmaCcMycc::RdmaCcMycc(RdmaHw *hw) : RdmaCc(hw) {
+    m_lastUpdateSeq = 0;
+
+    m_lastUpdateTime = 0;//上一次更新窗口的时间
+    m_lastUpdateCongestTime = 0;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
+    m_lastUpdateIdleTime = 0;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
+
+    m_currentWinSize = 0;//当前窗口的大小
+    m_lastWinSize = 0;//上一个窗口的大小
+
+    m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
+    m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+    m_depth = 0;
+    m_ratio = 0;
+    m_rTs = 0;//队列空闲时的时间
+    m_dTs = 0;//发生拥塞时的时间
+    m_max_dRate = 0;
+    m_max_rRate = 0;
+}
+
+void RdmaCcMycc::Init(Ptr<RdmaQueuePair> qp){
+    m_currentWinSize = qp->m_win;
+}
+
+void RdmaCcMycc::HandleSharedAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    HandleAck(qp, p, ch);
+}
+
+void RdmaCcMycc::HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
+    bool shared = (ch.ack.flags >> encHeader::FLAG_SHARED) & 1;
+    //可能是自身的ack数据包，也可能是同set主机的ack数据包
+    //如果是第一个窗口或者当前窗口和上一个窗口的大小未发生改变的情况，此时不考虑过度反应
+    if (m_lastUpdateSeq == 0 || m_currentWinSize == m_lastWinSize) {
+        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
+            int maxDepthIndex = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndex].depth) {
+                    maxDepthIndex = i;
+                }
+            }
+            uint64_t dDelta_time = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndex].ts);
+            if (dDelta_time < m_congestTimeStamp) {
+                m_depth = ch.ack.ih.dinfo[maxDepthIndex].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_time;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndex].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndex].maxRate;
+                
+            }else if (m_congestTimeStamp == 0){
+                m_depth = ch.ack.ih.dinfo[maxDepthIndex].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_time;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndex].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndex].maxRate;
+
+            }
+            
+        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
+            int maxRadioIndex = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndex].ratio) {
+                    maxRadioIndex = i;
+                }
+            }
+            uint64_t rDelta_time = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndex].ts);
+            if (rDelta_time < m_idleTimeStamp) {
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndex].ratio;
+                m_idleTimeStamp = rDelta_time;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndex].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndex].maxRate;
+
+            }else if (m_congestTimeStamp == 0){
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndex].ratio;
+                m_idleTimeStamp = rDelta_time;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndex].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndex].maxRate;
+
+            }
+        }
+    }else if(m_currentWinSize < m_lastWinSize){//当前窗口的大小小于上一个窗口的大小，防止对同一个拥塞事件作出反应
+        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息,只选择同set主机且在窗口内发生拥塞的数据包做为判断
+            int maxDepthIndexOverReaction = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
+                    maxDepthIndexOverReaction = i;
+                }
+            }
+            uint64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+            if (shared && dDelta_overReactionTime < m_congestTimeStamp && MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts) > m_lastUpdateTime + 0.25*qp->m_baseRtt) {//
+                m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_overReactionTime;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
+
+            }else if(m_congestTimeStamp == 0 && shared && MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts) > m_lastUpdateTime + 0.25*qp->m_baseRtt){
+                m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_overReactionTime;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
+
+            }
+        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息，只选择
+            int maxRadioIndexOverReaction = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
+                    maxRadioIndexOverReaction = i;
+                }
+            }
+            uint64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+            if (rDelta_overReactionTime < m_idleTimeStamp && MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts) > m_lastUpdateCongestTime) {
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
+                m_idleTimeStamp = rDelta_overReactionTime;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
+                
+            }else if(m_idleTimeStamp == 0 && MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts) > m_lastUpdateCongestTime){
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
+                m_idleTimeStamp = rDelta_overReactionTime;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
+
+            }
+
+        }
+    }else{//当前窗口的大小大于上一个窗口的大小，防止对同一个空闲事件作出反应
+        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
+            int maxDepthIndexOverReaction = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
+                    maxDepthIndexOverReaction = i;
+                }
+            }
+            uint64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+            if (dDelta_overReactionTime < m_congestTimeStamp && MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts) > m_idleTimeStamp) {//
+                m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_overReactionTime;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
+
+            }else if(m_congestTimeStamp == 0 && MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts) > m_idleTimeStamp){
+                m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].GetBytes() / MyIntHeader::qlenUnit;
+                m_congestTimeStamp = dDelta_overReactionTime;
+                m_dTs = MyIntHeader::GetTime(ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts);
+//                m_dIsOwn = ch.ack.isOwn;
+                m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
+
+            }
+        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
+            int maxRadioIndexOverReaction = 0;
+            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
+                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
+                    maxRadioIndexOverReaction = i;
+                }
+            }
+            uint64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep() - MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+            if (shared && rDelta_overReactionTime < m_idleTimeStamp && MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts) > m_lastUpdateTime + 0.25*qp->m_baseRtt) {
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
+                m_idleTimeStamp = rDelta_overReactionTime;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
+
+            }else if(m_idleTimeStamp == 0 && shared && MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts) > m_lastUpdateTime + 0.25*qp->m_baseRtt){
+                m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
+                m_idleTimeStamp = rDelta_overReactionTime;
+                m_rTs = MyIntHeader::GetTime(ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts);
+//                m_rIsOwn = ch.ack.isOwn;
+                m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
+
+            }
+
+        }
+    }
+    
+    if (!shared) {//自身的数据包并且一个完整的RTT窗口之后，更新发送速率
+        DataRate new_rate;
+        uint32_t ack_seq = ch.ack.seq;
+        uint32_t next_seq = qp->snd_nxt;//snd_nxt为下一个发送的位置，它指向未发送但可以发送的第一个字节的序列号。
+        if (ack_seq > m_lastUpdateSeq) { //一个完整RTT的窗口，此时更新发送速率
+            //todo:计算速率
+            if ((m_dTs != 0 || m_rTs != 0) && m_dTs > m_rTs) {//在一个窗口内拥塞事件最后发生
+                m_lastUpdateTime = Simulator::Now().GetTimeStep();
+                m_lastUpdateSeq = next_seq;
+                m_lastWinSize = m_currentWinSize;
+                m_lastUpdateCongestTime = m_dTs;
+                double alpha = m_depth/(m_depth + m_max_dRate * qp->m_baseRtt);
+                m_currentWinSize = m_currentWinSize * (1-alpha);
+                //重置下面的变量
+                m_congestTimeStamp = 0;
+                m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+//                    m_dIsOwn = 3;
+//                    m_rIsOwn = 3;
+                m_depth = 0;
+                m_ratio = 1;
+                m_dTs = 0;//发生拥塞时的时间
+                m_rTs = 0;
+                
+                new_rate = qp->m_rate * (1-alpha);
+                //更新速率
+                if (new_rate < m_hw->m_minRate)
+                    new_rate = m_hw->m_minRate;
+                if (new_rate > qp->m_max_rate)
+                    new_rate = qp->m_max_rate;
+                qp->m_rate = new_rate;
+                
+            }else if((m_dTs != 0 || m_rTs != 0) && m_dTs < m_rTs){//在一个窗口内空闲事件最后发生
+                m_lastUpdateTime = Simulator::Now().GetTimeStep();
+                m_lastUpdateSeq = next_seq;
+                m_lastWinSize = m_currentWinSize;
+                m_lastUpdateCongestTime = m_dTs;
+                m_currentWinSize = m_currentWinSize/m_ratio+m_hw->m_rai.GetBitRate()*qp->m_baseRtt;
+                //重置下面的变量
+                m_congestTimeStamp = 0;
+                m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+//                    m_dIsOwn = 3;
+//                    m_rIsOwn = 3;
+                m_depth = 0;
+                m_ratio = 1;
+                m_dTs = 0;//发生拥塞时的时间
+                m_rTs = 0;
+                
+                new_rate = m_currentWinSize / qp->m_baseRtt;
+                if (new_rate < m_hw->m_minRate)
+                    new_rate = m_hw->m_minRate;
+                if (new_rate > qp->m_max_rate)
+                    new_rate = qp->m_max_rate;
+                qp->m_rate = new_rate;
+            }
+        }
+    }
+}
+} /* namespace ns3 */
@@ -0,0 +1,195 @@
+#ifndef RDMA_CC_H
+#define RDMA_CC_H
+
+#include <ns3/ptr.h>
+#include <ns3/simple-ref-count.h>
+#include <ns3/data-rate.h>
+#include <ns3/event-id.h>
+
+namespace ns3 {
+
+class Packet;
+class RdmaHw;
+class RdmaQueuePair;
+class MyCustomHeader;
+
+/*
+ * Congestion control of a RdmaQueuePair. RdmaHw::CreateCc makes one per qp, of the algorithm
+ * selected by CcMode, so a qp only carries the state of the algorithm in use. The parameters
+ * are the attributes of RdmaHw.
+ *
+ * The algorithms get the feedback of the ENC ACKs (encHeader): the queue depth and rate ratio
+ * of at most MyIntHeader::maxNum hops, and the ECN echo. ACKs with the FLAG_SHARED bit were
+ * copied by the ENC switches from another flow on the same path.
+ */
+class RdmaCc : public SimpleRefCount<RdmaCc> {
+public:
+    RdmaCc(RdmaHw *hw);
+    virtual ~RdmaCc();
+
+    virtual void Init(Ptr<RdmaQueuePair> qp); // start from qp->m_rate and qp->m_win
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch) = 0; // ACK or NACK of the qp
+    virtual void HandleSharedAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch); // ignored by default
+    virtual void PktSent(Ptr<RdmaQueuePair> qp); // the NIC sent a packet of the qp, up to qp->snd_nxt
+    virtual void Stop(Ptr<RdmaQueuePair> qp); // the qp is complete, cancel the timers
+
+protected:
+    RdmaHw *m_hw;
+};
+
+/******************************
+ * Mellanox's version of DCQCN
+ *****************************/
+class RdmaCcDcqcn : public RdmaCc {
+public:
+    RdmaCcDcqcn(RdmaHw *hw);
+    virtual void Init(Ptr<RdmaQueuePair> qp);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+    virtual void Stop(Ptr<RdmaQueuePair> qp);
+
+private:
+    // the Mellanox's version of alpha update:
+    // every fixed time slot, update alpha.
+    void UpdateAlpha(Ptr<RdmaQueuePair> qp);
+    void ScheduleUpdateAlpha(Ptr<RdmaQueuePair> qp);
+
+    // Mellanox's version of CNP receive
+    void CnpReceived(Ptr<RdmaQueuePair> qp);
+
+    // Mellanox's version of rate decrease
+    // It checks every m_rateDecreaseInterval if CNP arrived (m_decrease_cnp_arrived).
+    // If so, decrease rate, and reset all rate increase related things
+    void CheckRateDecrease(Ptr<RdmaQueuePair> qp);
+    void ScheduleDecreaseRate(Ptr<RdmaQueuePair> qp, uint32_t delta);
+
+    // Mellanox's version of rate increase
+    void RateIncEventTimer(Ptr<RdmaQueuePair> qp);
+    void RateIncEvent(Ptr<RdmaQueuePair> qp);
+    void FastRecovery(Ptr<RdmaQueuePair> qp);
+    void ActiveIncrease(Ptr<RdmaQueuePair> qp);
+    void HyperIncrease(Ptr<RdmaQueuePair> qp);
+
+    DataRate m_targetRate;    //< Target rate
+    EventId m_eventUpdateAlpha;
+    double m_alpha;
+    bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
+    bool m_first_cnp; // indicate if the current CNP is the first CNP
+    EventId m_eventDecreaseRate;
+    bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
+    uint32_t m_rpTimeStage;
+    EventId m_rpTimer;
+};
+
+/***********************
+ * High Precision CC
+ ***********************/
+// The ENC INT has no byte counters and no per-hop entry for idle hops, so this is the single
+// rate HPCC, with the utilization estimated from the deepest queue reported (see GetUtil).
+class RdmaCcHpcc : public RdmaCc {
+public:
+    RdmaCcHpcc(RdmaHw *hw);
+    virtual void Init(Ptr<RdmaQueuePair> qp);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+
+private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch, bool fast_react);
+
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    uint32_t m_incStage;
+    double u;
+    uint64_t m_lastFeedback; // time of the last feedback, the weight of the next one in u
+};
+
+/**********************
+ * TIMELY
+ *********************/
+// The ENC ACK carries no timestamp: the sender times one packet at a time, from its
+// transmission to its ACK.
+class RdmaCcTimely : public RdmaCc {
+public:
+    RdmaCcTimely(RdmaHw *hw);
+    virtual void Init(Ptr<RdmaQueuePair> qp);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+    virtual void PktSent(Ptr<RdmaQueuePair> qp);
+
+private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp);
+
+    uint64_t m_rttSeq; // end of the packet being timed, 0 if none
+    uint64_t m_rttTime; // when it was sent
+    uint64_t m_rtt; // last RTT measured
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    uint32_t m_incStage;
+    uint64_t lastRtt;
+    double rttDiff;
+};
+
+/**********************
+ * DCTCP
+ *********************/
+class RdmaCcDctcp : public RdmaCc {
+public:
+    RdmaCcDctcp(RdmaHw *hw);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+
+private:
+    uint32_t m_lastUpdateSeq;
+    uint32_t m_caState;
+    uint32_t m_highSeq; // when to exit cwr
+    double m_alpha;
+    uint32_t m_ecnCnt;
+    uint32_t m_batchSizeOfAlpha;
+};
+
+/*********************
+ * HPCC-PINT
+ ********************/
+// The utilization estimate of RdmaCcHpcc, through the PINT encoding.
+class RdmaCcHpccPint : public RdmaCc {
+public:
+    RdmaCcHpccPint(RdmaHw *hw);
+    virtual void Init(Ptr<RdmaQueuePair> qp);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+
+private:
+    void UpdateRate(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch, bool fast_react);
+
+    uint32_t m_lastUpdateSeq;
+    DataRate m_curRate;
+    uint32_t m_incStage;
+};
+
+/*********************
+ * MY- CC
+ ********************/
+class RdmaCcMycc : public RdmaCc {
+public:
+    RdmaCcMycc(RdmaHw *hw);
+    virtual void Init(Ptr<RdmaQueuePair> qp);
+    virtual void HandleAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+    virtual void HandleSharedAck(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
+
+private:
+    uint32_t m_lastUpdateSeq;//上一次更新窗口时的seq
+    uint64_t m_lastUpdateTime;//上一次更新窗口的时间
+    uint64_t m_lastUpdateCongestTime;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
+    uint64_t m_lastUpdateIdleTime;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
+
+    uint32_t m_currentWinSize;//当前窗口的大小
+    uint32_t m_lastWinSize;//上一个窗口的大小
+
+    uint64_t m_congestTimeStamp;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
+    uint64_t m_idleTimeStamp;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
+    uint32_t m_depth; // in MyIntHeader::qlenUnit
+    uint16_t m_ratio;
+    uint64_t m_rTs;//队列空闲时的时间
+    uint64_t m_dTs;//发生拥塞时的时间
+    uint32_t m_max_dRate;
+    uint32_t m_max_rRate;
+};
+
+} /* namespace ns3 */
+
+#endif /* RDMA_CC_H */
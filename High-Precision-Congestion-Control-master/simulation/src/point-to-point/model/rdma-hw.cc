@@ -14,6 +14,7 @@
 #include "cn-header.h"
 #include "ns3/sequence-number.h"
 #include "ns3/tcp-header.h"
+#include "ns3/event-log.h"
 
 namespace ns3{
 
@@ -56,6 +57,26 @@ TypeId RdmaHw::GetTypeId (void)
                 BooleanValue(false),
                 MakeBooleanAccessor(&RdmaHw::m_backto0),
                 MakeBooleanChecker())
+        .AddAttribute("L2SelectiveRepeat",
+                "Layer 2 selective repeat: the receiver keeps the out-of-order packets and NACKs with SACK blocks. Overrides L2BackToZero.",
+                BooleanValue(false),
+                MakeBooleanAccessor(&RdmaHw::m_selectiveRepeat),
+                MakeBooleanChecker())
+        .AddAttribute("L2AckCoalesceBytes",
+                "Layer 2 ACK coalescing: hold the ACK of an uncongested flow until this many bytes are unacknowledged or L2AckCoalesceTime passed. An ECN mark, a queue of an MTU or more, a FIN or a NACK sends it at once. Disable if equals to 0.",
+                UintegerValue(0),
+                MakeUintegerAccessor(&RdmaHw::m_ackCoalesceBytes),
+                MakeUintegerChecker<uint32_t>())
+        .AddAttribute("L2AckCoalesceTime",
+                "Layer 2 ACK coalescing: the longest time an ACK is held, in microseconds",
+                DoubleValue(1.0),
+                MakeDoubleAccessor(&RdmaHw::m_ackCoalesceTime),
+                MakeDoubleChecker<double>())
+        .AddAttribute("PathHash",
+                "The switches fold the hops into a path hash in the INT of the data packets instead of sampling one, and the first packet of a flow lists them for the ENC switches.",
+                BooleanValue(false),
+                MakeBooleanAccessor(&RdmaHw::m_pathHash),
+                MakeBooleanChecker())
         .AddAttribute("EwmaGain",
                 "Control gain parameter which determines the level of rate decrease",
                 DoubleValue(1.0 / 16),
@@ -204,6 +225,10 @@ void RdmaHw::Setup(QpCompleteCallback cb){
     m_qpCompleteCallback = cb;
 }
 
+bool RdmaHw::HasRoute(uint32_t dip){
+    return m_routerMap.find(dip) != m_routerMap.end();
+}
+
 uint32_t RdmaHw::GetNicIdxOfQp(Ptr<RdmaQueuePair> qp){
     
     auto it = m_routerMap.find(qp->dip.Get());
@@ -226,6 +251,16 @@ Ptr<RdmaQueuePair> RdmaHw::GetQp(uint32_t dip, uint16_t sport, uint16_t pg){
         return it->second;
     return NULL;
 }
+Ptr<RdmaCc> RdmaHw::CreateCc(){
+    switch (m_cc_mode){
+        case 1: return Create<RdmaCcDcqcn>(this);
+        case 3: return Create<RdmaCcHpcc>(this);
+        case 7: return Create<RdmaCcTimely>(this);
+        case 8: return Create<RdmaCcDctcp>(this);
+        case 10: return Create<RdmaCcHpccPint>(this);
+        default: return Create<RdmaCcMycc>(this);
+    }
+}
 void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Address dip, uint16_t sport, uint16_t dport, uint32_t win, uint64_t baseRtt, Callback<void> notifyAppFinish){
     // create qp
     Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(pg, sip, dip, sport, dport);
@@ -245,20 +280,8 @@ void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Addre
     DataRate m_bps = m_nic[nic_idx].dev->GetDataRate();
     qp->m_rate = m_bps;
     qp->m_max_rate = m_bps;
-    if (m_cc_mode == 1){
-        qp->mlx.m_targetRate = m_bps;
-    }else if (m_cc_mode == 3){
-        qp->hp.m_curRate = m_bps;
-        if (m_multipleRate){
-            for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                qp->hp.hopState[i].Rc = m_bps;
-        }
-    }else if (m_cc_mode == 7){
-        qp->tmly.m_curRate = m_bps;
-    }else if (m_cc_mode == 10){
-        qp->hpccPint.m_curRate = m_bps;
-    }else
-        qp->mycc.m_currentWinSize = win;
+    qp->m_cc = CreateCc();
+    qp->m_cc->Init(qp);
 
     // Notify Nic
     m_nic[nic_idx].dev->NewQp(qp);
@@ -303,7 +326,12 @@ uint32_t RdmaHw::GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> qp){
 }
 void RdmaHw::DeleteRxQp(uint32_t dip, uint16_t pg, uint16_t dport){
     uint64_t key = ((uint64_t)dip << 32) | ((uint64_t)pg << 16) | (uint64_t)dport;
-    m_rxQpMap.erase(key);
+    auto it = m_rxQpMap.find(key);
+    if (it == m_rxQpMap.end())
+        return;
+    it->second->m_nackEvent.Cancel();
+    it->second->m_ackEvent.Cancel();
+    m_rxQpMap.erase(it);
 }
 
 int RdmaHw::ReceiveUdp(Ptr<Packet> p, MyCustomHeader &ch){
@@ -355,12 +383,10 @@ int RdmaHw::ReceiveUdp(Ptr<Packet> p, MyCustomHeader &ch){
 
 int RdmaHw::ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch){
     uint8_t ecnbits = ch.GetIpv4EcnBits();
-    std::cout<< "node\t" << m_node->GetId() << "tcp packet node num\t" << ch.tcp.ih.hinfo.nodeNum << "seq"<< ch.tcp.seq <<std::endl;
-    
     uint32_t payload_size = p->GetSize() - ch.GetSerializedSize();
-    std::cout << "packet_size" << p->GetSize() << "ch_size\t"<< ch.GetSerializedSize() << std::endl;
+    EVLOG(EVLOG_DEBUG, EvRxData, m_node->GetId(), ch.tcp.seq, payload_size, ch.tcp.ih.hinfo.nodeNum, ch.sip);
     // TODO find corresponding rx queue pair
-    Ptr<RdmaRxQueuePair> rxQp = GetRxQp(ch.dip, ch.sip, ch.tcp.dport, ch.tcp.sport, 0, true);
+    Ptr<RdmaRxQueuePair> rxQp = GetRxQp(ch.dip, ch.sip, ch.tcp.dport, ch.tcp.sport, ch.tcp.ih_pg, true);
     if (ecnbits != 0){
         rxQp->m_ecn_source.ecnbits |= ecnbits;
         rxQp->m_ecn_source.qfb++;
@@ -371,36 +397,100 @@ int RdmaHw::ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch){
     int x = ReceiverCheckSeq(ch.tcp.seq, rxQp, payload_size);
     // std::cout<< "tcp-seq"<< ch.tcp.seq << std::endl;
     if (x == 1 || x == 2){ //generate ACK or NACK
+        bool fin = ch.tcp.tcpFlags&0x01;
+        if (m_ackCoalesceBytes > 0 && CoalesceAck(rxQp, ch.tcp.ih, x == 1 && !ecnbits && !fin))
+            return 0;
 //        qbbHeader seqh;
         encHeader encH;
         encH.SetSeq(rxQp->ReceiverNextExpectedSeq);
-        encH.SetPG(0);
+        encH.SetPG(ch.tcp.ih_pg);
         encH.SetSport(ch.tcp.dport);
         encH.SetDport(ch.tcp.sport);
-        encH.SetFin(ch.tcp.tcpFlags&0x01);//添加fin标志位
-        encH.SetMyIntHeader(ch.tcp.ih);
-//        if (ecnbits)
-//            seqh.SetCnp();
-        std::cout<< "node\t" << m_node->GetId()  << "ack-seq"<< rxQp->ReceiverNextExpectedSeq <<std::endl;
-        Ptr<Packet> newp = Create<Packet>(std::max(60-14-20-(int)encH.GetSerializedSize(), 0));
-        newp->AddHeader(encH); //将ppp头部的上述信息写入到buffer中，方便后续在receive数据包时，ch从buffer中读取
+        encH.SetFin(fin);//添加fin标志位
+        encH.SetMyIntHeader(m_ackCoalesceBytes > 0 ? rxQp->m_ackInt : ch.tcp.ih);
+        if (ecnbits)
+            encH.SetFlags(encH.GetFlags() | (1 << encHeader::FLAG_CNP));
+        EVLOG(EVLOG_DEBUG, EvTxAck, m_node->GetId(), rxQp->ReceiverNextExpectedSeq, ch.tcp.dport, ch.tcp.sport, fin);
+        SendAck(rxQp, encH, x == 2);
+    }
+    return 0;
+}
 
-        Ipv4Header head;    // Prepare IPv4 header
-        head.SetDestination(Ipv4Address(ch.sip));
-        head.SetSource(Ipv4Address(ch.dip));
-        head.SetProtocol(x == 1 ? 0xFC : 0xFD); //ack=0xFC nack=0xFD
-        head.SetTtl(64);
-        head.SetPayloadSize(newp->GetSize());
-        head.SetIdentification(rxQp->m_ipid++);
+bool RdmaHw::CoalesceAck(Ptr<RdmaRxQueuePair> rxQp, const MyIntHeader &ih, bool canHold){
+    if (rxQp->m_ackHeld)
+        rxQp->m_ackInt.Merge(ih);
+    else
+        rxQp->m_ackInt = ih;
+    // a queue of a packet or more on the path is congestion, the sender hears of it at once
+    if (!canHold || ih.GetMaxDepth() >= m_mtu
+            || rxQp->ReceiverNextExpectedSeq - rxQp->m_lastAckSeq >= m_ackCoalesceBytes)
+        return false; // the caller sends the ACK or NACK, with m_ackInt
+    if (!rxQp->m_ackHeld){
+        rxQp->m_ackHeld = true;
+        rxQp->m_ackEvent = Simulator::Schedule(MicroSeconds(m_ackCoalesceTime), &RdmaHw::FlushAck, this, rxQp);
+    }
+    return true;
+}
 
-        newp->AddHeader(head);
-        AddHeader(newp, 0x800);    // Attach PPP header
-        // send
-        uint32_t nic_idx = GetNicIdxOfRxQp(rxQp);
-        m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
-        m_nic[nic_idx].dev->TriggerTransmit();
+void RdmaHw::FlushAck(Ptr<RdmaRxQueuePair> rxQp){
+    encHeader encH;
+    encH.SetSeq(rxQp->ReceiverNextExpectedSeq);
+    encH.SetPG(rxQp->m_ecn_source.qIndex);
+    encH.SetSport(rxQp->sport);
+    encH.SetDport(rxQp->dport);
+    encH.SetMyIntHeader(rxQp->m_ackInt);
+    EVLOG(EVLOG_DEBUG, EvTxAck, m_node->GetId(), rxQp->ReceiverNextExpectedSeq, rxQp->sport, rxQp->dport, 0);
+    SendAck(rxQp, encH, false);
+}
+
+void RdmaHw::SendAck(Ptr<RdmaRxQueuePair> rxQp, encHeader &encH, bool nack){
+    // it acknowledges what a held ACK would
+    if (rxQp->m_ackHeld){
+        rxQp->m_ackHeld = false;
+        rxQp->m_ackEvent.Cancel();
     }
-    return 0;
+    rxQp->m_lastAckSeq = rxQp->ReceiverNextExpectedSeq;
+    if (nack && m_selectiveRepeat){
+        uint32_t blocks[2 * encHeader::maxSack];
+        uint32_t n = rxQp->m_sack.GetBlocks(rxQp->ReceiverNextExpectedSeq, m_mtu, blocks, encHeader::maxSack);
+        encH.SetSack(blocks, n);
+        // the NACK or what the sender sends again may be lost, and nothing may follow it
+        rxQp->m_nackEvent.Cancel();
+        rxQp->m_nackEvent = Simulator::Schedule(MicroSeconds(m_nack_interval), &RdmaHw::NackTimeout, this, rxQp);
+    }
+    Ptr<Packet> newp = Create<Packet>(std::max(60-14-20-(int)encH.GetSerializedSize(), 0));
+    newp->AddHeader(encH); //将ppp头部的上述信息写入到buffer中，方便后续在receive数据包时，ch从buffer中读取
+
+    Ipv4Header head;    // Prepare IPv4 header
+    head.SetDestination(Ipv4Address(rxQp->dip));
+    head.SetSource(Ipv4Address(rxQp->sip));
+    head.SetProtocol(nack ? 0xFD : 0xFC); //ack=0xFC nack=0xFD
+    head.SetTtl(64);
+    head.SetPayloadSize(newp->GetSize());
+    head.SetIdentification(rxQp->m_ipid++);
+
+    newp->AddHeader(head);
+    AddHeader(newp, 0x800);    // Attach PPP header
+    if (!HasRoute(rxQp->dip))
+        return; // the sender is unreachable
+    // send
+    uint32_t nic_idx = GetNicIdxOfRxQp(rxQp);
+    m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
+    m_nic[nic_idx].dev->TriggerTransmit();
+}
+
+void RdmaHw::NackTimeout(Ptr<RdmaRxQueuePair> rxQp){
+    if (!rxQp->m_sack.Any())
+        return;
+    // NACK the hole again, without INT: the congestion control does not see it
+    rxQp->m_nackTimer = Simulator::Now() + MicroSeconds(m_nack_interval);
+    rxQp->m_lastNACK = rxQp->ReceiverNextExpectedSeq;
+    encHeader encH;
+    encH.SetSeq(rxQp->ReceiverNextExpectedSeq);
+    encH.SetPG(rxQp->m_ecn_source.qIndex);
+    encH.SetSport(rxQp->sport);
+    encH.SetDport(rxQp->dport);
+    SendAck(rxQp, encH, true);
 }
 
 
@@ -424,6 +514,8 @@ int RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader &ch){
     Ptr<RdmaQueuePair> qp = GetQp(ch.sip, udpport, qIndex);
     if (qp == NULL)
         std::cout << "ERROR: QCN NIC cannot find the flow\n";
+    if (!HasRoute(qp->dip.Get()))
+        return 0; // sent before the destination became unreachable
     // get nic
     uint32_t nic_idx = GetNicIdxOfQp(qp);
     Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
@@ -431,19 +523,7 @@ int RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader &ch){
     if (qp->m_rate == 0)            //lazy initialization
     {
         qp->m_rate = dev->GetDataRate();
-        if (m_cc_mode == 1){
-            qp->mlx.m_targetRate = dev->GetDataRate();
-        }else if (m_cc_mode == 3){
-            qp->hp.m_curRate = dev->GetDataRate();
-            if (m_multipleRate){
-                for (uint32_t i = 0; i < IntHeader::maxHop; i++)
-                    qp->hp.hopState[i].Rc = dev->GetDataRate();
-            }
-        }else if (m_cc_mode == 7){
-            qp->tmly.m_curRate = dev->GetDataRate();
-        }else if (m_cc_mode == 10){
-            qp->hpccPint.m_curRate = dev->GetDataRate();
-        }
+        qp->m_cc->Init(qp);
     }
     return 0;
 }
@@ -452,22 +532,22 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
     uint16_t qIndex = ch.ack.pg;
     uint16_t port = ch.ack.dport;
     uint32_t seq = ch.ack.seq;
-    std::cout<< "PG"<< qIndex << "dport" << port << "seq" << seq << "ch-ack-flag"<< ch.ack.flags << std::endl;
-    /*uint8_t cnp = (ch.ack.flags >> qbbHeader::FLAG_CNP) & 1;
-    int i;*/
+    EVLOG(EVLOG_DEBUG, EvRxAck, m_node->GetId(), seq, qIndex, port, ch.ack.flags);
     Ptr<RdmaQueuePair> qp = GetQp(ch.sip, port, qIndex);
     if (qp == NULL){
         std::cout << "ERROR: " << "node:" << m_node->GetId() << ' ' << (ch.l3Prot == 0xFC ? "ACK" : "NACK") << " NIC cannot find the flow\n";
         return 0;
     }
+    if (!HasRoute(qp->dip.Get()))
+        return 0; // sent before the destination became unreachable, its qp is not scheduled any more
 
-    if (ch.ack.flags == 0) { //自身数据包
+    if (!((ch.ack.flags >> encHeader::FLAG_SHARED) & 1)) { //自身数据包
         uint32_t nic_idx = GetNicIdxOfQp(qp);
         Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
         if (m_ack_interval == 0)
             std::cout << "ERROR: shouldn't receive ack\n";
         else {
-            if (!m_backto0){
+            if (!m_backto0 || m_selectiveRepeat){
                 qp->Acknowledge(seq);
             }else {
                 uint32_t goback_seq = seq / m_chunk * m_chunk;
@@ -475,34 +555,31 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch){
             }
             if (qp->IsFinished()){
                 QpComplete(qp);
+                // its CC is stopped and there is nothing to recover, only the scheduler has to drop it
+                dev->m_rdmaEQ->UpdateQp(qp);
+                dev->TriggerTransmit();
+                return 0;
             }
         }
-        if (ch.l3Prot == 0xFD) // NACK
-            RecoverQueue(qp);
-
-        // handle cnp
-        /*if (cnp){
-            if (m_cc_mode == 1){ // mlx version
-                cnp_received_mlx(qp);
-            }
-        }*/
-
-        if (m_cc_mode == 3){
-            //HandleAckHp(qp, p, ch);
-        }else if (m_cc_mode == 7){
-            //HandleAckTimely(qp, p, ch);
-        }else if (m_cc_mode == 8){
-            //HandleAckDctcp(qp, p, ch);
-        }else if (m_cc_mode == 10){
-            //HandleAckHpPint(qp, p, ch);
-        }else{
-            HandleAckMycc(qp, p, ch);
+        if (ch.l3Prot == 0xFD){ // NACK
+            if (m_selectiveRepeat)
+                RecoverSelective(qp, ch);
+            else
+                RecoverQueue(qp);
         }
+
+        // the ENC switches did not know the path of the hash, probe it at most once an RTT
+        if (((ch.ack.flags >> encHeader::FLAG_PROBE) & 1) && (uint64_t)Simulator::Now().GetTimeStep() >= qp->m_lastProbe + qp->m_baseRtt)
+            qp->m_probePath = true;
+        // every switch on the path reports its queue, only a NACK of the receiver's timer has no INT
+        if (ch.ack.ih.hinfo.depthNum + ch.ack.ih.hinfo.ratioNum + ch.ack.ih.hinfo.nodeNum > 0)
+            qp->m_cc->HandleAck(qp, p, ch);
         // ACK may advance the on-the-fly window, allowing more packets to send
+        dev->m_rdmaEQ->UpdateQp(qp);
         dev->TriggerTransmit();
         return 0;
     }else{
-        HandleAckMycc(qp, p, ch);
+        qp->m_cc->HandleSharedAck(qp, p, ch);
     }
     return 0;
     
@@ -526,6 +603,12 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> qp, uint32_t siz
     uint32_t expected = qp->ReceiverNextExpectedSeq;
     if (seq == expected){
         qp->ReceiverNextExpectedSeq = expected + size;
+        if (m_selectiveRepeat && qp->m_sack.Any()){
+            // it may fill a hole: skip what was received after it, NACK the next hole
+            qp->ReceiverNextExpectedSeq = qp->m_sack.Advance(qp->ReceiverNextExpectedSeq, m_mtu);
+            if (qp->m_sack.Any())
+                return ReceiverNack(qp);
+        }
         if (qp->ReceiverNextExpectedSeq >= qp->m_milestone_rx){
             qp->m_milestone_rx += m_ack_interval;
             return 1; //Generate ACK
@@ -535,21 +618,28 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> qp, uint32_t siz
             return 5;
         }
     } else if (seq > expected) {
-        // Generate NACK
-        if (Simulator::Now() >= qp->m_nackTimer || qp->m_lastNACK != expected){
-            qp->m_nackTimer = Simulator::Now() + MicroSeconds(m_nack_interval);
-            qp->m_lastNACK = expected;
-            if (m_backto0){
-                qp->ReceiverNextExpectedSeq = qp->ReceiverNextExpectedSeq / m_chunk*m_chunk;
-            }
-            return 2;
-        }else
-            return 4;
+        if (m_selectiveRepeat && !qp->m_sack.Add(expected, seq, size, m_mtu))
+            return 3; // Duplicate.
+        return ReceiverNack(qp);
     }else {
         // Duplicate.
         return 3;
     }
 }
+
+int RdmaHw::ReceiverNack(Ptr<RdmaRxQueuePair> qp){
+    uint32_t expected = qp->ReceiverNextExpectedSeq;
+    // Generate NACK
+    if (Simulator::Now() >= qp->m_nackTimer || qp->m_lastNACK != expected){
+        qp->m_nackTimer = Simulator::Now() + MicroSeconds(m_nack_interval);
+        qp->m_lastNACK = expected;
+        if (m_backto0 && !m_selectiveRepeat){
+            qp->ReceiverNextExpectedSeq = qp->ReceiverNextExpectedSeq / m_chunk*m_chunk;
+        }
+        return 2;
+    }else
+        return 4;
+}
 void RdmaHw::AddHeader (Ptr<Packet> p, uint16_t protocolNumber){
     PppHeader ppp;
     ppp.SetProtocol (EtherToPpp (protocolNumber));
@@ -568,13 +658,29 @@ void RdmaHw::RecoverQueue(Ptr<RdmaQueuePair> qp){
     qp->snd_nxt = qp->snd_una;
 }
 
+void RdmaHw::RecoverSelective(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch){
+    // the receiver NACKs the same hole again only after m_nack_interval: what was sent again is lost too,
+    // queue the holes from the start rather than after what is still queued
+    if (ch.ack.seq == qp->m_lastNackSeq){
+        qp->m_retx.clear();
+        qp->m_retxBytes = 0;
+        qp->m_retxHigh = ch.ack.seq;
+    }
+    qp->m_lastNackSeq = ch.ack.seq;
+
+    // the holes up to the last SACK block, the receiver NACKs again for the ones after it
+    uint64_t start = ch.ack.seq;
+    for (uint32_t i = 0; i < ch.ack.nSack; i++){
+        qp->Retransmit(start, ch.ack.sack[2 * i]);
+        start = ch.ack.sack[2 * i + 1];
+    }
+    if (ch.ack.nSack == 0) // no SACK block, e.g. only the NACK got through
+        qp->Retransmit(start, std::min(start + m_mtu, qp->snd_nxt));
+}
+
 void RdmaHw::QpComplete(Ptr<RdmaQueuePair> qp){
     NS_ASSERT(!m_qpCompleteCallback.IsNull());
-    if (m_cc_mode == 1){
-        Simulator::Cancel(qp->mlx.m_eventUpdateAlpha);
-        Simulator::Cancel(qp->mlx.m_eventDecreaseRate);
-        Simulator::Cancel(qp->mlx.m_rpTimer);
-    }
+    qp->m_cc->Stop(qp);
 
     // This callback will log info
     // It may also delete the rxQp on the receiver
@@ -595,6 +701,10 @@ void RdmaHw::AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx){
     m_routerMap[dip]= intf_idx;
 }
 
+void RdmaHw::ClearTableEntry(Ipv4Address &dstAddr){
+    m_routerMap.erase(dstAddr.Get());
+}
+
 void RdmaHw::ClearTable(){
     m_routerMap.clear();
 }
@@ -605,11 +715,14 @@ void RdmaHw::RedistributeQp(){
         if (m_nic[i].dev == NULL)
             continue;
         m_nic[i].qpGrp->Clear();
+        m_nic[i].dev->m_rdmaEQ->ClearQps();
     }
 
     // redistribute qp
     for (auto &it : m_qpMap){
         Ptr<RdmaQueuePair> qp = it.second;
+        if (!HasRoute(qp->dip.Get()))
+            continue; // the destination is unreachable, its qp is not scheduled on any NIC
         uint32_t nic_idx = GetNicIdxOfQp(qp);
         m_nic[nic_idx].qpGrp->AddQp(qp);
         // Notify Nic
@@ -618,12 +731,15 @@ void RdmaHw::RedistributeQp(){
 }
 
 Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
-    uint32_t payload_size = qp->GetBytesLeft();
-    bool fin = false;
-    if (m_mtu < payload_size)
-        payload_size = m_mtu;
-    else //剩余数据量小于等于一个MTU
-        fin == true;
+    uint64_t seq = qp->snd_nxt;
+    uint32_t payload_size = qp->NextRetransmit(m_mtu, seq);
+    bool retx = payload_size > 0;
+    if (!retx){
+        payload_size = qp->GetBytesLeft();
+        if (m_mtu < payload_size)
+            payload_size = m_mtu;
+    }
+    bool fin = seq + payload_size >= qp->m_size; //最后一段，重传时也要带fin
     
     Ptr<Packet> p = Create<Packet> (payload_size);
     // add SeqTsHeader
@@ -631,13 +747,21 @@ Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
 
     // seqTs.SetSeq (qp->snd_nxt);
     seqTs.SetPG (qp->m_pg);
+    if (m_pathHash){
+        seqTs.ih.hinfo.flags = MyIntHeader::PATH_HASH;
+        if (qp->m_probePath){
+            seqTs.ih.hinfo.flags |= MyIntHeader::PATH_PROBE;
+            qp->m_probePath = false;
+            qp->m_lastProbe = Simulator::Now().GetTimeStep();
+        }
+    }
     p->AddHeader(seqTs);
     // add udp header
     TcpHeader tcpHeader;
     tcpHeader.SetDestinationPort (qp->dport);
     tcpHeader.SetSourcePort (qp->sport);
     tcpHeader.SetFin(fin);//添加fin标志位
-    tcpHeader.SetSequenceNumber(SequenceNumber32((uint32_t)(qp->snd_nxt)));
+    tcpHeader.SetSequenceNumber(SequenceNumber32((uint32_t)seq));
     p->AddHeader (tcpHeader);
     // add ipv4 header
     Ipv4Header ipHeader;
@@ -655,7 +779,8 @@ Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
     p->AddHeader (ppp);
 
     // update state
-    qp->snd_nxt += payload_size;
+    if (!retx)
+        qp->snd_nxt += payload_size;
     qp->m_ipid++;
 
     // return
@@ -665,740 +790,38 @@ Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp){
 void RdmaHw::PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap){
     qp->lastPktSize = pkt->GetSize();
     UpdateNextAvail(qp, interframeGap, pkt->GetSize());
+    qp->m_cc->PktSent(qp);
 }
 
 void RdmaHw::UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size){
     Time sendingTime;
     if (m_rateBound)
-        sendingTime = interframeGap + Seconds(qp->m_rate.CalculateTxTime(pkt_size));
+        sendingTime = interframeGap + qp->m_rate.TxTime(pkt_size);
     else
-        sendingTime = interframeGap + Seconds(qp->m_max_rate.CalculateTxTime(pkt_size));
+        sendingTime = interframeGap + qp->m_max_rate.TxTime(pkt_size);
     qp->m_nextAvail = Simulator::Now() + sendingTime;
 }
 
 void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate){
     #if 1
-    Time sendingTime = Seconds(qp->m_rate.CalculateTxTime(qp->lastPktSize));
-    Time new_sendintTime = Seconds(new_rate.CalculateTxTime(qp->lastPktSize));
+    Time sendingTime = qp->m_rate.TxTime(qp->lastPktSize);
+    Time new_sendintTime = new_rate.TxTime(qp->lastPktSize);
     qp->m_nextAvail = qp->m_nextAvail + new_sendintTime - sendingTime;
-    // update nic's next avail event
-    uint32_t nic_idx = GetNicIdxOfQp(qp);
-    m_nic[nic_idx].dev->UpdateNextAvail(qp->m_nextAvail);
     #endif
 
     // change to new rate
     qp->m_rate = new_rate;
-}
-
-#define PRINT_LOG 0
-/******************************
- * Mellanox's version of DCQCN
- *****************************/
-void RdmaHw::UpdateAlphaMlx(Ptr<RdmaQueuePair> qp){
-    #if PRINT_LOG
-    //std::cout << Simulator::Now() << " alpha update:" << m_node->GetId() << ' ' << qp->mlx.m_alpha << ' ' << (int)qp->mlx.m_alpha_cnp_arrived << '\n';
-    //printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_alpha);
-    #endif
-    if (qp->mlx.m_alpha_cnp_arrived){
-        qp->mlx.m_alpha = (1 - m_g)*qp->mlx.m_alpha + m_g;     //binary feedback
-    }else {
-        qp->mlx.m_alpha = (1 - m_g)*qp->mlx.m_alpha;     //binary feedback
-    }
-    #if PRINT_LOG
-    //printf("%.6lf\n", qp->mlx.m_alpha);
-    #endif
-    qp->mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
-    ScheduleUpdateAlphaMlx(qp);
-}
-void RdmaHw::ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_alpha_resume_interval), &RdmaHw::UpdateAlphaMlx, this, qp);
-}
-
-void RdmaHw::cnp_received_mlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_alpha_cnp_arrived = true; // set CNP_arrived bit for alpha update
-    qp->mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
-    if (qp->mlx.m_first_cnp){
-        // init alpha
-        qp->mlx.m_alpha = 1;
-        qp->mlx.m_alpha_cnp_arrived = false;
-        // schedule alpha update
-        ScheduleUpdateAlphaMlx(qp);
-        // schedule rate decrease
-        ScheduleDecreaseRateMlx(qp, 1); // add 1 ns to make sure rate decrease is after alpha update
-        // set rate on first CNP
-        qp->mlx.m_targetRate = qp->m_rate = m_rateOnFirstCNP * qp->m_rate;
-        qp->mlx.m_first_cnp = false;
-    }
-}
-
-void RdmaHw::CheckRateDecreaseMlx(Ptr<RdmaQueuePair> qp){
-    ScheduleDecreaseRateMlx(qp, 0);
-    if (qp->mlx.m_decrease_cnp_arrived){
-        #if PRINT_LOG
-        printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-        #endif
-        bool clamp = true;
-        if (!m_EcnClampTgtRate){
-            if (qp->mlx.m_rpTimeStage == 0)
-                clamp = false;
-        }
-        if (clamp)
-            qp->mlx.m_targetRate = qp->m_rate;
-        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->mlx.m_alpha / 2));
-        // reset rate increase related things
-        qp->mlx.m_rpTimeStage = 0;
-        qp->mlx.m_decrease_cnp_arrived = false;
-        Simulator::Cancel(qp->mlx.m_rpTimer);
-        qp->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
-        #if PRINT_LOG
-        printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-        #endif
-    }
-}
-void RdmaHw::ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> qp, uint32_t delta){
-    qp->mlx.m_eventDecreaseRate = Simulator::Schedule(MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(delta), &RdmaHw::CheckRateDecreaseMlx, this, qp);
-}
-
-void RdmaHw::RateIncEventTimerMlx(Ptr<RdmaQueuePair> qp){
-    qp->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, qp);
-    RateIncEventMlx(qp);
-    qp->mlx.m_rpTimeStage++;
-}
-void RdmaHw::RateIncEventMlx(Ptr<RdmaQueuePair> qp){
-    // check which increase phase: fast recovery, active increase, hyper increase
-    if (qp->mlx.m_rpTimeStage < m_rpgThreshold){ // fast recovery
-        FastRecoveryMlx(qp);
-    }else if (qp->mlx.m_rpTimeStage == m_rpgThreshold){ // active increase
-        ActiveIncreaseMlx(qp);
-    }else { // hyper increase
-        HyperIncreaseMlx(qp);
-    }
-}
-
-void RdmaHw::FastRecoveryMlx(Ptr<RdmaQueuePair> qp){
-    #if PRINT_LOG
-    printf("%lu fast recovery: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
-    #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-}
-void RdmaHw::ActiveIncreaseMlx(Ptr<RdmaQueuePair> qp){
-    #if PRINT_LOG
-    printf("%lu active inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-    // get NIC
-    uint32_t nic_idx = GetNicIdxOfQp(qp);
-    Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
-    // increate rate
-    qp->mlx.m_targetRate += m_rai;
-    if (qp->mlx.m_targetRate > dev->GetDataRate())
-        qp->mlx.m_targetRate = dev->GetDataRate();
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
-    #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-}
-void RdmaHw::HyperIncreaseMlx(Ptr<RdmaQueuePair> qp){
-    #if PRINT_LOG
-    printf("%lu hyper inc: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-    // get NIC
+    if (!HasRoute(qp->dip.Get()))
+        return; // not scheduled on any NIC
+    // update nic's next avail event
     uint32_t nic_idx = GetNicIdxOfQp(qp);
-    Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
-    // increate rate
-    qp->mlx.m_targetRate += m_rhai;
-    if (qp->mlx.m_targetRate > dev->GetDataRate())
-        qp->mlx.m_targetRate = dev->GetDataRate();
-    qp->m_rate = (qp->m_rate / 2) + (qp->mlx.m_targetRate / 2);
-    #if PRINT_LOG
-    printf("(%.3lf %.3lf)\n", qp->mlx.m_targetRate.GetBitRate() * 1e-9, qp->m_rate.GetBitRate() * 1e-9);
-    #endif
-}
-
-
-/***********************
- * My CC
- ***********************/
-void RdmaHw::HandleAckMycc(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch){
-    //可能是自身的ack数据包，也可能是同set主机的ack数据包
-    //如果是第一个窗口或者当前窗口和上一个窗口的大小未发生改变的情况，此时不考虑过度反应
-    if (qp->mycc.m_lastUpdateSeq == 0 || qp->mycc.m_currentWinSize == qp->mycc.m_lastWinSize) {
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
-            int maxDepthIndex = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndex].depth) {
-                    maxDepthIndex = i;
-                }
-            }
-            uint64_t dDelta_time = Simulator::Now().GetTimeStep() - ch.ack.ih.dinfo[maxDepthIndex].ts;
-            if (dDelta_time < qp->mycc.m_congestTimeStamp) {
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndex].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_time;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndex].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndex].maxRate;
-                
-            }else if (qp->mycc.m_congestTimeStamp == 0){
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndex].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_time;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndex].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndex].maxRate;
-
-            }
-            
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
-            int maxRadioIndex = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndex].ratio) {
-                    maxRadioIndex = i;
-                }
-            }
-            uint64_t rDelta_time = Simulator::Now().GetTimeStep() - ch.ack.ih.rinfo[maxRadioIndex].ts;
-            if (rDelta_time < qp->mycc.m_idleTimeStamp) {
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndex].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_time;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndex].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndex].maxRate;
-
-            }else if (qp->mycc.m_congestTimeStamp == 0){
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndex].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_time;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndex].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndex].maxRate;
-
-            }
-        }
-    }else if(qp->mycc.m_currentWinSize < qp->mycc.m_lastWinSize){//当前窗口的大小小于上一个窗口的大小，防止对同一个拥塞事件作出反应
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息,只选择同set主机且在窗口内发生拥塞的数据包做为判断
-            int maxDepthIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
-                    maxDepthIndexOverReaction = i;
-                }
-            }
-            uint64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-            if (ch.ack.flags == 1 && dDelta_overReactionTime < qp->mycc.m_congestTimeStamp && ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts > qp->mycc.m_lastUpdateTime + 0.25*qp->m_baseRtt) {//
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }else if(qp->mycc.m_congestTimeStamp == 0 && ch.ack.flags == 1 && ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts > qp->mycc.m_lastUpdateTime + 0.25*qp->m_baseRtt){
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息，只选择
-            int maxRadioIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
-                    maxRadioIndexOverReaction = i;
-                }
-            }
-            uint64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-            if (rDelta_overReactionTime < qp->mycc.m_idleTimeStamp && ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts > qp->mycc.m_lastUpdateCongestTime) {
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-                
-            }else if(qp->mycc.m_idleTimeStamp == 0 && ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts > qp->mycc.m_lastUpdateCongestTime){
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-
-            }
-
-        }
-    }else{//当前窗口的大小大于上一个窗口的大小，防止对同一个空闲事件作出反应
-        if (ch.ack.ih.hinfo.depthNum != 0) {//数据包携带了队列长度信息
-            int maxDepthIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.depthNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.dinfo[i].depth > ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth) {
-                    maxDepthIndexOverReaction = i;
-                }
-            }
-            uint64_t dDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-            if (dDelta_overReactionTime < qp->mycc.m_congestTimeStamp && ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts > qp->mycc.m_idleTimeStamp) {//
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }else if(qp->mycc.m_congestTimeStamp == 0 && ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts > qp->mycc.m_idleTimeStamp){
-                qp->mycc.m_depth = ch.ack.ih.dinfo[maxDepthIndexOverReaction].depth;
-                qp->mycc.m_congestTimeStamp = dDelta_overReactionTime;
-                qp->mycc.m_dTs = ch.ack.ih.dinfo[maxDepthIndexOverReaction].ts;
-//                qp->mycc.m_dIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_dRate = ch.ack.ih.dinfo[maxDepthIndexOverReaction].maxRate;
-
-            }
-        }else if(ch.ack.ih.hinfo.ratioNum != 0 && ch.ack.ih.hinfo.depthNum == 0){//数据包只携带了速率比值信息
-            int maxRadioIndexOverReaction = 0;
-            for (int i = 0; i < ch.ack.ih.hinfo.ratioNum; ++i) { //获取最长的队列的索引
-                if (ch.ack.ih.rinfo[i].ratio > ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio) {
-                    maxRadioIndexOverReaction = i;
-                }
-            }
-            uint64_t rDelta_overReactionTime = Simulator::Now().GetTimeStep() - ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-            if (ch.ack.flags == 1 && rDelta_overReactionTime < qp->mycc.m_idleTimeStamp && ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts > qp->mycc.m_lastUpdateTime + 0.25*qp->m_baseRtt) {
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-
-            }else if(qp->mycc.m_idleTimeStamp == 0 && ch.ack.flags == 1 && ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts > qp->mycc.m_lastUpdateTime + 0.25*qp->m_baseRtt){
-                qp->mycc.m_ratio = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ratio;
-                qp->mycc.m_idleTimeStamp = rDelta_overReactionTime;
-                qp->mycc.m_rTs = ch.ack.ih.rinfo[maxRadioIndexOverReaction].ts;
-//                qp->mycc.m_rIsOwn = ch.ack.isOwn;
-                qp->mycc.m_max_rRate = ch.ack.ih.rinfo[maxRadioIndexOverReaction].maxRate;
-
-            }
-
-        }
-    }
-    
-    if (ch.ack.flags == 0) {//自身的数据包并且一个完整的RTT窗口之后，更新发送速率
-        DataRate new_rate;
-        uint32_t ack_seq = ch.ack.seq;
-        uint32_t next_seq = qp->snd_nxt;//snd_nxt为下一个发送的位置，它指向未发送但可以发送的第一个字节的序列号。
-        if (ack_seq > qp->mycc.m_lastUpdateSeq) { //一个完整RTT的窗口，此时更新发送速率
-            //todo:计算速率
-            if ((qp->mycc.m_dTs != 0 || qp->mycc.m_rTs != 0) && qp->mycc.m_dTs > qp->mycc.m_rTs) {//在一个窗口内拥塞事件最后发生
-                qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-                qp->mycc.m_lastUpdateSeq = next_seq;
-                qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-                qp->mycc.m_lastUpdateCongestTime = qp->mycc.m_dTs;
-                double alpha = qp->mycc.m_depth/(qp->mycc.m_depth + qp->mycc.m_max_dRate * qp->m_baseRtt);
-                qp->mycc.m_currentWinSize = qp->mycc.m_currentWinSize * (1-alpha);
-                //重置下面的变量
-                qp->mycc.m_congestTimeStamp = 0;
-                qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-//                    qp->mycc.m_dIsOwn = 3;
-//                    qp->mycc.m_rIsOwn = 3;
-                qp->mycc.m_depth = 0;
-                qp->mycc.m_ratio = 1;
-                qp->mycc.m_dTs = 0;//发生拥塞时的时间
-                qp->mycc.m_rTs = 0;
-                
-                new_rate = qp->m_rate * (1-alpha);
-                //更新速率
-                if (new_rate < m_minRate)
-                    new_rate = m_minRate;
-                if (new_rate > qp->m_max_rate)
-                    new_rate = qp->m_max_rate;
-                qp->m_rate = new_rate;
-                
-            }else if((qp->mycc.m_dTs != 0 || qp->mycc.m_rTs != 0) && qp->mycc.m_dTs < qp->mycc.m_rTs){//在一个窗口内空闲事件最后发生
-                qp->mycc.m_lastUpdateTime = Simulator::Now().GetTimeStep();
-                qp->mycc.m_lastUpdateSeq = next_seq;
-                qp->mycc.m_lastWinSize = qp->mycc.m_currentWinSize;
-                qp->mycc.m_lastUpdateCongestTime = qp->mycc.m_dTs;
-                qp->mycc.m_currentWinSize = qp->mycc.m_currentWinSize/qp->mycc.m_ratio+m_rai.GetBitRate()*qp->m_baseRtt;
-                //重置下面的变量
-                qp->mycc.m_congestTimeStamp = 0;
-                qp->mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-//                    qp->mycc.m_dIsOwn = 3;
-//                    qp->mycc.m_rIsOwn = 3;
-                qp->mycc.m_depth = 0;
-                qp->mycc.m_ratio = 1;
-                qp->mycc.m_dTs = 0;//发生拥塞时的时间
-                qp->mycc.m_rTs = 0;
-                
-                new_rate = qp->mycc.m_currentWinSize / qp->m_baseRtt;
-                if (new_rate < m_minRate)
-                    new_rate = m_minRate;
-                if (new_rate > qp->m_max_rate)
-                    new_rate = qp->m_max_rate;
-                qp->m_rate = new_rate;
-            }
-        }
-    }
-}
-
-
-
-
-
-
-/***********************
- * High Precision CC
- ***********************/
-void RdmaHw::HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-    uint32_t ack_seq = ch.ack.seq;
-    // update rate
-    if (ack_seq > qp->hp.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
-        UpdateRateHp(qp, p, ch, false);
-    }else{ // do fast react
-        FastReactHp(qp, p, ch);
-    }
-}
-
-void RdmaHw::UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react){
-    uint32_t next_seq = qp->snd_nxt;
-    bool print = !fast_react || true;
-    if (qp->hp.m_lastUpdateSeq == 0){ // first RTT
-        qp->hp.m_lastUpdateSeq = next_seq;
-        // store INT
-        IntHeader &ih = ch.ack.ih;
-        NS_ASSERT(ih.nhop <= IntHeader::maxHop);
-        for (uint32_t i = 0; i < ih.nhop; i++)
-            qp->hp.hop[i] = ih.hop[i];
-        #if PRINT_LOG
-        if (print){
-            printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->hp.m_lastUpdateSeq, ch.ack.seq, next_seq);
-            for (uint32_t i = 0; i < ih.nhop; i++)
-                printf(" %u %lu %lu", ih.hop[i].GetQlen(), ih.hop[i].GetBytes(), ih.hop[i].GetTime());
-            printf("\n");
-        }
-        #endif
-    }else {
-        // check packet INT
-        IntHeader &ih = ch.ack.ih;
-        if (ih.nhop <= IntHeader::maxHop){
-            double max_c = 0;
-            bool inStable = false;
-            #if PRINT_LOG
-            if (print)
-                printf("%lu %s %08x %08x %u %u [%u,%u,%u]", Simulator::Now().GetTimeStep(), fast_react? "fast" : "update", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->hp.m_lastUpdateSeq, ch.ack.seq, next_seq);
-            #endif
-            // check each hop
-            double U = 0;
-            uint64_t dt = 0;
-            bool updated[IntHeader::maxHop] = {false}, updated_any = false;
-            NS_ASSERT(ih.nhop <= IntHeader::maxHop);
-            for (uint32_t i = 0; i < ih.nhop; i++){
-                if (m_sampleFeedback){
-                    if (ih.hop[i].GetQlen() == 0 && fast_react)
-                        continue;
-                }
-                updated[i] = updated_any = true;
-                #if PRINT_LOG
-                if (print)
-                    printf(" %u(%u) %lu(%lu) %lu(%lu)", ih.hop[i].GetQlen(), qp->hp.hop[i].GetQlen(), ih.hop[i].GetBytes(), qp->hp.hop[i].GetBytes(), ih.hop[i].GetTime(), qp->hp.hop[i].GetTime());
-                #endif
-                uint64_t tau = ih.hop[i].GetTimeDelta(qp->hp.hop[i]);;
-                double duration = tau * 1e-9;
-                double txRate = (ih.hop[i].GetBytesDelta(qp->hp.hop[i])) * 8 / duration;
-                double u = txRate / ih.hop[i].GetLineRate() + (double)std::min(ih.hop[i].GetQlen(), qp->hp.hop[i].GetQlen()) * qp->m_max_rate.GetBitRate() / ih.hop[i].GetLineRate() /qp->m_win;//获取的是该窗口内收到的队列长度最小
-                #if PRINT_LOG
-                if (print)
-                    printf(" %.3lf %.3lf", txRate, u);
-                #endif
-                if (!m_multipleRate){
-                    // for aggregate (single R)
-                    if (u > U){
-                        U = u;
-                        dt = tau;
-                    }
-                }else {
-                    // for per hop (per hop R)
-                    if (tau > qp->m_baseRtt)
-                        tau = qp->m_baseRtt;
-                    qp->hp.hopState[i].u = (qp->hp.hopState[i].u * (qp->m_baseRtt - tau) + u * tau) / double(qp->m_baseRtt);
-                }
-                qp->hp.hop[i] = ih.hop[i];
-            }
-
-            DataRate new_rate;
-            int32_t new_incStage;
-            DataRate new_rate_per_hop[IntHeader::maxHop];
-            int32_t new_incStage_per_hop[IntHeader::maxHop];
-            if (!m_multipleRate){
-                // for aggregate (single R)
-                if (updated_any){
-                    if (dt > qp->m_baseRtt)
-                        dt = qp->m_baseRtt;
-                    qp->hp.u = (qp->hp.u * (qp->m_baseRtt - dt) + U * dt) / double(qp->m_baseRtt);
-                    max_c = qp->hp.u / m_targetUtil;
-
-                    if (max_c >= 1 || qp->hp.m_incStage >= m_miThresh){
-                        new_rate = qp->hp.m_curRate / max_c + m_rai;
-                        new_incStage = 0;
-                    }else{
-                        new_rate = qp->hp.m_curRate + m_rai;
-                        new_incStage = qp->hp.m_incStage+1;
-                    }
-                    if (new_rate < m_minRate)
-                        new_rate = m_minRate;
-                    if (new_rate > qp->m_max_rate)
-                        new_rate = qp->m_max_rate;
-                    #if PRINT_LOG
-                    if (print)
-                        printf(" u=%.6lf U=%.3lf dt=%u max_c=%.3lf", qp->hp.u, U, dt, max_c);
-                    #endif
-                    #if PRINT_LOG
-                    if (print)
-                        printf(" rate:%.3lf->%.3lf\n", qp->hp.m_curRate.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
-                    #endif
-                }
-            }else{
-                // for per hop (per hop R)
-                new_rate = qp->m_max_rate;
-                for (uint32_t i = 0; i < ih.nhop; i++){
-                    if (updated[i]){
-                        double c = qp->hp.hopState[i].u / m_targetUtil;
-                        if (c >= 1 || qp->hp.hopState[i].incStage >= m_miThresh){
-                            new_rate_per_hop[i] = qp->hp.hopState[i].Rc / c + m_rai;
-                            new_incStage_per_hop[i] = 0;
-                        }else{
-                            new_rate_per_hop[i] = qp->hp.hopState[i].Rc + m_rai;
-                            new_incStage_per_hop[i] = qp->hp.hopState[i].incStage+1;
-                        }
-                        // bound rate
-                        if (new_rate_per_hop[i] < m_minRate)
-                            new_rate_per_hop[i] = m_minRate;
-                        if (new_rate_per_hop[i] > qp->m_max_rate)
-                            new_rate_per_hop[i] = qp->m_max_rate;
-                        // find min new_rate
-                        if (new_rate_per_hop[i] < new_rate)
-                            new_rate = new_rate_per_hop[i];
-                        #if PRINT_LOG
-                        if (print)
-                            printf(" [%u]u=%.6lf c=%.3lf", i, qp->hp.hopState[i].u, c);
-                        #endif
-                        #if PRINT_LOG
-                        if (print)
-                            printf(" %.3lf->%.3lf", qp->hp.hopState[i].Rc.GetBitRate()*1e-9, new_rate.GetBitRate()*1e-9);
-                        #endif
-                    }else{
-                        if (qp->hp.hopState[i].Rc < new_rate)
-                            new_rate = qp->hp.hopState[i].Rc;
-                    }
-                }
-                #if PRINT_LOG
-                printf("\n");
-                #endif
-            }
-            if (updated_any)
-                ChangeRate(qp, new_rate);
-            if (!fast_react){
-                if (updated_any){
-                    qp->hp.m_curRate = new_rate;
-                    qp->hp.m_incStage = new_incStage;
-                }
-                if (m_multipleRate){
-                    // for per hop (per hop R)
-                    for (uint32_t i = 0; i < ih.nhop; i++){
-                        if (updated[i]){
-                            qp->hp.hopState[i].Rc = new_rate_per_hop[i];
-                            qp->hp.hopState[i].incStage = new_incStage_per_hop[i];
-                        }
-                    }
-                }
-            }
-        }
-        if (!fast_react){
-            if (next_seq > qp->hp.m_lastUpdateSeq)
-                qp->hp.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
-        }
-    }
-}
-
-void RdmaHw::FastReactHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-    if (m_fast_react)
-        UpdateRateHp(qp, p, ch, true);
-}
-
-/**********************
- * TIMELY
- *********************/
-void RdmaHw::HandleAckTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-    uint32_t ack_seq = ch.ack.seq;
-    // update rate
-    if (ack_seq > qp->tmly.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
-        UpdateRateTimely(qp, p, ch, false);
-    }else{ // do fast react
-        FastReactTimely(qp, p, ch);
-    }
-}
-void RdmaHw::UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool us){
-    uint32_t next_seq = qp->snd_nxt;
-    uint64_t rtt = Simulator::Now().GetTimeStep() - ch.ack.ih.ts;
-    bool print = !us;
-    if (qp->tmly.m_lastUpdateSeq != 0){ // not first RTT
-        int64_t new_rtt_diff = (int64_t)rtt - (int64_t)qp->tmly.lastRtt;
-        double rtt_diff = (1 - m_tmly_alpha) * qp->tmly.rttDiff + m_tmly_alpha * new_rtt_diff;
-        double gradient = rtt_diff / m_tmly_minRtt;
-        bool inc = false;
-        double c = 0;
-        #if PRINT_LOG
-        if (print)
-            printf("%lu node:%u rtt:%lu rttDiff:%.0lf gradient:%.3lf rate:%.3lf", Simulator::Now().GetTimeStep(), m_node->GetId(), rtt, rtt_diff, gradient, qp->tmly.m_curRate.GetBitRate() * 1e-9);
-        #endif
-        if (rtt < m_tmly_TLow){
-            inc = true;
-        }else if (rtt > m_tmly_THigh){
-            c = 1 - m_tmly_beta * (1 - (double)m_tmly_THigh / rtt);
-            inc = false;
-        }else if (gradient <= 0){
-            inc = true;
-        }else{
-            c = 1 - m_tmly_beta * gradient;
-            if (c < 0)
-                c = 0;
-            inc = false;
-        }
-        if (inc){
-            if (qp->tmly.m_incStage < 5){
-                qp->m_rate = qp->tmly.m_curRate + m_rai;
-            }else{
-                qp->m_rate = qp->tmly.m_curRate + m_rhai;
-            }
-            if (qp->m_rate > qp->m_max_rate)
-                qp->m_rate = qp->m_max_rate;
-            if (!us){
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage++;
-                qp->tmly.rttDiff = rtt_diff;
-            }
-        }else{
-            qp->m_rate = std::max(m_minRate, qp->tmly.m_curRate * c);
-            if (!us){
-                qp->tmly.m_curRate = qp->m_rate;
-                qp->tmly.m_incStage = 0;
-                qp->tmly.rttDiff = rtt_diff;
-            }
-        }
-        #if PRINT_LOG
-        if (print){
-            printf(" %c %.3lf\n", inc? '^':'v', qp->m_rate.GetBitRate() * 1e-9);
-        }
-        #endif
-    }
-    if (!us && next_seq > qp->tmly.m_lastUpdateSeq){
-        qp->tmly.m_lastUpdateSeq = next_seq;
-        // update
-        qp->tmly.lastRtt = rtt;
-    }
-}
-void RdmaHw::FastReactTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-}
-
-/**********************
- * DCTCP
- *********************/
-void RdmaHw::HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-    uint32_t ack_seq = ch.ack.seq;
-    uint8_t cnp = (ch.ack.flags >> qbbHeader::FLAG_CNP) & 1;
-    bool new_batch = false;
-
-    // update alpha
-    qp->dctcp.m_ecnCnt += (cnp > 0);
-    if (ack_seq > qp->dctcp.m_lastUpdateSeq){ // if full RTT feedback is ready, do alpha update
-        #if PRINT_LOG
-        printf("%lu %s %08x %08x %u %u [%u,%u,%u] %.3lf->", Simulator::Now().GetTimeStep(), "alpha", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->dctcp.m_lastUpdateSeq, ch.ack.seq, qp->snd_nxt, qp->dctcp.m_alpha);
-        #endif
-        new_batch = true;
-        if (qp->dctcp.m_lastUpdateSeq == 0){ // first RTT
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_batchSizeOfAlpha = qp->snd_nxt / m_mtu + 1;
-        }else {
-            double frac = std::min(1.0, double(qp->dctcp.m_ecnCnt) / qp->dctcp.m_batchSizeOfAlpha);
-            qp->dctcp.m_alpha = (1 - m_g) * qp->dctcp.m_alpha + m_g * frac;
-            qp->dctcp.m_lastUpdateSeq = qp->snd_nxt;
-            qp->dctcp.m_ecnCnt = 0;
-            qp->dctcp.m_batchSizeOfAlpha = (qp->snd_nxt - ack_seq) / m_mtu + 1;
-            #if PRINT_LOG
-            printf("%.3lf F:%.3lf", qp->dctcp.m_alpha, frac);
-            #endif
-        }
-        #if PRINT_LOG
-        printf("\n");
-        #endif
-    }
-
-    // check cwr exit
-    if (qp->dctcp.m_caState == 1){
-        if (ack_seq > qp->dctcp.m_highSeq)
-            qp->dctcp.m_caState = 0;
-    }
-
-    // check if need to reduce rate: ECN and not in CWR
-    if (cnp && qp->dctcp.m_caState == 0){
-        #if PRINT_LOG
-        printf("%lu %s %08x %08x %u %u %.3lf->", Simulator::Now().GetTimeStep(), "rate", qp->sip.Get(), qp->dip.Get(), qp->sport, qp->dport, qp->m_rate.GetBitRate()*1e-9);
-        #endif
-        qp->m_rate = std::max(m_minRate, qp->m_rate * (1 - qp->dctcp.m_alpha / 2));
-        #if PRINT_LOG
-        printf("%.3lf\n", qp->m_rate.GetBitRate() * 1e-9);
-        #endif
-        qp->dctcp.m_caState = 1;
-        qp->dctcp.m_highSeq = qp->snd_nxt;
-    }
-
-    // additive inc
-    if (qp->dctcp.m_caState == 0 && new_batch)
-        qp->m_rate = std::min(qp->m_max_rate, qp->m_rate + m_dctcp_rai);
+    m_nic[nic_idx].dev->UpdateNextAvail(qp->m_nextAvail);
+    // with VarWin the window follows the rate
+    m_nic[nic_idx].dev->m_rdmaEQ->UpdateQp(qp);
 }
 
-/*********************
- * HPCC-PINT
- ********************/
 void RdmaHw::SetPintSmplThresh(double p){
        pint_smpl_thresh = (uint32_t)(65536 * p);
 }
-void RdmaHw::HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch){
-       uint32_t ack_seq = ch.ack.seq;
-       if (rand() % 65536 >= pint_smpl_thresh)
-               return;
-       // update rate
-       if (ack_seq > qp->hpccPint.m_lastUpdateSeq){ // if full RTT feedback is ready, do full update
-               UpdateRateHpPint(qp, p, ch, false);
-       }else{ // do fast react
-               UpdateRateHpPint(qp, p, ch, true);
-       }
-}
-
-void RdmaHw::UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react){
-       uint32_t next_seq = qp->snd_nxt;
-       if (qp->hpccPint.m_lastUpdateSeq == 0){ // first RTT
-               qp->hpccPint.m_lastUpdateSeq = next_seq;
-       }else {
-               // check packet INT
-               IntHeader &ih = ch.ack.ih;
-               double U = Pint::decode_u(ih.GetPower());
-
-               DataRate new_rate;
-               int32_t new_incStage;
-               double max_c = U / m_targetUtil;
-
-               if (max_c >= 1 || qp->hpccPint.m_incStage >= m_miThresh){
-                       new_rate = qp->hpccPint.m_curRate / max_c + m_rai;
-                       new_incStage = 0;
-               }else{
-                       new_rate = qp->hpccPint.m_curRate + m_rai;
-                       new_incStage = qp->hpccPint.m_incStage+1;
-               }
-               if (new_rate < m_minRate)
-                       new_rate = m_minRate;
-               if (new_rate > qp->m_max_rate)
-                       new_rate = qp->m_max_rate;
-               ChangeRate(qp, new_rate);
-               if (!fast_react){
-                       qp->hpccPint.m_curRate = new_rate;
-                       qp->hpccPint.m_incStage = new_incStage;
-               }
-               if (!fast_react){
-                       if (next_seq > qp->hpccPint.m_lastUpdateSeq)
-                               qp->hpccPint.m_lastUpdateSeq = next_seq; //+ rand() % 2 * m_mtu;
-               }
-       }
-}
 
 }
@@ -3,6 +3,7 @@
 
 #include <ns3/rdma.h>
 #include <ns3/rdma-queue-pair.h>
+#include <ns3/rdma-cc.h>
 #include <ns3/node.h>
 #include <ns3/custom-header.h>
 #include <ns3/custom-header-niux.h>
@@ -38,8 +39,12 @@ public:
     uint32_t m_chunk;
     uint32_t m_ack_interval;
     bool m_backto0;
+    bool m_selectiveRepeat; // NACK with SACK blocks, the sender only sends the holes again
+    uint32_t m_ackCoalesceBytes; // hold the ACKs of an uncongested flow up to these bytes, 0 to ACK every milestone
+    double m_ackCoalesceTime; // or this long (us)
     bool m_var_win, m_fast_react;
     bool m_rateBound;
+    bool m_pathHash; // the switches hash the path into the INT, see MyIntHeader::PATH_HASH
     std::vector<RdmaInterfaceMgr> m_nic; // list of running nic controlled by this RdmaHw
     std::unordered_map<uint64_t, Ptr<RdmaQueuePair> > m_qpMap; // mapping from uint64_t to qp
     std::unordered_map<uint64_t, Ptr<RdmaRxQueuePair> > m_rxQpMap; // mapping from uint64_t to rx qp
@@ -53,6 +58,8 @@ public:
     void Setup(QpCompleteCallback cb); // setup shared data and callbacks with the QbbNetDevice
     static uint64_t GetQpKey(uint32_t dip, uint16_t sport, uint16_t pg); // get the lookup key for m_qpMap
     Ptr<RdmaQueuePair> GetQp(uint32_t dip, uint16_t sport, uint16_t pg); // get the qp
+    Ptr<RdmaCc> CreateCc(); // congestion control of a new qp, of the algorithm of m_cc_mode
+    bool HasRoute(uint32_t dip); // whether a NIC reaches dip, it has no table entry once unreachable
     uint32_t GetNicIdxOfQp(Ptr<RdmaQueuePair> qp); // get the NIC index of the qp
     void AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport, uint32_t win, uint64_t baseRtt, Callback<void> notifyAppFinish); // add a new qp (new send)
     void DeleteQueuePair(Ptr<RdmaQueuePair> qp);
@@ -65,19 +72,26 @@ public:
     int ReceiveTcp(Ptr<Packet> p, MyCustomHeader &ch);
     int ReceiveCnp(Ptr<Packet> p, CustomHeader &ch);
     int ReceiveAck(Ptr<Packet> p, MyCustomHeader &ch); // handle both ACK and NACK
+    void SendAck(Ptr<RdmaRxQueuePair> rxQp, encHeader &encH, bool nack); // with the SACK blocks for a NACK under selective repeat
+    void NackTimeout(Ptr<RdmaRxQueuePair> rxQp);
+    bool CoalesceAck(Ptr<RdmaRxQueuePair> rxQp, const MyIntHeader &ih, bool canHold); // merge ih into the held ACK, true if it is still held
+    void FlushAck(Ptr<RdmaRxQueuePair> rxQp); // send the held ACK
     int Receive(Ptr<Packet> p, MyCustomHeader &ch); // callback function that the QbbNetDevice should use when receive packets. Only NIC can call this function. And do not call this upon PFC
 
     void CheckandSendQCN(Ptr<RdmaRxQueuePair> q);
     int ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size);
+    int ReceiverNack(Ptr<RdmaRxQueuePair> q); // NACK the expected seq, unless it was within m_nack_interval
     void AddHeader (Ptr<Packet> p, uint16_t protocolNumber);
     static uint16_t EtherToPpp (uint16_t protocol);
 
     void RecoverQueue(Ptr<RdmaQueuePair> qp);
+    void RecoverSelective(Ptr<RdmaQueuePair> qp, MyCustomHeader &ch); // queue the holes between the SACK blocks
     void QpComplete(Ptr<RdmaQueuePair> qp);
     void SetLinkDown(Ptr<QbbNetDevice> dev);
 
     // call this function after the NIC is setup
     void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
+    void ClearTableEntry(Ipv4Address &dstAddr); // dstAddr is unreachable
     void ClearTable();
     void RedistributeQp();
 
@@ -85,6 +99,10 @@ public:
     void PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
     void UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size);
     void ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate);
+
+    /*
+     * Parameters of the congestion control algorithms, see rdma-cc.h
+     */
     /******************************
      * Mellanox's version of DCQCN
      *****************************/
@@ -98,27 +116,6 @@ public:
     DataRate m_rai;        //< Rate of additive increase
     DataRate m_rhai;        //< Rate of hyper-additive increase
 
-    // the Mellanox's version of alpha update:
-    // every fixed time slot, update alpha.
-    void UpdateAlphaMlx(Ptr<RdmaQueuePair> q);
-    void ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> q);
-
-    // Mellanox's version of CNP receive
-    void cnp_received_mlx(Ptr<RdmaQueuePair> q);
-
-    // Mellanox's version of rate decrease
-    // It checks every m_rateDecreaseInterval if CNP arrived (m_decrease_cnp_arrived).
-    // If so, decrease rate, and reset all rate increase related things
-    void CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q);
-    void ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q, uint32_t delta);
-
-    // Mellanox's version of rate increase
-    void RateIncEventTimerMlx(Ptr<RdmaQueuePair> q);
-    void RateIncEventMlx(Ptr<RdmaQueuePair> q);
-    void FastRecoveryMlx(Ptr<RdmaQueuePair> q);
-    void ActiveIncreaseMlx(Ptr<RdmaQueuePair> q);
-    void HyperIncreaseMlx(Ptr<RdmaQueuePair> q);
-
     /***********************
      * High Precision CC
      ***********************/
@@ -127,38 +124,23 @@ public:
     uint32_t m_miThresh;
     bool m_multipleRate;
     bool m_sampleFeedback; // only react to feedback every RTT, or qlen > 0
-    void HandleAckHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
-    void UpdateRateHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react);
-    void UpdateRateHpTest(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react);
-    void FastReactHp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
 
     /**********************
      * TIMELY
      *********************/
     double m_tmly_alpha, m_tmly_beta;
     uint64_t m_tmly_TLow, m_tmly_THigh, m_tmly_minRtt;
-    void HandleAckTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
-    void UpdateRateTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool us);
-    void FastReactTimely(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
 
     /**********************
      * DCTCP
      *********************/
     DataRate m_dctcp_rai;
-    void HandleAckDctcp(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
 
     /*********************
      * HPCC-PINT
      ********************/
     uint32_t pint_smpl_thresh;
     void SetPintSmplThresh(double p);
-    void HandleAckHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch);
-    void UpdateRateHpPint(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader &ch, bool fast_react);
-    
-    /*********************
-     * MY- CC
-     ********************/
-    void HandleAckMycc(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, MyCustomHeader &ch);
 };
 
 } /* namespace ns3 */
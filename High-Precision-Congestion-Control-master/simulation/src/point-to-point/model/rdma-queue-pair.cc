@@ -6,6 +6,7 @@
 #include <ns3/simulator.h>
 #include "ns3/ppp-header.h"
 #include "rdma-queue-pair.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -34,61 +35,14 @@ RdmaQueuePair::RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, ui
     m_baseRtt = 0;
     m_max_rate = 0;
     m_var_win = false;
+    m_probePath = true;
+    m_lastProbe = 0;
     m_rate = 0;
     m_nextAvail = Time(0);
-    mlx.m_alpha = 1;
-    mlx.m_alpha_cnp_arrived = false;
-    mlx.m_first_cnp = true;
-    mlx.m_decrease_cnp_arrived = false;
-    mlx.m_rpTimeStage = 0;
-    
-    
-    mycc.m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_lastUpdateSeq = 0;
-
-    mycc.m_lastUpdateTime = 0;//上一次更新窗口的时间
-    mycc.m_lastUpdateCongestTime = 0;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
-    mycc.m_lastUpdateIdleTime = 0;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
-
-    mycc.m_currentWinSize = 0;//当前窗口的大小
-    mycc.m_lastWinSize = 0;//上一个窗口的大小
-
-    mycc.m_congestTimeStamp = 0;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_idleTimeStamp = 0;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-    mycc.m_depth = 0;
-    mycc.m_ratio = 0;
-    mycc.m_rTs = 0;//队列空闲时的时间
-    mycc.m_dTs = 0;//发生拥塞时的时间
-    mycc.m_max_dRate = 0;
-    mycc.m_max_rRate = 0;
-    
-    
-    hp.m_lastUpdateSeq = 0;
-    for (uint32_t i = 0; i < sizeof(hp.keep) / sizeof(hp.keep[0]); i++)
-        hp.keep[i] = 0;
-    hp.m_incStage = 0;
-    hp.m_lastGap = 0;
-    hp.u = 1;
-    for (uint32_t i = 0; i < IntHeader::maxHop; i++){
-        hp.hopState[i].u = 1;
-        hp.hopState[i].incStage = 0;
-    }
-
-    tmly.m_lastUpdateSeq = 0;
-    tmly.m_incStage = 0;
-    tmly.lastRtt = 0;
-    tmly.rttDiff = 0;
-
-    dctcp.m_lastUpdateSeq = 0;
-    dctcp.m_caState = 0;
-    dctcp.m_highSeq = 0;
-    dctcp.m_alpha = 1;
-    dctcp.m_ecnCnt = 0;
-    dctcp.m_batchSizeOfAlpha = 0;
-
-    hpccPint.m_lastUpdateSeq = 0;
-    hpccPint.m_incStage = 0;
+    m_schedSeq = 0;
+    m_retxBytes = 0;
+    m_retxHigh = 0;
+    m_lastNackSeq = 0;
 }
 
 void RdmaQueuePair::SetSize(uint64_t size){
@@ -112,7 +66,7 @@ void RdmaQueuePair::SetAppNotifyCallback(Callback<void> notifyAppFinish){
 }
 
 uint64_t RdmaQueuePair::GetBytesLeft(){
-    return m_size >= snd_nxt ? m_size - snd_nxt : 0;
+    return (m_size >= snd_nxt ? m_size - snd_nxt : 0) + m_retxBytes;
 }
 
 uint32_t RdmaQueuePair::GetHash(void){
@@ -133,7 +87,43 @@ uint32_t RdmaQueuePair::GetHash(void){
 void RdmaQueuePair::Acknowledge(uint64_t ack){
     if (ack > snd_una){
         snd_una = ack;
+        // a NACK overtaken by later packets of the flow went back before what they acknowledge
+        if (snd_nxt < snd_una)
+            snd_nxt = snd_una;
+    }
+}
+
+void RdmaQueuePair::Retransmit(uint64_t start, uint64_t end){
+    if (start < m_retxHigh)
+        start = m_retxHigh;
+    if (start >= end)
+        return;
+    m_retx.push_back(std::make_pair(start, end));
+    m_retxBytes += end - start;
+    m_retxHigh = end;
+}
+
+uint32_t RdmaQueuePair::NextRetransmit(uint32_t mtu, uint64_t &seq){
+    while (!m_retx.empty()){
+        std::pair<uint64_t, uint64_t> &r = m_retx.front();
+        if (r.first < snd_una){ // acknowledged in the meantime
+            uint64_t acked = std::min(r.second, snd_una) - r.first;
+            m_retxBytes -= acked;
+            r.first += acked;
+        }
+        if (r.first == r.second){
+            m_retx.pop_front();
+            continue;
+        }
+        seq = r.first;
+        uint32_t size = std::min((uint64_t)mtu, r.second - r.first);
+        r.first += size;
+        m_retxBytes -= size;
+        if (r.first == r.second)
+            m_retx.pop_front();
+        return size;
     }
+    return 0;
 }
 
 uint64_t RdmaQueuePair::GetOnTheFly(){
@@ -141,6 +131,8 @@ uint64_t RdmaQueuePair::GetOnTheFly(){
 }
 
 bool RdmaQueuePair::IsWinBound(){
+    if (m_retxBytes > 0) // the holes are in the window already
+        return false;
     uint64_t w = GetWin();
     return w != 0 && GetOnTheFly() >= w;
 }
@@ -159,22 +151,72 @@ uint64_t RdmaQueuePair::GetWin(){
     return w;
 }
 
-uint64_t RdmaQueuePair::HpGetCurWin(){
-    if (m_win == 0)
-        return 0;
-    uint64_t w;
-    if (m_var_win){
-        w = m_win * hp.m_curRate.GetBitRate() / m_max_rate.GetBitRate();
-        if (w == 0)
-            w = 1; // must > 0
-    }else{
-        w = m_win;
+bool RdmaQueuePair::IsFinished(){
+    return snd_una >= m_size;
+}
+
+/*********************
+ * RdmaSackBitmap
+ ********************/
+RdmaSackBitmap::RdmaSackBitmap() : m_bits(1, 0), m_mask(0), m_count(0), m_end(0){
+}
+
+bool RdmaSackBitmap::Add(uint32_t expected, uint32_t seq, uint32_t size, uint32_t mtu){
+    uint32_t seg = seq / mtu;
+    if (seg - expected / mtu >= m_bits.size() * 64)
+        Grow(expected, seg, mtu);
+    if (Test(seg))
+        return false;
+    m_bits[(seg >> 6) & m_mask] |= 1ull << (seg & 63);
+    m_count++;
+    if (seq + size > m_end)
+        m_end = seq + size;
+    return true;
+}
+
+uint32_t RdmaSackBitmap::Advance(uint32_t expected, uint32_t mtu){
+    uint32_t seg = expected / mtu;
+    while (m_count > 0 && Test(seg)){
+        m_bits[(seg >> 6) & m_mask] &= ~(1ull << (seg & 63));
+        m_count--;
+        seg++;
+        expected = std::min(seg * mtu, m_end);
     }
-    return w;
+    return expected;
 }
 
-bool RdmaQueuePair::IsFinished(){
-    return snd_una >= m_size;
+uint32_t RdmaSackBitmap::GetBlocks(uint32_t expected, uint32_t mtu, uint32_t *blocks, uint32_t max) const{
+    uint32_t n = 0, left = m_count;
+    bool in = false;
+    for (uint32_t seg = expected / mtu + 1; left > 0; seg++){
+        bool b = Test(seg);
+        if (b && !in){
+            if (n == max)
+                break;
+            blocks[2 * n] = seg * mtu;
+        }else if (!b && in){
+            blocks[2 * n + 1] = seg * mtu;
+            n++;
+        }
+        in = b;
+        left -= b;
+    }
+    if (in) // ends at the highest segment
+        blocks[2 * n++ + 1] = m_end;
+    return n;
+}
+
+void RdmaSackBitmap::Grow(uint32_t expected, uint32_t seg, uint32_t mtu){
+    uint32_t first = expected / mtu + 1, last = (m_end + mtu - 1) / mtu;
+    uint32_t words = m_bits.size();
+    while (seg - (first - 1) >= words * 64)
+        words *= 2;
+    std::vector<uint64_t> bits(words, 0);
+    for (uint32_t s = first; s < last; s++)
+        if (Test(s))
+            bits[(s >> 6) & (words - 1)] |= 1ull << (s & 63);
+    m_bits.swap(bits);
+    m_mask = words - 1;
 }
 
 /*********************
@@ -195,6 +237,8 @@ RdmaRxQueuePair::RdmaRxQueuePair(){
     m_nackTimer = Time(0);
     m_milestone_rx = 0;
     m_lastNACK = 0;
+    m_lastAckSeq = 0;
+    m_ackHeld = false;
 }
 
 uint32_t RdmaRxQueuePair::GetHash(void){
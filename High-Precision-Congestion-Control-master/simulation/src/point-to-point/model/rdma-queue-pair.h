@@ -7,8 +7,10 @@
 #include <ns3/data-rate.h>
 #include <ns3/event-id.h>
 #include <ns3/custom-header.h>
-#include <ns3/int-header.h>
+#include <ns3/int-header-niux.h>
+#include <ns3/rdma-cc.h>
 #include <vector>
+#include <deque>
 
 namespace ns3 {
 
@@ -28,75 +30,24 @@ public:
     Time m_nextAvail;    //< Soonest time of next send
     uint32_t wp; // current window of packets
     uint32_t lastPktSize;
+    bool m_probePath; // the next packet is a path probe, see MyIntHeader::PATH_PROBE
+    uint64_t m_lastProbe; // when the last probe was sent
+    uint64_t m_schedSeq; // round robin position in the NIC's RdmaEgressQueue
     Callback<void> m_notifyAppFinish;
 
+    /******************************
+     * selective repeat
+     *****************************/
+    std::deque<std::pair<uint64_t, uint64_t> > m_retx; // ranges [start, end) to send again, before snd_nxt
+    uint64_t m_retxBytes; // bytes in m_retx
+    uint64_t m_retxHigh; // end of what was sent again since the hole at m_lastNackSeq opened
+    uint64_t m_lastNackSeq;
+
     /******************************
      * runtime states
      *****************************/
     DataRate m_rate;    //< Current rate
-    struct {
-        DataRate m_targetRate;    //< Target rate
-        EventId m_eventUpdateAlpha;
-        double m_alpha;
-        bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
-        bool m_first_cnp; // indicate if the current CNP is the first CNP
-        EventId m_eventDecreaseRate;
-        bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
-        uint32_t m_rpTimeStage;
-        EventId m_rpTimer;
-    } mlx;
-    struct {
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        IntHop hop[IntHeader::maxHop];
-        uint32_t keep[IntHeader::maxHop];
-        uint32_t m_incStage;
-        double m_lastGap;
-        double u;
-        struct {
-            double u;
-            DataRate Rc;
-            uint32_t incStage;
-        }hopState[IntHeader::maxHop];
-    } hp;
-    struct{
-        uint32_t m_lastUpdateSeq;//上一次更新窗口时的seq
-        uint64_t m_lastUpdateTime;//上一次更新窗口的时间
-        uint64_t m_lastUpdateCongestTime;//上一次根据该数据包更新窗口时的数据包记录的拥塞发生的时间
-        uint64_t m_lastUpdateIdleTime;//上一次根据该数据包更新窗口时的数据包记录的空闲发生的时间
-
-        uint32_t m_currentWinSize;//当前窗口的大小
-        uint32_t m_lastWinSize;//上一个窗口的大小
-
-        uint64_t m_congestTimeStamp;//节点拥塞发生到接收到该数据包的目前窗口为止最小的时间
-        uint64_t m_idleTimeStamp;//节点空闲发生到接收到该数据包的目前窗口为止最小的时间
-        uint16_t m_depth;
-        uint16_t m_ratio;
-        uint32_t m_rTs;//队列空闲时的时间
-        uint32_t m_dTs;//发生拥塞时的时间
-        uint32_t m_max_dRate;
-        uint32_t m_max_rRate;
-    }mycc;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        uint32_t m_incStage;
-        uint64_t lastRtt;
-        double rttDiff;
-    } tmly;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        uint32_t m_caState;
-        uint32_t m_highSeq; // when to exit cwr
-        double m_alpha;
-        uint32_t m_ecnCnt;
-        uint32_t m_batchSizeOfAlpha;
-    } dctcp;
-    struct{
-        uint32_t m_lastUpdateSeq;
-        DataRate m_curRate;
-        uint32_t m_incStage;
-    }hpccPint;
+    Ptr<RdmaCc> m_cc; // state of the congestion control in use, see RdmaHw::CreateCc
     /***********
      * methods
      **********/
@@ -108,14 +59,38 @@ public:
     void SetVarWin(bool v);
     void SetAppNotifyCallback(Callback<void> notifyAppFinish);
 
-    uint64_t GetBytesLeft();
+    uint64_t GetBytesLeft(); // including the bytes to send again
     uint32_t GetHash(void);
     void Acknowledge(uint64_t ack);
+    void Retransmit(uint64_t start, uint64_t end); // send [start, end) again, except what was already
+    uint32_t NextRetransmit(uint32_t mtu, uint64_t &seq); // size and seq of the next segment to send again, 0 if none
     uint64_t GetOnTheFly();
     bool IsWinBound();
     uint64_t GetWin(); // window size calculated from m_rate
     bool IsFinished();
-    uint64_t HpGetCurWin(); // window size calculated from hp.m_curRate, used by HPCC
+};
+
+/*
+ * Segments a RdmaRxQueuePair received beyond ReceiverNextExpectedSeq, under selective repeat.
+ * The sender cuts the data at multiples of the MTU, so a segment is one bit, at seq / mtu in a
+ * ring that grows with the distance between the expected seq and the highest segment received.
+ */
+class RdmaSackBitmap {
+public:
+    RdmaSackBitmap();
+    bool Add(uint32_t expected, uint32_t seq, uint32_t size, uint32_t mtu); // false if already received
+    uint32_t Advance(uint32_t expected, uint32_t mtu); // the new expected seq, past the segments received from expected on
+    bool Any() const { return m_count > 0; }
+    uint32_t GetBlocks(uint32_t expected, uint32_t mtu, uint32_t *blocks, uint32_t max) const; // the first max ranges received, as [start, end) pairs
+
+private:
+    bool Test(uint32_t seg) const { return (m_bits[(seg >> 6) & m_mask] >> (seg & 63)) & 1; }
+    void Grow(uint32_t expected, uint32_t seg, uint32_t mtu);
+
+    std::vector<uint64_t> m_bits;
+    uint32_t m_mask; // m_bits.size() - 1
+    uint32_t m_count; // segments received
+    uint32_t m_end; // end of the highest segment received
 };
 
 class RdmaRxQueuePair : public Object { // Rx side queue pair
@@ -136,6 +111,12 @@ public:
     Time m_nackTimer;
     int32_t m_milestone_rx;
     uint32_t m_lastNACK;
+    RdmaSackBitmap m_sack;
+    EventId m_nackEvent; // NACK again while there is a hole, see RdmaHw::NackTimeout
+    uint32_t m_lastAckSeq; // the seq of the last ACK or NACK sent
+    bool m_ackHeld; // an ACK is held back by the coalescing, see RdmaHw::CoalesceAck
+    MyIntHeader m_ackInt; // the INT of the held ACK, merged from the packets it acknowledges
+    EventId m_ackEvent; // send the held ACK at the latest then
     EventId QcnTimerEvent; // if destroy this rxQp, remember to cancel this timer
 
     static TypeId GetTypeId (void);
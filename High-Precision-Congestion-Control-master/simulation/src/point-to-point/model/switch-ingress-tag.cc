@@ -0,0 +1,68 @@
+#include "switch-ingress-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (SwitchIngressTag);
+
+TypeId 
+SwitchIngressTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SwitchIngressTag")
+    .SetParent<Tag> ()
+    .AddConstructor<SwitchIngressTag> ()
+  ;
+  return tid;
+}
+TypeId 
+SwitchIngressTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+uint32_t 
+SwitchIngressTag::GetSerializedSize (void) const
+{
+  return 6;
+}
+void 
+SwitchIngressTag::Serialize (TagBuffer buf) const
+{
+  buf.WriteU32 (m_inDev);
+  buf.WriteU16 (m_intOffset);
+}
+void 
+SwitchIngressTag::Deserialize (TagBuffer buf)
+{
+  m_inDev = buf.ReadU32 ();
+  m_intOffset = buf.ReadU16 ();
+}
+void 
+SwitchIngressTag::Print (std::ostream &os) const
+{
+  os << "InDev=" << m_inDev << " IntOffset=" << m_intOffset;
+}
+SwitchIngressTag::SwitchIngressTag ()
+  : Tag (),
+    m_inDev (0),
+    m_intOffset (0)
+{
+}
+
+SwitchIngressTag::SwitchIngressTag (uint32_t inDev, uint16_t intOffset)
+  : Tag (),
+    m_inDev (inDev),
+    m_intOffset (intOffset)
+{
+}
+
+uint32_t
+SwitchIngressTag::GetInDev (void) const
+{
+  return m_inDev;
+}
+uint16_t
+SwitchIngressTag::GetIntOffset (void) const
+{
+  return m_intOffset;
+}
+
+} // namespace ns3
@@ -0,0 +1,34 @@
+#ifndef SWITCH_INGRESS_TAG_H
+#define SWITCH_INGRESS_TAG_H
+
+#include "ns3/tag.h"
+
+namespace ns3 {
+
+/*
+ * Attached by SwitchNode when a packet is admitted, removed at dequeue.
+ * It carries what the dequeue path needs from the ingress parse, so the packet
+ * is not parsed again: the ingress port and the byte offset of the INT header
+ * in the packet (0 if the switch does not update INT on this packet).
+ */
+class SwitchIngressTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buf) const;
+  virtual void Deserialize (TagBuffer buf);
+  virtual void Print (std::ostream &os) const;
+  SwitchIngressTag ();
+  SwitchIngressTag (uint32_t inDev, uint16_t intOffset);
+  uint32_t GetInDev (void) const;
+  uint16_t GetIntOffset (void) const;
+private:
+  uint32_t m_inDev;
+  uint16_t m_intOffset;
+};
+
+} // namespace ns3
+
+#endif /* SWITCH_INGRESS_TAG_H */
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/object-vector.h"
@@ -8,6 +9,7 @@
 #include "ns3/assert.h"
 #include "ns3/global-value.h"
 #include "ns3/boolean.h"
+#include "ns3/event-log.h"
 #include "ns3/simulator.h"
 #include "switch-mmu.h"
 
@@ -27,17 +29,17 @@ namespace ns3 {
 
         // headroom
         shared_used_bytes = 0;
-        memset(hdrm_bytes, 0, sizeof(hdrm_bytes));
-        memset(ingress_bytes, 0, sizeof(ingress_bytes));
-        memset(paused, 0, sizeof(paused));
-        memset(egress_bytes, 0, sizeof(egress_bytes));
+        n_port = 0;
+        total_hdrm = 0;
+        total_rsrv = 0;
+        qlen_mon_start = 0;
+        qlen_mon_interval = 0;
+        qlen_mon_samples = 0;
+        // per-port state is allocated by ConfigNPort
     }
     bool SwitchMmu::CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         if (psize + hdrm_bytes[port][qIndex] > headroom[port] && psize + GetSharedUsed(port, qIndex) > GetPfcThreshold(port)){
-            printf("%lu %u Drop: queue:%u,%u: Headroom full\n", Simulator::Now().GetTimeStep(), node_id, port, qIndex);
-            for (uint32_t i = 1; i < 64; i++)
-                printf("(%u,%u)", hdrm_bytes[i][3], ingress_bytes[i][3]);
-            printf("\n");
+            EVLOG(EVLOG_INFO, EvMmuDrop, node_id, port, qIndex, hdrm_bytes[port][qIndex], ingress_bytes[port][qIndex]);
             return false;
         }
         return true;
@@ -61,6 +63,10 @@ namespace ns3 {
     }
     void SwitchMmu::UpdateEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         egress_bytes[port][qIndex] += psize;
+        if (qlen_mon_interval > 0){
+            CountQlen(port, GetQlenSamples(Simulator::Now().GetTimeStep()));
+            qlen[port] += psize;
+        }
     }
     void SwitchMmu::RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         uint32_t from_hdrm = std::min(hdrm_bytes[port][qIndex], psize);
@@ -71,6 +77,10 @@ namespace ns3 {
     }
     void SwitchMmu::RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize){
         egress_bytes[port][qIndex] -= psize;
+        if (qlen_mon_interval > 0){
+            CountQlen(port, GetQlenSamples(Simulator::Now().GetTimeStep()));
+            qlen[port] -= psize;
+        }
     }
     bool SwitchMmu::CheckShouldPause(uint32_t port, uint32_t qIndex){
         return !paused[port][qIndex] && (hdrm_bytes[port][qIndex] > 0 || GetSharedUsed(port, qIndex) >= GetPfcThreshold(port));
@@ -108,14 +118,35 @@ namespace ns3 {
         return false;
     }
     void SwitchMmu::ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax){
+        NS_ASSERT_MSG(port <= n_port, "SwitchMmu::ConfigEcn: call ConfigNPort first");
         kmin[port] = _kmin * 1000;
         kmax[port] = _kmax * 1000;
         pmax[port] = _pmax;
     }
     void SwitchMmu::ConfigHdrm(uint32_t port, uint32_t size){
+        NS_ASSERT_MSG(port <= n_port, "SwitchMmu::ConfigHdrm: call ConfigNPort first");
+        if (port >= 1)
+            total_hdrm = total_hdrm - headroom[port] + size;
         headroom[port] = size;
     }
-    void SwitchMmu::ConfigNPort(uint32_t n_port){
+    void SwitchMmu::ConfigNPort(uint32_t _n_port){
+        // ports are 1.._n_port, existing settings and counters are kept
+        n_port = _n_port;
+        pfc_a_shift.resize(n_port + 1, 0);
+        headroom.resize(n_port + 1, 0);
+        kmin.resize(n_port + 1, 0);
+        kmax.resize(n_port + 1, 0);
+        pmax.resize(n_port + 1, 0);
+        std::array<uint32_t, qCnt> zero;
+        zero.fill(0);
+        hdrm_bytes.resize(n_port + 1, zero);
+        ingress_bytes.resize(n_port + 1, zero);
+        paused.resize(n_port + 1, zero);
+        egress_bytes.resize(n_port + 1, zero);
+        qlen.resize(n_port + 1, 0);
+        qlen_counted.resize(n_port + 1, 0);
+        qlen_cnt.resize(n_port + 1);
+
         total_hdrm = 0;
         total_rsrv = 0;
         for (uint32_t i = 1; i <= n_port; i++){
@@ -126,4 +157,32 @@ namespace ns3 {
     void SwitchMmu::ConfigBufferSize(uint32_t size){
         buffer_size = size;
     }
+    void SwitchMmu::ConfigQlenMon(uint64_t start, uint64_t end, uint32_t interval){
+        NS_ASSERT_MSG(interval > 0, "SwitchMmu::ConfigQlenMon: the interval must be positive");
+        qlen_mon_start = start;
+        qlen_mon_interval = interval;
+        qlen_mon_samples = (end > start ? (end - start + interval - 1) / interval : 0) + 1;
+    }
+
+    uint64_t SwitchMmu::GetQlenSamples(uint64_t t){
+        if (t <= qlen_mon_start)
+            return 0;
+        return std::min((t - qlen_mon_start - 1) / qlen_mon_interval + 1, qlen_mon_samples);
+    }
+    void SwitchMmu::CountQlen(uint32_t port, uint64_t samples){
+        // the queue length changes or is read: the samples since the last time saw the current one
+        if (samples <= qlen_counted[port])
+            return;
+        std::vector<uint32_t> &cnt = qlen_cnt[port];
+        uint32_t kb = qlen[port] / 1000;
+        if (cnt.size() < kb + 1)
+            cnt.resize(kb + 1);
+        cnt[kb] += samples - qlen_counted[port];
+        qlen_counted[port] = samples;
+    }
+    const std::vector<uint32_t>& SwitchMmu::GetQlenDistribution(uint32_t port){
+        if (qlen_mon_interval > 0)
+            CountQlen(port, GetQlenSamples(Simulator::Now().GetTimeStep() + 1));
+        return qlen_cnt[port];
+    }
 }
@@ -2,6 +2,8 @@
 #define SWITCH_MMU_H
 
 #include <unordered_map>
+#include <vector>
+#include <array>
 #include <ns3/node.h>
 
 namespace ns3 {
@@ -10,7 +12,6 @@ class Packet;
 
 class SwitchMmu: public Object{
 public:
-    static const uint32_t pCnt = 257;    // Number of ports used
     static const uint32_t qCnt = 8;    // Number of queues/priorities used
 
     static TypeId GetTypeId (void);
@@ -38,27 +39,46 @@ public:
 
     void ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax);
     void ConfigHdrm(uint32_t port, uint32_t size);
-    void ConfigNPort(uint32_t n_port);
+    void ConfigNPort(uint32_t _n_port);
     void ConfigBufferSize(uint32_t size);
+    void ConfigQlenMon(uint64_t start, uint64_t end, uint32_t interval);
 
-    // config
+    // histogram of the bytes queued at the port up to now: the samples of the grid of
+    // ConfigQlenMon at which i KB were queued, in cnt[i]
+    const std::vector<uint32_t>& GetQlenDistribution(uint32_t port);
+
+    // config, indexed by port, sized by ConfigNPort (port 0 is the loopback)
     uint32_t node_id;
+    uint32_t n_port;
     uint32_t buffer_size;
-    uint32_t pfc_a_shift[pCnt];
+    std::vector<uint32_t> pfc_a_shift;
     uint32_t reserve;
-    uint32_t headroom[pCnt];
+    std::vector<uint32_t> headroom;
     uint32_t resume_offset;
-    uint32_t kmin[pCnt], kmax[pCnt];
-    double pmax[pCnt];
+    std::vector<uint32_t> kmin, kmax;
+    std::vector<double> pmax;
     uint32_t total_hdrm;
     uint32_t total_rsrv;
 
-    // runtime
+    // runtime, indexed by [port][qIndex]
     uint32_t shared_used_bytes;
-    uint32_t hdrm_bytes[pCnt][qCnt];
-    uint32_t ingress_bytes[pCnt][qCnt];
-    uint32_t paused[pCnt][qCnt];
-    uint32_t egress_bytes[pCnt][qCnt];
+    std::vector<std::array<uint32_t, qCnt> > hdrm_bytes;
+    std::vector<std::array<uint32_t, qCnt> > ingress_bytes;
+    std::vector<std::array<uint32_t, qCnt> > paused;
+    std::vector<std::array<uint32_t, qCnt> > egress_bytes;
+
+    // queue length monitor, sampled at qlen_mon_start + k * qlen_mon_interval up to the first
+    // sample at or after qlen_mon_end; off while qlen_mon_interval is 0
+    uint64_t qlen_mon_start;
+    uint32_t qlen_mon_interval;
+    uint64_t qlen_mon_samples; // samples on the grid
+    std::vector<uint32_t> qlen; // egress bytes of the port, over all queues
+    std::vector<uint64_t> qlen_counted; // samples of the port added to its histogram so far
+    std::vector<std::vector<uint32_t> > qlen_cnt;
+
+private:
+    uint64_t GetQlenSamples(uint64_t t); // samples on the grid up to t, t excluded
+    void CountQlen(uint32_t port, uint64_t samples);
 };
 
 } /* namespace ns3 */
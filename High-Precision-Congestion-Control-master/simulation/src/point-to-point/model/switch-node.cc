@@ -2,7 +2,6 @@
 #include "ns3/ipv4.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/flow-id-tag.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
@@ -10,9 +9,12 @@
 //#include "enc-net-device.h"
 #include "qbb-net-device.h"
 #include "ppp-header.h"
+#include "switch-ingress-tag.h"
 #include "ns3/int-header-niux.h"
+#include "pfc-deadlock-detector.h"
 //#include "../../network/utils/int-header-niux.h"
 #include <cmath>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -31,6 +33,11 @@ TypeId SwitchNode::GetTypeId (void)
 			UintegerValue(0),
 			MakeUintegerAccessor(&SwitchNode::m_ccMode),
 			MakeUintegerChecker<uint32_t>())
+	.AddAttribute("PfcEnabled",
+			"Queue the packets of a flow by its priority group, the one PFC pauses. Otherwise data and ACKs go to queue 1.",
+			BooleanValue(false),
+			MakeBooleanAccessor(&SwitchNode::m_pfcEnabled),
+			MakeBooleanChecker())
 	.AddAttribute("AckHighPrio",
 			"Set high priority for ACK/NACK or not",
 			UintegerValue(0),
@@ -41,36 +48,71 @@ TypeId SwitchNode::GetTypeId (void)
 			UintegerValue(9000),
 			MakeUintegerAccessor(&SwitchNode::m_maxRtt),
 			MakeUintegerChecker<uint32_t>())
+	.AddAttribute("FlowletGap",
+			"Idle time (ns) after which a flow may move to the least congested next hop. Disable flowlet switching if equals to 0.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&SwitchNode::m_flowletGap),
+			MakeUintegerChecker<uint64_t>())
+	.AddAttribute("FlowletTableSize",
+			"Number of flowlet entries, indexed by the 5-tuple hash",
+			UintegerValue(4096),
+			MakeUintegerAccessor(&SwitchNode::m_flowletTableSize),
+			MakeUintegerChecker<uint32_t>(1))
+	.AddAttribute("FlowletFeedback",
+			"Weigh the next hops also by the queues the ACKs report back through them",
+			BooleanValue(false),
+			MakeBooleanAccessor(&SwitchNode::m_flowletFeedback),
+			MakeBooleanChecker())
   ;
   return tid;
 }
 
-SwitchNode::SwitchNode() {
+SwitchNode::SwitchNode() : SwitchNode(0) {}
+
+SwitchNode::SwitchNode(uint32_t systemId) : Node(systemId) {
 
     //id = 0;
 	m_node_type = 1;
+	m_ecmpSeed = m_id;
 
     m_mmu = CreateObject<SwitchMmu>();
-	for (uint32_t i = 0; i < pCnt; i++)
-		for (uint32_t j = 0; j < pCnt; j++)
-			for (uint32_t k = 0; k < qCnt; k++)
-				m_bytes[i][j][k] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_txBytes[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_lastPktSize[i] = m_lastPktTs[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		m_u[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
-		max_rate[i] = 0;
-}
-
-void SwitchNode::SetMaxRate(uint8_t _port, uint64_t _max_rate) {
+	m_routeSample = CreateObject<UniformRandomVariable>();
+	// per-port state is allocated by ConfigNPort
+}
+
+void SwitchNode::ResizePorts(uint32_t n){
+	if (m_txBytes.size() >= n)
+		return;
+	m_txBytes.resize(n, 0);
+	m_lastPktSize.resize(n, 0);
+	m_lastPktTs.resize(n, 0);
+	m_u.resize(n, 0);
+	max_rate.resize(n, 0);
+	m_pauseRefresh.resize(n);
+}
+
+void SwitchNode::ConfigNPort(uint32_t n_port){
+	// ports are 1..n_port, port 0 is the loopback
+	ResizePorts(n_port + 1);
+	m_mmu->ConfigNPort(n_port);
+}
+
+void SwitchNode::SetMaxRate(uint32_t _port, uint64_t _max_rate) {
+	ResizePorts(_port + 1);
 	max_rate[_port] = _max_rate;
 	Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(m_devices[_port]);
 	device->SetDataRate(_max_rate);
 }
 
+uint64_t SwitchNode::GetBytesKey(uint32_t inDev, uint32_t outDev, uint32_t qIndex){
+	return ((uint64_t)inDev << 32) | ((uint64_t)outDev << 8) | qIndex;
+}
+
+uint32_t SwitchNode::GetBytes(uint32_t inDev, uint32_t outDev, uint32_t qIndex){
+	auto it = m_bytes.find(GetBytesKey(inDev, outDev, qIndex));
+	return it == m_bytes.end() ? 0 : it->second;
+}
+
 int SwitchNode::GetOutDev(Ptr<const Packet> p, MyCustomHeader &ch){
 	// look up entries
 	auto entry = m_rtTable.find(ch.dip);
@@ -80,7 +122,9 @@ int SwitchNode::GetOutDev(Ptr<const Packet> p, MyCustomHeader &ch){
 		return -1;
 
 	// entry found
-	int nexthops = entry->second;
+	auto &nexthops = entry->second;
+	if (nexthops.size() == 1)
+		return nexthops[0];
 
 	// pick one next hop based on hash
 	union {
@@ -95,41 +139,156 @@ int SwitchNode::GetOutDev(Ptr<const Packet> p, MyCustomHeader &ch){
 		buf.u32[2] = ch.udp.sport | ((uint32_t)ch.udp.dport << 16);
 	else if (ch.l3Prot == 0xFC || ch.l3Prot == 0xFD)
 		buf.u32[2] = ch.ack.sport | ((uint32_t)ch.ack.dport << 16);
+	else
+		buf.u32[2] = 0;
+
+	uint32_t hash = EcmpHash(buf.u8, 12, m_ecmpSeed);
+	if (m_flowletGap > 0)
+		return GetFlowletPort(hash, ch.dip, nexthops);
+	return nexthops[hash % nexthops.size()];
+}
 
-	return nexthops;
+int SwitchNode::GetFlowletPort(uint32_t hash, uint32_t dip, const std::vector<int> &nexthops){
+	if (m_flowlets.empty())
+		m_flowlets.assign(m_flowletTableSize, Flowlet{-1, 0});
+	Flowlet &f = m_flowlets[hash % m_flowlets.size()];
+	uint64_t now = Simulator::Now().GetTimeStep();
+	// a new flowlet, or its port is no longer a next hop after a link failure
+	if (f.port < 0 || now - f.ts > m_flowletGap || std::find(nexthops.begin(), nexthops.end(), f.port) == nexthops.end()){
+		// the least congested, the ties broken by the hash (and so by the WCMP weights)
+		uint32_t start = hash % nexthops.size();
+		f.port = nexthops[start];
+		double best = GetPortCongestion(f.port, dip, now);
+		for (uint32_t i = 1; i < nexthops.size() && best > 0; i++){
+			int port = nexthops[(start + i) % nexthops.size()];
+			double c = GetPortCongestion(port, dip, now);
+			if (c < best){
+				best = c;
+				f.port = port;
+			}
+		}
+	}
+	f.ts = now;
+	return f.port;
+}
+
+// the utilization of the port, decayed over the time it has been idle, or the queues reported
+// further on the path to dip, as the time they take to drain at the port's rate over m_maxRtt
+double SwitchNode::GetPortCongestion(uint32_t port, uint32_t dip, uint64_t now){
+	uint64_t idle = now - m_lastPktTs[port];
+	double c = idle < m_maxRtt ? m_u[port] * (m_maxRtt - idle) / m_maxRtt : 0;
+	if (m_flowletFeedback){
+		auto it = m_pathCongestion.find((uint64_t)dip << 32 | port);
+		if (it != m_pathCongestion.end() && now - it->second.ts < m_maxRtt){
+			Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(m_devices[port]);
+			double B = dev->GetDataRate().GetBitRate() / 8; // Bps
+			c = std::max(c, it->second.depth * 1e9 / B / m_maxRtt);
+		}
+	}
+	return c;
+}
+
+// an ACK carries back the INT of the data it acknowledges, which left through the port of its flowlet
+void SwitchNode::UpdatePathCongestion(MyCustomHeader &ch){
+	if (ch.ack.flags & 1) // encHeader::FLAG_SHARED, a copy for another flow
+		return;
+	union {
+		uint8_t u8[4+4+2+2];
+		uint32_t u32[3];
+	} buf;
+	buf.u32[0] = ch.dip;
+	buf.u32[1] = ch.sip;
+	buf.u32[2] = ch.ack.dport | ((uint32_t)ch.ack.sport << 16);
+	uint32_t hash = EcmpHash(buf.u8, 12, m_ecmpSeed);
+	const Flowlet &f = m_flowlets[hash % m_flowlets.size()];
+	if (f.port < 0)
+		return;
+	PathCongestion &pc = m_pathCongestion[(uint64_t)ch.sip << 32 | f.port];
+	pc.depth = ch.ack.ih.GetMaxDepth();
+	pc.ts = Simulator::Now().GetTimeStep();
 }
 
 void SwitchNode::CheckAndSendPfc(uint32_t inDev, uint32_t qIndex){
 	Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(m_devices[inDev]);
 	if (m_mmu->CheckShouldPause(inDev, qIndex)){
+		device->SendPfc(qIndex, 0);
 		m_mmu->SetPause(inDev, qIndex);
+		if (PfcDeadlockDetector::s_mode != PfcDeadlockDetector::OFF){
+			// the packets of the ingress wait for the switches behind the ports they are queued at
+			uint32_t peer, peerPort;
+			for (uint32_t j = 1; j < m_devices.size(); j++)
+				if (GetBytes(inDev, j, qIndex) > 0 && GetPeerIngress(j, peer, peerPort))
+					PfcDeadlockDetector::AddEdge(m_id, inDev, peer, peerPort, qIndex);
+			PfcDeadlockDetector::Pause(m_id, inDev, qIndex);
+		}
+		uint32_t pauseTime = device->GetPauseTime();
+		if (pauseTime > 0) // PAUSE again at half the pause time, the last one is still in force when it arrives
+			m_pauseRefresh[inDev][qIndex] = Simulator::Schedule(NanoSeconds(pauseTime * 500), &SwitchNode::RefreshPause, this, inDev, qIndex, Simulator::Now());
 	}
 }
 void SwitchNode::CheckAndSendResume(uint32_t inDev, uint32_t qIndex){
 	Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(m_devices[inDev]);
 	if (m_mmu->CheckShouldResume(inDev, qIndex)){
+		device->SendPfc(qIndex, 1);
 		m_mmu->SetResume(inDev, qIndex);
+		m_pauseRefresh[inDev][qIndex].Cancel();
+		if (PfcDeadlockDetector::s_mode != PfcDeadlockDetector::OFF)
+			PfcDeadlockDetector::Resume(m_id, inDev, qIndex);
+	}
+}
+void SwitchNode::RefreshPause(uint32_t inDev, uint32_t qIndex, Time since){
+	Ptr<QbbNetDevice> device = DynamicCast<QbbNetDevice>(m_devices[inDev]);
+	if (PfcDeadlockDetector::IsMarked(m_id, inDev, qIndex, since)){
+		// break the deadlock: the upstream sends again, and what exceeds the headroom is dropped
+		// at admission until the ingress drains and CheckAndSendResume resumes it for good
+		device->SendPfc(qIndex, 1);
+		PfcDeadlockDetector::Resume(m_id, inDev, qIndex);
+		return;
 	}
+	device->SendPfc(qIndex, 0);
+	m_pauseRefresh[inDev][qIndex] = Simulator::Schedule(NanoSeconds(device->GetPauseTime() * 500), &SwitchNode::RefreshPause, this, inDev, qIndex, since);
+}
+
+bool SwitchNode::GetPeerIngress(uint32_t port, uint32_t &peer, uint32_t &peerPort){
+	Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(m_devices[port]);
+	Ptr<Channel> ch = dev->GetChannel();
+	Ptr<NetDevice> other = ch->GetDevice(0) == dev ? ch->GetDevice(1) : ch->GetDevice(0);
+	if (other->GetNode()->GetNodeType() != 1)
+		return false; // hosts do not pause
+	peer = other->GetNode()->GetId();
+	peerPort = other->GetIfIndex();
+	return true;
 }
 
-void SwitchNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch){
+// offset of the INT header the switch pushes to, 0 if the packet has none
+uint16_t SwitchNode::GetIntOffset(MyCustomHeader &ch){
+	if (ch.l3Prot != 0x06)
+		return 0;
+	// ppp, ipv4, tcp, then ih_seq (4B) and ih_pg (2B) before the INT header
+	return PppHeader::GetStaticSize() + ch.m_headerSize + ch.tcp.length * 4 + 6;
+}
+
+void SwitchNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch, uint32_t inDev){
+	if (m_flowletFeedback && !m_flowlets.empty() && (ch.l3Prot == 0xFC || ch.l3Prot == 0xFD))
+		UpdatePathCongestion(ch);
 	int idx = GetOutDev(p, ch);
 	if (idx >= 0){
 		NS_ASSERT_MSG(m_devices[idx]->IsLinkUp(), "The routing table look up should return link that is up");
 
-		// determine the qIndex
+		// determine the qIndex: with PFC, the priority group of the flow, which PFC pauses on the upstream NIC
+		// (checked against qCnt when the flow is read)
 		uint32_t qIndex;
-		/*if (ch.l3Prot == 0xFF || ch.l3Prot == 0xFE || (m_ackHighPrio && (ch.l3Prot == 0xFD || ch.l3Prot == 0xFC))){  //QCN or PFC or NACK, go highest priority
+		if (ch.l3Prot == 0xFF || ch.l3Prot == 0xFE || (m_ackHighPrio && (ch.l3Prot == 0xFD || ch.l3Prot == 0xFC))){  //QCN or PFC or NACK, go highest priority
 			qIndex = 0;
+		}else if (m_pfcEnabled && ch.l3Prot == 0x06){
+			qIndex = ch.tcp.ih_pg;
+		}else if (m_pfcEnabled && (ch.l3Prot == 0xFD || ch.l3Prot == 0xFC)){
+			qIndex = ch.ack.pg;
 		}else{
-			qIndex = (ch.l3Prot == 0x06 ? 1 : 1); // if TCP, put to queue 1
-		}*/
-		qIndex = 1;
+			qIndex = 1;
+		}
 
 		// admission control
-		FlowIdTag t;
-		p->PeekPacketTag(t);
-		uint32_t inDev = t.GetFlowId();
 		if (qIndex != 0){ //not highest priority
 			if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize()) && m_mmu->CheckEgressAdmission(idx, qIndex, p->GetSize())){			// Admission control
 				m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize());
@@ -139,15 +298,67 @@ void SwitchNode::SendToDev(Ptr<Packet>p, MyCustomHeader &ch){
 			}
 			CheckAndSendPfc(inDev, qIndex);
 		}
-		m_bytes[inDev][idx][qIndex] += p->GetSize();
+		uint32_t &bytes = m_bytes[GetBytesKey(inDev, idx, qIndex)];
+		uint32_t peer, peerPort;
+		if (bytes == 0 && PfcDeadlockDetector::s_mode != PfcDeadlockDetector::OFF && m_mmu->paused[inDev][qIndex]
+				&& GetPeerIngress(idx, peer, peerPort))
+			PfcDeadlockDetector::AddEdge(m_id, inDev, peer, peerPort, qIndex);
+		bytes += p->GetSize();
+		p->AddPacketTag(SwitchIngressTag(inDev, GetIntOffset(ch)));
 		m_devices[idx]->SwitchSend(qIndex, p, ch);
 	}else
 		return; // Drop
 }
 
+uint32_t SwitchNode::EcmpHash(const uint8_t* key, size_t len, uint32_t seed) {
+  uint32_t h = seed;
+  if (len > 3) {
+    const uint32_t* key_x4 = (const uint32_t*) key;
+    size_t i = len >> 2;
+    do {
+      uint32_t k = *key_x4++;
+      k *= 0xcc9e2d51;
+      k = (k << 15) | (k >> 17);
+      k *= 0x1b873593;
+      h ^= k;
+      h = (h << 13) | (h >> 19);
+      h += (h << 2) + 0xe6546b64;
+    } while (--i);
+    key = (const uint8_t*) key_x4;
+  }
+  if (len & 3) {
+    size_t i = len & 3;
+    uint32_t k = 0;
+    key = &key[i - 1];
+    do {
+      k <<= 8;
+      k |= *key--;
+    } while (--i);
+    k *= 0xcc9e2d51;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593;
+    h ^= k;
+  }
+  h ^= len;
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+void SwitchNode::SetEcmpSeed(uint32_t seed){
+	m_ecmpSeed = seed;
+}
+
 void SwitchNode::AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx){
 	uint32_t dip = dstAddr.Get();
-	m_rtTable[dip] = intf_idx;
+	m_rtTable[dip].push_back(intf_idx);
+}
+
+void SwitchNode::ClearTableEntry(Ipv4Address &dstAddr){
+	m_rtTable.erase(dstAddr.Get());
 }
 
 void SwitchNode::ClearTable(){
@@ -156,19 +367,25 @@ void SwitchNode::ClearTable(){
 
 // This function can only be called in switch mode
 bool SwitchNode::SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, MyCustomHeader &ch){
-	SendToDev(packet, ch);
+	SendToDev(packet, ch, device->GetIfIndex());
 	return true;
 }
 
 void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p){
-	FlowIdTag t;
-	p->PeekPacketTag(t);
+	SwitchIngressTag t;
+	p->RemovePacketTag(t);
 	if (qIndex != 0){
-		uint32_t inDev = t.GetFlowId();
+		uint32_t inDev = t.GetInDev();
 		m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize());
 		m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize());
-		m_bytes[inDev][ifIndex][qIndex] -= p->GetSize();
-		/*if (m_ecnEnabled){
+		auto it = m_bytes.find(GetBytesKey(inDev, ifIndex, qIndex));
+		NS_ASSERT_MSG(it != m_bytes.end() && it->second >= p->GetSize(), "SwitchNode: dequeue more bytes than enqueued");
+		it->second -= p->GetSize();
+		uint32_t peer, peerPort;
+		if (it->second == 0 && PfcDeadlockDetector::s_mode != PfcDeadlockDetector::OFF && m_mmu->paused[inDev][qIndex]
+				&& GetPeerIngress(ifIndex, peer, peerPort))
+			PfcDeadlockDetector::RemoveEdge(m_id, inDev, peer, peerPort, qIndex);
+		if (m_ecnEnabled){
 			bool egressCongested = m_mmu->ShouldSendCN(ifIndex, qIndex);
 			if (egressCongested){
 				PppHeader ppp;
@@ -179,38 +396,66 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 				p->AddHeader(h);
 				p->AddHeader(ppp);
 			}
-		}*/
+		}
 		//CheckAndSendPfc(inDev, qIndex);
 		CheckAndSendResume(inDev, qIndex);
 	}
 
-	m_txBytes[ifIndex] += p->GetSize();
-	m_lastPktSize[ifIndex] = p->GetSize();
-	m_lastPktTs[ifIndex] = Simulator::Now().GetTimeStep();
-	
-	uint8_t* buf = p->GetBuffer();
-	if (buf[PppHeader::GetStaticSize() + 9] == 0x06) {
-		MyIntHeader *ih = (MyIntHeader*)&buf[PppHeader::GetStaticSize() + 20 + 20 + 6];
+	if (t.GetIntOffset() != 0) {
+		// update INT in place, at the offset found when the packet was parsed at ingress. The records
+		// pushed grow the packet, before the byte counters below and the transmission see it.
+		uint32_t off = t.GetIntOffset();
+		uint8_t *buf = p->GetBuffer();
+		MyIntHeader ih;
+		uint32_t size = ih.Read(&buf[off]);
 		Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(m_devices[ifIndex]);
 
 		uint8_t id = m_id;
-		uint32_t ts = m_lastPktTs[ifIndex];
+		uint64_t ts = Simulator::Now().GetTimeStep();
 		int push_rst;
 		uint64_t _max_rate = max_rate[ifIndex]/8/1000000;
-		uint16_t depth = dev->GetQueue()->GetNBytesTotal();
-		push_rst = ih->PushDepth(id, ifIndex, depth, ts, _max_rate);
+		uint64_t depth = dev->GetQueue()->GetNBytesTotal();
+		push_rst = ih.PushDepth(id, ifIndex, depth, ts, _max_rate);
 
 		if (push_rst < 0) {
 			// uint64_t _ratio = 0;
 			// 乘10000将比值转化为整数值，比方90.12%会变为9012
 			uint64_t _ratio = (dev->GetDataRate().GetBitRate()*10000)/max_rate[ifIndex];
-			push_rst = ih->PushRatio(id, ifIndex, _ratio, ts, _max_rate);
+			push_rst = ih.PushRatio(id, ifIndex, _ratio, ts, _max_rate);
+		}
+
+		if (ih.hinfo.flags & MyIntHeader::PATH_HASH) {
+			// every hop is in the hash, a probe also lists it
+			ih.FoldPath(id, ifIndex);
+			if (ih.hinfo.flags & MyIntHeader::PATH_PROBE)
+				ih.PushRoute(id, ifIndex);
+		}else if (push_rst <= 0 && m_routeSample->GetInteger(0, 3) == 0) {
+			ih.PushRoute(id, ifIndex);
 		}
 
-		if (push_rst <= 0) {
-			ih->PushRoute(id, ifIndex);
+		uint32_t grow = ih.GetSerializedSize() - size;
+		if (grow > 0){
+			buf = p->GrowAt(off, grow);
+			// the IPv4 total length
+			uint8_t *len = &buf[PppHeader::GetStaticSize() + 2];
+			uint16_t total = (len[0] << 8 | len[1]) + grow;
+			len[0] = total >> 8;
+			len[1] = total & 0xff;
 		}
+		ih.Write(&buf[off]);
+	}
+
+	if (m_flowletGap > 0){
+		// u = (qlen / T + txRate) / B, averaged over T = m_maxRtt
+		uint64_t dt = std::min(Simulator::Now().GetTimeStep() - m_lastPktTs[ifIndex], m_maxRtt);
+		Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(m_devices[ifIndex]);
+		double B = dev->GetDataRate().GetBitRate() / 8; // Bps
+		double u = (dev->GetQueue()->GetNBytesTotal() / (double)m_maxRtt + p->GetSize() / (double)std::max(dt, (uint64_t)1)) * 1e9 / B;
+		m_u[ifIndex] = m_u[ifIndex] * (m_maxRtt - dt) / m_maxRtt + u * dt / m_maxRtt;
 	}
+	m_txBytes[ifIndex] += p->GetSize();
+	m_lastPktSize[ifIndex] = p->GetSize();
+	m_lastPktTs[ifIndex] = Simulator::Now().GetTimeStep();
 }
 
 } /* namespace ns3 */
@@ -2,7 +2,9 @@
 #define SWITCH_NODE_H
 
 #include <unordered_map>
+#include <vector>
 #include <ns3/node.h>
+#include <ns3/random-variable-stream.h>
 #include "qbb-net-device.h"
 #include "switch-mmu.h"
 
@@ -11,43 +13,83 @@ namespace ns3 {
 class Packet;
 
 class SwitchNode : public Node{
-	static const uint32_t pCnt = 257;	// Number of ports used
 	static const uint32_t qCnt = 8;	// Number of queues/priorities used
 	uint32_t m_ecmpSeed;
-	std::unordered_map<uint32_t, int> m_rtTable; // map from ip address (u32) to egress port (index of dev)
+	// map from ip address (u32) to the egress ports (index of dev) it is spread over by EcmpHash,
+	// a port with a larger WCMP weight is in the list that many times
+	std::unordered_map<uint32_t, std::vector<int> > m_rtTable;
 
 	// monitor of PFC
-	uint32_t m_bytes[pCnt][pCnt][qCnt]; // m_bytes[inDev][outDev][qidx] is the bytes from inDev enqueued for outDev at qidx
-	
-	uint64_t m_txBytes[pCnt]; // counter of tx bytes
+	// m_bytes[GetBytesKey(inDev, outDev, qidx)] is the bytes from inDev enqueued for outDev at qidx,
+	// only (inDev, outDev, qidx) that ever had bytes enqueued have an entry; entries are kept at 0
+	// so that the busy queues do not insert a node on every enqueue
+	std::unordered_map<uint64_t, uint32_t> m_bytes;
 
-	uint32_t m_lastPktSize[pCnt];
-	uint64_t m_lastPktTs[pCnt]; // ns
-	double m_u[pCnt];
+	// per port, sized by ConfigNPort
+	std::vector<uint64_t> m_txBytes; // counter of tx bytes
+	std::vector<std::array<EventId, qCnt> > m_pauseRefresh; // next PAUSE of a paused ingress, before the last one expires
+
+	std::vector<uint32_t> m_lastPktSize;
+	std::vector<uint64_t> m_lastPktTs; // ns
+	std::vector<double> m_u; // utilization of the port over m_maxRtt, as HPCC computes it, kept under flowlet switching
+
+	// flowlet switching: a flowlet keeps its egress port until it pauses for m_flowletGap, then
+	// starts on the least congested next hop (LetFlow, with the port choice of CONGA)
+	struct Flowlet{
+		int port; // -1 if unused
+		uint64_t ts; // ns, its last packet
+	};
+	uint64_t m_flowletGap; // ns, 0 to hash every packet of a flow to the same next hop
+	uint32_t m_flowletTableSize;
+	bool m_flowletFeedback;
+	std::vector<Flowlet> m_flowlets; // by the 5-tuple hash, the flows that collide share an entry
+	// the deepest queue the ACKs from a destination report, of the flows sent to it through a port
+	struct PathCongestion{
+		uint32_t depth; // bytes
+		uint64_t ts; // ns
+	};
+	std::unordered_map<uint64_t, PathCongestion> m_pathCongestion; // key: dip << 32 | port
+
+	// picks the hops recorded by MyIntHeader::PushRoute, one stream per switch
+	// so that the draws do not depend on the order nodes run in
+	Ptr<UniformRandomVariable> m_routeSample;
 
 protected:
 	bool m_ecnEnabled;
 	uint32_t m_ccMode;
 	uint64_t m_maxRtt;
 
+	bool m_pfcEnabled; // queue by priority group
 	uint32_t m_ackHighPrio; // set high priority for ACK/NACK
 
 private:
 	int GetOutDev(Ptr<const Packet>, MyCustomHeader &ch);
-	void SendToDev(Ptr<Packet>p, MyCustomHeader &ch);
+	int GetFlowletPort(uint32_t hash, uint32_t dip, const std::vector<int> &nexthops);
+	double GetPortCongestion(uint32_t port, uint32_t dip, uint64_t now);
+	void UpdatePathCongestion(MyCustomHeader &ch);
+	void SendToDev(Ptr<Packet>p, MyCustomHeader &ch, uint32_t inDev);
+	static uint16_t GetIntOffset(MyCustomHeader &ch);
 	static uint32_t EcmpHash(const uint8_t* key, size_t len, uint32_t seed);
+	static uint64_t GetBytesKey(uint32_t inDev, uint32_t outDev, uint32_t qIndex);
+	void ResizePorts(uint32_t n);
 	void CheckAndSendPfc(uint32_t inDev, uint32_t qIndex);
 	void CheckAndSendResume(uint32_t inDev, uint32_t qIndex);
+	void RefreshPause(uint32_t inDev, uint32_t qIndex, Time since);
+	bool GetPeerIngress(uint32_t port, uint32_t &peer, uint32_t &peerPort); // false if the peer is not a switch
 public:
 	Ptr<SwitchMmu> m_mmu;
 	//uint8_t id;
-	uint64_t max_rate[pCnt];
+	std::vector<uint64_t> max_rate;
 
 	static TypeId GetTypeId (void);
 	SwitchNode();
-	void SetMaxRate(uint8_t _port, uint64_t _max_rate);
+	SwitchNode(uint32_t systemId);
+	void ConfigNPort(uint32_t n_port);
+	void SetMaxRate(uint32_t _port, uint64_t _max_rate);
+	uint32_t GetBytes(uint32_t inDev, uint32_t outDev, uint32_t qIndex);
 	void SetEcmpSeed(uint32_t seed);
-	void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
+	void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx); // add a next hop towards dstAddr
+	void ClearTableEntry(Ipv4Address &dstAddr); // remove the next hops towards dstAddr
 	void ClearTable();
 	bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, MyCustomHeader &ch);
 	void SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p);
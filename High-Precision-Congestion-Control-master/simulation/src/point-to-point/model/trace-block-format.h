@@ -0,0 +1,318 @@
+#ifndef TRACE_BLOCK_FORMAT_H
+#define TRACE_BLOCK_FORMAT_H
+#include <stdint.h>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include "trace-format.h"
+
+namespace ns3{
+
+/*
+ * Compressed trace file, written by TraceWriter (trace-writer.h) and read by analysis/trace_reader.
+ * The file is:
+ *   TraceFileHeader, SimSetting,
+ *   blocks: TraceBlockHeader, then TraceBlockHeader::size bytes,
+ *   index: one TraceIndexEntry per block, then TraceIndexTrailer.
+ * The index is written when the trace is closed; without it the blocks can still be read one
+ * after another. A block holds up to TRACE_BLOCK_RECORDS records, encoded by TraceBlockEncoder
+ * and then compressed by TraceLzCompress (size == rawSize means it is stored uncompressed).
+ * Each block decodes on its own, so a reader can seek to the blocks of a time range.
+ * The old format (SimSetting, then raw TraceFormat) never starts with TRACE_FILE_MAGIC.
+ */
+
+static const uint32_t TRACE_FILE_MAGIC = 0x5a525448; // "HTRZ"
+static const uint32_t TRACE_BLOCK_MAGIC = 0x42525448; // "HTRB"
+static const uint32_t TRACE_INDEX_MAGIC = 0x49525448; // "HTRI"
+static const uint32_t TRACE_FILE_VERSION = 1;
+static const uint32_t TRACE_BLOCK_RECORDS = 65536;
+
+struct TraceFileHeader{
+	uint32_t magic;
+	uint32_t version;
+};
+
+struct TraceBlockHeader{
+	uint32_t magic;
+	uint32_t count; // records
+	uint32_t rawSize; // encoded size before compression
+	uint32_t size; // bytes that follow
+	uint64_t firstTime, lastTime;
+};
+
+struct TraceIndexEntry{
+	uint64_t offset; // of the TraceBlockHeader
+	uint64_t firstTime, lastTime;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct TraceIndexTrailer{
+	uint64_t offset; // of the first TraceIndexEntry
+	uint32_t count;
+	uint32_t magic;
+};
+
+/*
+ * varint (LEB128) and zigzag
+ */
+static inline void PutVarint(std::vector<uint8_t> &out, uint64_t v){
+	while (v >= 0x80){
+		out.push_back((uint8_t)v | 0x80);
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+static inline const uint8_t* GetVarint(const uint8_t *p, const uint8_t *end, uint64_t &v){
+	v = 0;
+	for (uint32_t shift = 0; p < end && shift < 64; shift += 7){
+		uint8_t b = *p++;
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return p;
+	}
+	return NULL;
+}
+
+/*
+ * Record encoding:
+ *   time delta from the previous record of the block (zigzag varint)
+ *   port: index into the block's (node, intf, nodeType) dictionary (varint);
+ *         a new entry has the next index and is followed by node (varint), intf, nodeType
+ *   sip, dip: index into the block's address dictionary, a new entry is followed by the address
+ *   qidx, event, l3Prot, ecn
+ *   qlen, size (varint)
+ *   the union, as 32-bit words (varint); the words a protocol does not use are zero
+ */
+static const uint32_t TRACE_UNION_WORDS = sizeof(((TraceFormat*)0)->data) / 4;
+
+class TraceBlockEncoder{
+public:
+	TraceBlockEncoder(){
+		Reset();
+	}
+	void Reset(){
+		m_lastTime = 0;
+		m_port.clear();
+		m_ip.clear();
+	}
+	void Encode(const TraceFormat &tr, std::vector<uint8_t> &out){
+		int64_t dt = (int64_t)(tr.time - m_lastTime);
+		PutVarint(out, ((uint64_t)dt << 1) ^ (uint64_t)(dt >> 63));
+		m_lastTime = tr.time;
+		uint32_t port = ((uint32_t)tr.node << 16) | ((uint32_t)tr.intf << 8) | tr.nodeType;
+		if (PutIndex(m_port, port, out)){
+			PutVarint(out, tr.node);
+			out.push_back(tr.intf);
+			out.push_back(tr.nodeType);
+		}
+		PutAddress(tr.sip, out);
+		PutAddress(tr.dip, out);
+		out.push_back(tr.qidx);
+		out.push_back(tr.event);
+		out.push_back(tr.l3Prot);
+		out.push_back(tr.ecn);
+		PutVarint(out, tr.qlen);
+		PutVarint(out, tr.size);
+		uint32_t w[TRACE_UNION_WORDS];
+		memcpy(w, &tr.data, sizeof(w));
+		for (uint32_t i = 0; i < TRACE_UNION_WORDS; i++)
+			PutVarint(out, w[i]);
+	}
+private:
+	// returns true if the key is new
+	static bool PutIndex(std::unordered_map<uint32_t, uint32_t> &dict, uint32_t key, std::vector<uint8_t> &out){
+		auto it = dict.find(key);
+		if (it != dict.end()){
+			PutVarint(out, it->second);
+			return false;
+		}
+		uint32_t idx = dict.size();
+		dict[key] = idx;
+		PutVarint(out, idx);
+		return true;
+	}
+	void PutAddress(uint32_t ip, std::vector<uint8_t> &out){
+		if (PutIndex(m_ip, ip, out)){
+			uint8_t b[4];
+			memcpy(b, &ip, 4);
+			out.insert(out.end(), b, b + 4);
+		}
+	}
+
+	uint64_t m_lastTime;
+	std::unordered_map<uint32_t, uint32_t> m_port, m_ip;
+};
+
+class TraceBlockDecoder{
+public:
+	TraceBlockDecoder(){
+		Reset();
+	}
+	void Reset(){
+		m_lastTime = 0;
+		m_port.clear();
+		m_ip.clear();
+	}
+	// returns the end of the record, or NULL if the block is corrupted
+	const uint8_t* Decode(const uint8_t *p, const uint8_t *end, TraceFormat &tr){
+		uint64_t v;
+		memset(&tr, 0, sizeof(tr));
+		if ((p = GetVarint(p, end, v)) == NULL)
+			return NULL;
+		m_lastTime += (uint64_t)((int64_t)(v >> 1) ^ -(int64_t)(v & 1));
+		tr.time = m_lastTime;
+		if ((p = GetVarint(p, end, v)) == NULL)
+			return NULL;
+		if (v == m_port.size()){
+			uint64_t node;
+			if ((p = GetVarint(p, end, node)) == NULL || end - p < 2)
+				return NULL;
+			m_port.push_back(((uint32_t)node << 16) | ((uint32_t)p[0] << 8) | p[1]);
+			p += 2;
+		}else if (v > m_port.size())
+			return NULL;
+		tr.node = m_port[v] >> 16;
+		tr.intf = m_port[v] >> 8;
+		tr.nodeType = m_port[v];
+		if ((p = GetAddress(p, end, tr.sip)) == NULL || (p = GetAddress(p, end, tr.dip)) == NULL || end - p < 4)
+			return NULL;
+		tr.qidx = p[0];
+		tr.event = p[1];
+		tr.l3Prot = p[2];
+		tr.ecn = p[3];
+		p += 4;
+		if ((p = GetVarint(p, end, v)) == NULL)
+			return NULL;
+		tr.qlen = v;
+		if ((p = GetVarint(p, end, v)) == NULL)
+			return NULL;
+		tr.size = v;
+		uint32_t w[TRACE_UNION_WORDS];
+		for (uint32_t i = 0; i < TRACE_UNION_WORDS; i++){
+			if ((p = GetVarint(p, end, v)) == NULL)
+				return NULL;
+			w[i] = v;
+		}
+		memcpy(&tr.data, w, sizeof(w));
+		return p;
+	}
+private:
+	const uint8_t* GetAddress(const uint8_t *p, const uint8_t *end, uint32_t &ip){
+		uint64_t v;
+		if ((p = GetVarint(p, end, v)) == NULL)
+			return NULL;
+		if (v == m_ip.size()){
+			if (end - p < 4)
+				return NULL;
+			uint32_t a;
+			memcpy(&a, p, 4);
+			m_ip.push_back(a);
+			p += 4;
+		}else if (v > m_ip.size())
+			return NULL;
+		ip = m_ip[v];
+		return p;
+	}
+
+	uint64_t m_lastTime;
+	std::vector<uint32_t> m_port, m_ip;
+};
+
+/*
+ * Byte-oriented LZ77 in the LZ4 block layout: each sequence is a token (literal length in the
+ * high nibble, match length - 4 in the low nibble, 15 meaning more length bytes follow, each
+ * adding up to 255), the literals, a 16-bit offset and the extra match length bytes. The last
+ * sequence has literals only.
+ */
+static const uint32_t TRACE_LZ_HASH_BITS = 16;
+static const uint32_t TRACE_LZ_MIN_MATCH = 4;
+
+static inline void TraceLzPutLength(std::vector<uint8_t> &out, uint32_t len){
+	for (; len >= 255; len -= 255)
+		out.push_back(255);
+	out.push_back(len);
+}
+
+static inline void TraceLzCompress(const uint8_t *in, uint32_t n, std::vector<uint8_t> &out, std::vector<uint32_t> &table){
+	table.assign(1 << TRACE_LZ_HASH_BITS, 0xffffffff);
+	uint32_t anchor = 0, i = 0;
+	while (i + TRACE_LZ_MIN_MATCH <= n){
+		uint32_t seq;
+		memcpy(&seq, in + i, 4);
+		uint32_t h = (seq * 2654435761u) >> (32 - TRACE_LZ_HASH_BITS);
+		uint32_t cand = table[h];
+		table[h] = i;
+		if (cand == 0xffffffff || i - cand > 0xffff || memcmp(in + cand, in + i, TRACE_LZ_MIN_MATCH) != 0){
+			i++;
+			continue;
+		}
+		uint32_t len = TRACE_LZ_MIN_MATCH;
+		while (i + len < n && in[cand + len] == in[i + len])
+			len++;
+		uint32_t lit = i - anchor, ml = len - TRACE_LZ_MIN_MATCH;
+		out.push_back((std::min(lit, 15u) << 4) | std::min(ml, 15u));
+		if (lit >= 15)
+			TraceLzPutLength(out, lit - 15);
+		out.insert(out.end(), in + anchor, in + i);
+		out.push_back((i - cand) & 0xff);
+		out.push_back((i - cand) >> 8);
+		if (ml >= 15)
+			TraceLzPutLength(out, ml - 15);
+		i += len;
+		anchor = i;
+	}
+	uint32_t lit = n - anchor;
+	out.push_back(std::min(lit, 15u) << 4);
+	if (lit >= 15)
+		TraceLzPutLength(out, lit - 15);
+	out.insert(out.end(), in + anchor, in + n);
+}
+
+static inline const uint8_t* TraceLzGetLength(const uint8_t *p, const uint8_t *end, uint32_t &len){
+	uint8_t b;
+	do{
+		if (p == end)
+			return NULL;
+		b = *p++;
+		len += b;
+	}while (b == 255);
+	return p;
+}
+
+// returns false if the input is corrupted or does not decompress to exactly n bytes
+static inline bool TraceLzDecompress(const uint8_t *p, uint32_t size, uint8_t *out, uint32_t n){
+	const uint8_t *end = p + size;
+	uint32_t o = 0;
+	while (p < end){
+		uint8_t token = *p++;
+		uint32_t lit = token >> 4, ml = token & 15;
+		if (lit == 15 && (p = TraceLzGetLength(p, end, lit)) == NULL)
+			return false;
+		if ((uint32_t)(end - p) < lit || n - o < lit)
+			return false;
+		memcpy(out + o, p, lit);
+		p += lit;
+		o += lit;
+		if (p == end)
+			break;
+		if (end - p < 2)
+			return false;
+		uint32_t offset = p[0] | ((uint32_t)p[1] << 8);
+		p += 2;
+		if (ml == 15 && (p = TraceLzGetLength(p, end, ml)) == NULL)
+			return false;
+		ml += TRACE_LZ_MIN_MATCH;
+		if (offset == 0 || offset > o || n - o < ml)
+			return false;
+		// the match may overlap the bytes it produces
+		for (uint32_t k = 0; k < ml; k++, o++)
+			out[o] = out[o - offset];
+	}
+	return o == n;
+}
+
+}
+#endif /* TRACE_BLOCK_FORMAT_H */
@@ -0,0 +1,118 @@
+#include "ns3/mtp-interface.h"
+#include "trace-writer.h"
+
+namespace ns3 {
+
+TraceWriter::TraceWriter(FILE *file, bool compress) : m_file(file), m_compress(compress), m_closed(false), m_done(false){
+	if (!m_compress)
+		return;
+	TraceFileHeader h;
+	h.magic = TRACE_FILE_MAGIC;
+	h.version = TRACE_FILE_VERSION;
+	fwrite(&h, sizeof(h), 1, m_file);
+	m_block.reserve(TRACE_BLOCK_RECORDS);
+	m_thread = std::thread(&TraceWriter::Run, this);
+}
+
+TraceWriter::~TraceWriter(){
+	Close();
+}
+
+void TraceWriter::Write(const TraceFormat &tr){
+	MtpInterface::Write(&TraceWriter::Append, this, &tr, sizeof(tr));
+}
+
+void TraceWriter::Append(void *writer, const void *data, uint32_t size){
+	TraceWriter *w = (TraceWriter*)writer;
+	if (!w->m_compress){
+		fwrite(data, size, 1, w->m_file);
+		return;
+	}
+	w->m_block.push_back(*(const TraceFormat*)data);
+	if (w->m_block.size() == TRACE_BLOCK_RECORDS)
+		w->Push();
+}
+
+void TraceWriter::Push(){
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this]{ return m_queue.size() < kMaxPendingBlocks; });
+	m_queue.push_back(std::vector<TraceFormat>());
+	m_queue.back().swap(m_block);
+	m_cv.notify_all();
+	lock.unlock();
+	m_block.reserve(TRACE_BLOCK_RECORDS);
+}
+
+void TraceWriter::Run(){
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true){
+		m_cv.wait(lock, [this]{ return !m_queue.empty() || m_done; });
+		if (m_queue.empty())
+			break;
+		// the block stays in the queue while it is written, so it counts as pending
+		lock.unlock();
+		WriteBlock(m_queue.front());
+		lock.lock();
+		m_queue.pop_front();
+		m_cv.notify_all();
+	}
+}
+
+void TraceWriter::WriteBlock(const std::vector<TraceFormat> &block){
+	m_raw.clear();
+	m_encoder.Reset();
+	for (uint32_t i = 0; i < block.size(); i++)
+		m_encoder.Encode(block[i], m_raw);
+	m_compressed.clear();
+	TraceLzCompress(&m_raw[0], m_raw.size(), m_compressed, m_lzTable);
+	const std::vector<uint8_t> &data = m_compressed.size() < m_raw.size() ? m_compressed : m_raw;
+
+	TraceBlockHeader h;
+	h.magic = TRACE_BLOCK_MAGIC;
+	h.count = block.size();
+	h.rawSize = m_raw.size();
+	h.size = data.size();
+	h.firstTime = h.lastTime = block[0].time;
+	for (uint32_t i = 1; i < block.size(); i++){
+		h.firstTime = std::min(h.firstTime, (uint64_t)block[i].time);
+		h.lastTime = std::max(h.lastTime, (uint64_t)block[i].time);
+	}
+	TraceIndexEntry e;
+	e.offset = ftello(m_file);
+	e.firstTime = h.firstTime;
+	e.lastTime = h.lastTime;
+	e.count = h.count;
+	e.reserved = 0;
+	m_index.push_back(e);
+	fwrite(&h, sizeof(h), 1, m_file);
+	fwrite(&data[0], data.size(), 1, m_file);
+}
+
+void TraceWriter::Close(){
+	if (m_closed)
+		return;
+	m_closed = true;
+	if (!m_compress){
+		fflush(m_file);
+		return;
+	}
+	if (!m_block.empty())
+		Push();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done = true;
+		m_cv.notify_all();
+	}
+	m_thread.join();
+
+	TraceIndexTrailer t;
+	t.offset = ftello(m_file);
+	t.count = m_index.size();
+	t.magic = TRACE_INDEX_MAGIC;
+	if (!m_index.empty())
+		fwrite(&m_index[0], sizeof(TraceIndexEntry), m_index.size(), m_file);
+	fwrite(&t, sizeof(t), 1, m_file);
+	fflush(m_file);
+}
+
+} /* namespace ns3 */
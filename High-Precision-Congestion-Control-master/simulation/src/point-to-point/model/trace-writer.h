@@ -0,0 +1,61 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ns3/trace-format.h"
+#include "ns3/trace-block-format.h"
+
+namespace ns3 {
+
+/*
+ * Writes the packet trace of QbbHelper::EnableTracing.
+ *
+ * Uncompressed, records are written as raw TraceFormat, as they always were. Compressed, the
+ * constructor writes the TraceFileHeader, and the caller then writes the SimSetting; records
+ * are gathered into blocks of TRACE_BLOCK_RECORDS, which a background thread encodes,
+ * compresses and appends to the file (see trace-block-format.h). The simulation only waits
+ * when that thread falls more than kMaxPendingBlocks behind.
+ *
+ * Records are written in event order with any number of simulator threads (MtpInterface::Write).
+ */
+class TraceWriter {
+public:
+	TraceWriter(FILE *file, bool compress);
+	~TraceWriter();
+	void Write(const TraceFormat &tr);
+	void Close(); // write the pending records and the block index, the file stays open
+
+private:
+	static const uint32_t kMaxPendingBlocks = 4;
+
+	static void Append(void *writer, const void *data, uint32_t size);
+	void Push(); // hand the current block to the background thread
+	void Run(); // background thread
+	void WriteBlock(const std::vector<TraceFormat> &block);
+
+	FILE *m_file;
+	bool m_compress;
+	bool m_closed;
+	std::vector<TraceFormat> m_block;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv; // the queue changed
+	std::deque<std::vector<TraceFormat> > m_queue;
+	bool m_done;
+	std::thread m_thread;
+
+	// background thread only
+	TraceBlockEncoder m_encoder;
+	std::vector<uint8_t> m_raw, m_compressed;
+	std::vector<uint32_t> m_lzTable;
+	std::vector<TraceIndexEntry> m_index;
+};
+
+} /* namespace ns3 */
+
+#endif /* TRACE_WRITER_H */
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/enquserver-node.h"
+
+namespace ns3 {
+
+/*
+ * The node has no routes: the ACKs it forwards and the notifications it
+ * sends are dropped, only GetNotifySent counts the notifications.
+ */
+class EnquserverSharedTableTestCase : public TestCase
+{
+public:
+  EnquserverSharedTableTestCase ();
+  virtual void DoRun (void);
+
+private:
+  // an ACK of flow f, that passed the link (rid, port), or reports depth on it
+  void Ack (uint32_t f, uint16_t rid, uint16_t port, bool depth, bool fin = false);
+
+  Ptr<EnquserverNode> m_node;
+};
+
+EnquserverSharedTableTestCase::EnquserverSharedTableTestCase ()
+  : TestCase ("Check that EnquserverNode notifies the flows sharing a link, and removes the finished ones")
+{
+}
+
+void
+EnquserverSharedTableTestCase::Ack (uint32_t f, uint16_t rid, uint16_t port, bool depth, bool fin)
+{
+  MyCustomHeader ch;
+  ch.l3Prot = 0xFC;
+  ch.sip = 0x0b000101 + f; // from the receiver of the flow
+  ch.dip = 0x0b000001 + f;
+  ch.ack.sport = 100;
+  ch.ack.dport = 10000 + f;
+  ch.ack.flags = fin ? 1 << encHeader::FLAG_FIN : 0;
+  ch.ack.ih = MyIntHeader ();
+  if (depth)
+    {
+      ch.ack.ih.PushDepth (rid, port, 100000, 0, 0);
+    }
+  else
+    {
+      ch.ack.ih.PushRoute (rid, port);
+    }
+  m_node->MatchSharedTableSendToRelatedSender (0, Create<Packet> (0), ch);
+}
+
+void
+EnquserverSharedTableTestCase::DoRun (void)
+{
+  m_node = CreateObject<EnquserverNode> ();
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableSize (), 0, "A new table is empty");
+  Ack (0, 1, 2, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 0, "Depth on a link without flows");
+
+  // flows 0 1 2 on link (1, 2), flow 3 on link (3, 4)
+  for (uint32_t f = 0; f < 3; f++)
+    {
+      Ack (f, 1, 2, false);
+    }
+  Ack (3, 3, 4, false);
+  Ack (1, 1, 2, false); // already there
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableSize (), 2, "Links");
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableFlows (), 4, "Flows");
+
+  // the other flows of the link are notified, not the one of the ACK
+  Ack (0, 1, 2, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 2, "Notifications of flows 1 and 2");
+
+  // flow 1 is in the middle of the link's flows: flow 2 takes its place
+  Ack (1, 1, 2, false, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetFinFlows (), 1, "Flow 1 finished");
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableFlows (), 3, "Flows after flow 1");
+  Ack (0, 1, 2, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 3, "Notification of flow 2");
+
+  // flow 2 is found where it moved
+  Ack (2, 1, 2, false, true);
+  Ack (2, 1, 2, false, true); // FIN again
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetFinFlows (), 2, "Flow 2 finished once");
+  Ack (0, 1, 2, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 3, "Flow 0 alone on the link");
+
+  // the link is dropped with its last flow, the other one stays
+  Ack (0, 1, 2, false, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableSize (), 1, "Links after flow 0");
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetSharedTableFlows (), 1, "Flows after flow 0");
+  Ack (0, 1, 2, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 3, "Depth on a removed link");
+  Ack (0, 3, 4, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 4, "Notification of flow 3");
+
+  // a finished flow comes back
+  Ack (1, 3, 4, false);
+  Ack (0, 3, 4, true);
+  NS_TEST_ASSERT_MSG_EQ (m_node->GetNotifySent (), 6, "Notifications of flows 1 and 3");
+
+  m_node = 0;
+  Simulator::Destroy ();
+}
+
+class EnquserverNodeTestSuite : public TestSuite
+{
+public:
+  EnquserverNodeTestSuite ()
+    : TestSuite ("enquserver-node", UNIT)
+  {
+    AddTestCase (new EnquserverSharedTableTestCase ());
+  }
+} g_enquserverNodeTestSuite;
+
+} // namespace ns3
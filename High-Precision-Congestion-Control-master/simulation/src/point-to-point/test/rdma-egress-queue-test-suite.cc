@@ -0,0 +1,298 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-queue-pair.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ns3 {
+
+static const uint32_t g_mtu = 1000;
+
+// what RdmaHw::GetNxtPacket does to the qp, without the headers
+static Ptr<Packet>
+SendNextPacket (Ptr<RdmaQueuePair> qp)
+{
+  uint32_t size = std::min (qp->GetBytesLeft (), (uint64_t)g_mtu);
+  qp->snd_nxt += size;
+  return Create<Packet> (size);
+}
+
+// drives a RdmaEgressQueue as QbbNetDevice::DequeueAndTransmit and RdmaHw do
+class RdmaEgressQueueTestBase : public TestCase
+{
+public:
+  RdmaEgressQueueTestBase (std::string name);
+
+protected:
+  void Init (uint32_t scheduler);
+  Ptr<RdmaQueuePair> AddQp (uint16_t id, uint16_t pg, uint64_t size, uint32_t win = 0);
+  int Dequeue (void); // the id of the qp that sent a packet, -1 if none could
+  void Acknowledge (Ptr<RdmaQueuePair> qp, uint64_t ack);
+
+  Ptr<RdmaEgressQueue> m_queue;
+  std::vector<Ptr<RdmaQueuePair> > m_qps; // by id, finished ones included
+  bool m_paused[RdmaEgressQueue::qCnt];
+};
+
+RdmaEgressQueueTestBase::RdmaEgressQueueTestBase (std::string name)
+  : TestCase (name)
+{
+}
+
+void
+RdmaEgressQueueTestBase::Init (uint32_t scheduler)
+{
+  m_queue = CreateObject<RdmaEgressQueue> ();
+  m_queue->SetAttribute ("QpScheduler", UintegerValue (scheduler));
+  m_queue->m_qpGrp = CreateObject<RdmaQueuePairGroup> ();
+  m_queue->m_rdmaGetNxtPkt = MakeCallback (&SendNextPacket);
+  m_qps.clear ();
+  std::fill (m_paused, m_paused + RdmaEgressQueue::qCnt, false);
+}
+
+Ptr<RdmaQueuePair>
+RdmaEgressQueueTestBase::AddQp (uint16_t id, uint16_t pg, uint64_t size, uint32_t win)
+{
+  Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair> (pg, Ipv4Address ("11.0.0.1"), Ipv4Address ("11.0.1.1"), id, 100);
+  qp->SetSize (size);
+  qp->SetWin (win);
+  qp->m_nextAvail = Simulator::Now ();
+  m_queue->m_qpGrp->AddQp (qp);
+  m_queue->AddQp (qp);
+  m_qps.push_back (qp);
+  return qp;
+}
+
+int
+RdmaEgressQueueTestBase::Dequeue (void)
+{
+  int qIndex = m_queue->GetNextQindex (m_paused);
+  if (qIndex < 0)
+    {
+      return -1;
+    }
+  Ptr<RdmaQueuePair> qp = m_queue->GetQp (qIndex);
+  m_queue->DequeueQindex (qIndex);
+  m_queue->UpdateQp (qp);
+  return qp->sport;
+}
+
+void
+RdmaEgressQueueTestBase::Acknowledge (Ptr<RdmaQueuePair> qp, uint64_t ack)
+{
+  qp->Acknowledge (ack);
+  m_queue->UpdateQp (qp);
+}
+
+class RdmaEgressQueueRemovalTestCase : public RdmaEgressQueueTestBase
+{
+public:
+  RdmaEgressQueueRemovalTestCase (uint32_t scheduler);
+  virtual void DoRun (void);
+
+private:
+  uint32_t m_scheduler;
+};
+
+RdmaEgressQueueRemovalTestCase::RdmaEgressQueueRemovalTestCase (uint32_t scheduler)
+  : RdmaEgressQueueTestBase ("Check that the round robin goes on after the last qp when the finished qps are removed, QpScheduler " + std::string (1, '0' + scheduler)),
+    m_scheduler (scheduler)
+{
+}
+
+void
+RdmaEgressQueueRemovalTestCase::DoRun (void)
+{
+  // the last qp dequeued is the first one, and it is removed: the scan finds it at index 0
+  Init (m_scheduler);
+  AddQp (0, 0, 10 * g_mtu);
+  for (uint16_t i = 1; i < 4; i++)
+    {
+      AddQp (i, 1, 10 * g_mtu);
+    }
+  m_paused[1] = true;
+  NS_TEST_ASSERT_MSG_EQ (Dequeue (), 0, "Only qp 0 is not paused");
+  Acknowledge (m_qps[0], m_qps[0]->m_size);
+  NS_TEST_ASSERT_MSG_EQ (Dequeue (), -1, "qp 0 has finished, the others are paused");
+  if (m_scheduler != 1)
+    {
+      // the event-driven scheduler alone leaves the finished qps in m_qpGrp for a while
+      NS_TEST_ASSERT_MSG_EQ (m_queue->GetFlowCount (), 3, "The finished qp is not removed");
+      NS_TEST_ASSERT_MSG_EQ (m_queue->m_rrlast, 2, "m_rrlast is not on the last qp");
+    }
+  m_paused[1] = false;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (Dequeue (), (int)(1 + i % 3), "Round robin after the removal of qp 0");
+    }
+
+  // the last qp dequeued is removed along with the one before it
+  Init (m_scheduler);
+  uint16_t pgs[] = {1, 0, 0, 1, 1};
+  for (uint16_t i = 0; i < 5; i++)
+    {
+      AddQp (i, pgs[i], 10 * g_mtu);
+    }
+  m_paused[1] = true;
+  NS_TEST_ASSERT_MSG_EQ (Dequeue (), 1, "Round robin starts after qp 0");
+  NS_TEST_ASSERT_MSG_EQ (Dequeue (), 2, "qp 2 follows qp 1");
+  Acknowledge (m_qps[1], m_qps[1]->m_size);
+  Acknowledge (m_qps[2], m_qps[2]->m_size);
+  NS_TEST_ASSERT_MSG_EQ (Dequeue (), -1, "qps 1 and 2 have finished, the others are paused");
+  if (m_scheduler != 1)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_queue->GetFlowCount (), 3, "The finished qps are not removed");
+      NS_TEST_ASSERT_MSG_EQ (m_queue->m_rrlast, 0, "m_rrlast is not on qp 0, the last one kept before qp 2");
+    }
+  m_paused[1] = false;
+  int expected[] = {3, 4, 0, 3};
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (Dequeue (), expected[i], "Round robin after the removal of qps 1 and 2");
+    }
+  m_queue = 0;
+  m_qps.clear ();
+}
+
+class RdmaEgressQueueSchedulerTestCase : public RdmaEgressQueueTestBase
+{
+public:
+  RdmaEgressQueueSchedulerTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void Step (void);
+  std::vector<int64_t> RunOnce (uint32_t scheduler);
+
+  uint32_t m_state;
+  std::vector<int64_t> m_trace;
+};
+
+RdmaEgressQueueSchedulerTestCase::RdmaEgressQueueSchedulerTestCase ()
+  : RdmaEgressQueueTestBase ("Check that the event-driven qp scheduler picks the qps the scan does")
+{
+}
+
+void
+RdmaEgressQueueSchedulerTestCase::Step (void)
+{
+  m_state = m_state * 1103515245 + 12345;
+  uint32_t r = m_state >> 8;
+  Ptr<RdmaQueuePair> qp = m_qps[(r >> 4) % m_qps.size ()];
+  switch (r % 8)
+    {
+    case 0:
+      m_paused[(r >> 4) % 3] = !m_paused[(r >> 4) % 3];
+      break;
+    case 1:
+    case 2:
+      // acknowledge a packet, or everything sent
+      Acknowledge (qp, r % 8 == 1 ? std::min (qp->snd_una + g_mtu, qp->snd_nxt) : qp->snd_nxt);
+      break;
+    case 3:
+      // rate limited for a few ns
+      qp->m_nextAvail = Simulator::Now () + NanoSeconds (1 + (r >> 12) % 4);
+      m_queue->UpdateQp (qp);
+      break;
+    case 4:
+      if (m_qps.size () < 256)
+        {
+          AddQp (m_qps.size (), (r >> 12) % 3, (1 + (r >> 16) % 16) * g_mtu, (r >> 20) % 2 ? 3 * g_mtu : 0);
+        }
+      break;
+    default:
+      break;
+    }
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      int id = Dequeue ();
+      if (id >= 0)
+        {
+          m_trace.push_back (id);
+          continue;
+        }
+      // only when a wakeup has to be scheduled is its time the same for both
+      Time t = Max (m_queue->GetNextAvail (), Simulator::Now ());
+      m_trace.push_back (-1 - t.GetTimeStep ());
+      break;
+    }
+}
+
+std::vector<int64_t>
+RdmaEgressQueueSchedulerTestCase::RunOnce (uint32_t scheduler)
+{
+  Init (scheduler);
+  m_state = 1;
+  m_trace.clear ();
+  for (uint16_t i = 0; i < 8; i++)
+    {
+      AddQp (i, i % 3, (4 + i) * g_mtu, i % 2 ? 2 * g_mtu : 0);
+    }
+  for (uint32_t t = 0; t < 2000; t++)
+    {
+      Simulator::Schedule (NanoSeconds (t), &RdmaEgressQueueSchedulerTestCase::Step, this);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_queue = 0;
+  m_qps.clear ();
+  return m_trace;
+}
+
+void
+RdmaEgressQueueSchedulerTestCase::DoRun (void)
+{
+  std::vector<int64_t> scan = RunOnce (0);
+  uint32_t sent = std::count_if (scan.begin (), scan.end (), [](int64_t id) { return id >= 0; });
+  NS_TEST_ASSERT_MSG_GT (sent, 500u, "Too few packets sent to compare");
+  NS_TEST_ASSERT_MSG_GT (scan.size () - sent, 100u, "Too few steps in which no qp can send");
+
+  // QpScheduler 2 also aborts as soon as the two disagree
+  for (uint32_t scheduler = 1; scheduler <= 2; scheduler++)
+    {
+      std::vector<int64_t> trace = RunOnce (scheduler);
+      NS_TEST_ASSERT_MSG_EQ (trace.size (), scan.size (), "Different number of steps with QpScheduler " << scheduler);
+      size_t i = 0;
+      while (i < scan.size () && trace[i] == scan[i])
+        {
+          i++;
+        }
+      NS_TEST_EXPECT_MSG_EQ (i, scan.size (), "Step " << i << " differs with QpScheduler " << scheduler);
+    }
+}
+
+class RdmaEgressQueueTestSuite : public TestSuite
+{
+public:
+  RdmaEgressQueueTestSuite ()
+    : TestSuite ("rdma-egress-queue", UNIT)
+  {
+    for (uint32_t scheduler = 0; scheduler <= 2; scheduler++)
+      {
+        AddTestCase (new RdmaEgressQueueRemovalTestCase (scheduler));
+      }
+    AddTestCase (new RdmaEgressQueueSchedulerTestCase ());
+  }
+} g_rdmaEgressQueueTestSuite;
+
+} // namespace ns3
@@ -0,0 +1,281 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ppp-header.h"
+#include "ns3/custom-header-niux.h"
+#include "ns3/enc-header.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/rdma-hw.h"
+
+namespace ns3 {
+
+static const uint32_t g_mtu = 1000;
+
+class RdmaSackBitmapTestCase : public TestCase
+{
+public:
+  RdmaSackBitmapTestCase ();
+  virtual void DoRun (void);
+};
+
+RdmaSackBitmapTestCase::RdmaSackBitmapTestCase ()
+  : TestCase ("Check the segments RdmaSackBitmap keeps beyond the expected seq, and their SACK blocks")
+{
+}
+
+void
+RdmaSackBitmapTestCase::DoRun (void)
+{
+  RdmaSackBitmap sack;
+  uint32_t blocks[2 * encHeader::maxSack];
+  NS_TEST_ASSERT_MSG_EQ (sack.Any (), false, "A new bitmap is empty");
+  NS_TEST_ASSERT_MSG_EQ (sack.GetBlocks (0, g_mtu, blocks, encHeader::maxSack), 0, "No block of an empty bitmap");
+  NS_TEST_ASSERT_MSG_EQ (sack.Advance (3000, g_mtu), 3000, "An empty bitmap does not advance");
+
+  // segment 0 received, 1 lost, 2 3 5 received, then 7 the last, shorter one
+  uint32_t expected = g_mtu;
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 2000, g_mtu, g_mtu), true, "Segment 2");
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 3000, g_mtu, g_mtu), true, "Segment 3");
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 3000, g_mtu, g_mtu), false, "Segment 3 again");
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 5000, g_mtu, g_mtu), true, "Segment 5");
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 7000, 500, g_mtu), true, "Segment 7");
+  NS_TEST_ASSERT_MSG_EQ (sack.Advance (expected, g_mtu), expected, "Segment 1 is missing");
+
+  uint32_t n = sack.GetBlocks (expected, g_mtu, blocks, encHeader::maxSack);
+  uint32_t all[] = {2000, 4000, 5000, 6000, 7000, 7500};
+  NS_TEST_ASSERT_MSG_EQ (n, 3, "Blocks after segment 1");
+  for (uint32_t i = 0; i < 2 * n; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (blocks[i], all[i], "Bound " << i << " of the blocks");
+    }
+  NS_TEST_ASSERT_MSG_EQ (sack.GetBlocks (expected, g_mtu, blocks, 2), 2, "The blocks are clamped to max");
+  NS_TEST_EXPECT_MSG_EQ (blocks[3], 6000, "The second block");
+
+  // segment 1 fills the first hole
+  expected = sack.Advance (expected + g_mtu, g_mtu);
+  NS_TEST_ASSERT_MSG_EQ (expected, 4000, "Past segments 2 and 3");
+  NS_TEST_ASSERT_MSG_EQ (sack.GetBlocks (expected, g_mtu, blocks, encHeader::maxSack), 2, "Blocks after segment 4");
+  NS_TEST_EXPECT_MSG_EQ (blocks[0], 5000, "Start of the first block after segment 4");
+
+  // the last holes, up to the end of the shorter last segment
+  NS_TEST_ASSERT_MSG_EQ (sack.Add (expected, 6000, g_mtu, g_mtu), true, "Segment 6");
+  expected = sack.Advance (expected + g_mtu, g_mtu);
+  NS_TEST_ASSERT_MSG_EQ (expected, 7500, "Past the last segment");
+  NS_TEST_ASSERT_MSG_EQ (sack.Any (), false, "Every segment was taken");
+
+  // a segment far beyond the others grows the ring, the ones received stay
+  RdmaSackBitmap far;
+  NS_TEST_ASSERT_MSG_EQ (far.Add (0, 2000, g_mtu, g_mtu), true, "Segment 2");
+  NS_TEST_ASSERT_MSG_EQ (far.Add (0, 200000, g_mtu, g_mtu), true, "Segment 200");
+  NS_TEST_ASSERT_MSG_EQ (far.Add (0, 2000, g_mtu, g_mtu), false, "Segment 2 after the ring grew");
+  n = far.GetBlocks (0, g_mtu, blocks, encHeader::maxSack);
+  NS_TEST_ASSERT_MSG_EQ (n, 2, "Blocks of the grown ring");
+  NS_TEST_EXPECT_MSG_EQ (blocks[0], 2000, "Start of segment 2");
+  NS_TEST_EXPECT_MSG_EQ (blocks[2], 200000, "Start of segment 200");
+  NS_TEST_EXPECT_MSG_EQ (blocks[3], 201000, "End of segment 200");
+  NS_TEST_ASSERT_MSG_EQ (far.Advance (g_mtu, g_mtu), g_mtu, "Segment 1 is missing");
+  NS_TEST_ASSERT_MSG_EQ (far.Advance (2 * g_mtu, g_mtu), 3 * g_mtu, "Past segment 2");
+}
+
+class RdmaSackHeaderTestCase : public TestCase
+{
+public:
+  RdmaSackHeaderTestCase ();
+  virtual void DoRun (void);
+
+private:
+  // a NACK as RdmaHw::SendAck builds it, read back as the receiving nodes do
+  Ptr<Packet> BuildNack (const encHeader &encH);
+  MyCustomHeader Parse (Ptr<Packet> p);
+};
+
+RdmaSackHeaderTestCase::RdmaSackHeaderTestCase ()
+  : TestCase ("Check that the SACK blocks of an encHeader are read back by MyCustomHeader")
+{
+}
+
+Ptr<Packet>
+RdmaSackHeaderTestCase::BuildNack (const encHeader &encH)
+{
+  Ptr<Packet> p = Create<Packet> (0);
+  p->AddHeader (encH);
+  Ipv4Header head;
+  head.SetDestination (Ipv4Address ("11.0.0.1"));
+  head.SetSource (Ipv4Address ("11.0.1.1"));
+  head.SetProtocol (0xFD);
+  head.SetTtl (64);
+  head.SetPayloadSize (p->GetSize ());
+  p->AddHeader (head);
+  PppHeader ppp;
+  ppp.SetProtocol (0x0021);
+  p->AddHeader (ppp);
+  return p;
+}
+
+MyCustomHeader
+RdmaSackHeaderTestCase::Parse (Ptr<Packet> p)
+{
+  MyCustomHeader ch (MyCustomHeader::L2_Header | MyCustomHeader::L3_Header | MyCustomHeader::L4_Header);
+  ch.getInt = 1;
+  p->PeekHeader (ch);
+  return ch;
+}
+
+void
+RdmaSackHeaderTestCase::DoRun (void)
+{
+  uint32_t blocks[2 * (encHeader::maxSack + 2)];
+  for (uint32_t i = 0; i < 2 * (encHeader::maxSack + 2); i++)
+    {
+      blocks[i] = (i + 2) * g_mtu;
+    }
+
+  // no SACK
+  encHeader plain;
+  plain.SetSeq (1000);
+  MyCustomHeader ch = Parse (BuildNack (plain));
+  NS_TEST_ASSERT_MSG_EQ (ch.l3Prot, 0xFD, "A NACK");
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.seq, 1000, "seq");
+  NS_TEST_EXPECT_MSG_EQ (((ch.ack.flags >> encHeader::FLAG_SACK) & 1), 0, "No SACK flag");
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.nSack, 0, "No SACK block");
+
+  // the SACK flag without blocks, e.g. the receiver NACKs the last hole
+  encHeader empty;
+  empty.SetSeq (1000);
+  empty.SetSack (blocks, 0);
+  NS_TEST_EXPECT_MSG_EQ (empty.GetSerializedSize (), encHeader::GetBaseSize () + MyIntHeader ().GetSerializedSize () + 2, "Size of an empty SACK");
+  ch = Parse (BuildNack (empty));
+  NS_TEST_EXPECT_MSG_EQ (((ch.ack.flags >> encHeader::FLAG_SACK) & 1), 1, "The SACK flag");
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.nSack, 0, "No SACK block");
+
+  // more blocks than fit, after some INT
+  encHeader full;
+  full.SetSeq (1000);
+  MyIntHeader ih;
+  ih.PushRoute (3, 4);
+  ih.PushDepth (3, 4, 100000, 12345, 10);
+  full.SetMyIntHeader (ih);
+  full.SetSack (blocks, encHeader::maxSack + 2);
+  NS_TEST_EXPECT_MSG_EQ (full.GetSerializedSize (), encHeader::GetBaseSize () + ih.GetSerializedSize () + 2 + 8 * encHeader::maxSack, "Size of a full SACK");
+  Ptr<Packet> p = BuildNack (full);
+  ch = Parse (p);
+  NS_TEST_ASSERT_MSG_EQ (ch.ack.nSack, encHeader::maxSack, "SetSack clamps the blocks");
+  for (uint32_t i = 0; i < 2 * encHeader::maxSack; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (ch.ack.sack[i], blocks[i], "Bound " << i << " of the blocks");
+    }
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.ih.hinfo.depthNum, 1, "The INT before the blocks");
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.ih.dinfo[0].iinfo.port, 4, "The depth record before the blocks");
+
+  // a corrupted block count is clamped too
+  uint32_t size = p->GetSize ();
+  uint8_t bytes[256];
+  NS_TEST_ASSERT_MSG_EQ ((size <= sizeof (bytes)), true, "The NACK is too long");
+  p->CopyData (bytes, size);
+  uint32_t nSackOffset = PppHeader::GetStaticSize () + Ipv4Header ().GetSerializedSize ()
+    + encHeader::GetBaseSize () + ih.GetSerializedSize ();
+  bytes[nSackOffset] = 0xff;
+  bytes[nSackOffset + 1] = 0xff;
+  ch = Parse (Create<Packet> (bytes, size));
+  NS_TEST_ASSERT_MSG_EQ (ch.ack.nSack, encHeader::maxSack, "MyCustomHeader clamps the blocks");
+  NS_TEST_EXPECT_MSG_EQ (ch.ack.sack[2 * encHeader::maxSack - 1], blocks[2 * encHeader::maxSack - 1], "The last block kept");
+}
+
+class RdmaSelectiveRetransmitTestCase : public TestCase
+{
+public:
+  RdmaSelectiveRetransmitTestCase ();
+  virtual void DoRun (void);
+
+private:
+  void Nack (Ptr<RdmaQueuePair> qp, uint32_t seq, const uint32_t *blocks, uint32_t n);
+  Ptr<RdmaHw> m_hw;
+};
+
+RdmaSelectiveRetransmitTestCase::RdmaSelectiveRetransmitTestCase ()
+  : TestCase ("Check that a NACK with SACK blocks queues the holes to be sent again")
+{
+}
+
+void
+RdmaSelectiveRetransmitTestCase::Nack (Ptr<RdmaQueuePair> qp, uint32_t seq, const uint32_t *blocks, uint32_t n)
+{
+  MyCustomHeader ch;
+  ch.ack.seq = seq;
+  ch.ack.nSack = n;
+  for (uint32_t i = 0; i < 2 * n; i++)
+    {
+      ch.ack.sack[i] = blocks[i];
+    }
+  qp->Acknowledge (seq);
+  m_hw->RecoverSelective (qp, ch);
+}
+
+void
+RdmaSelectiveRetransmitTestCase::DoRun (void)
+{
+  m_hw = CreateObject<RdmaHw> ();
+  m_hw->SetAttribute ("Mtu", UintegerValue (g_mtu));
+  Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair> (0, Ipv4Address ("11.0.0.1"), Ipv4Address ("11.0.1.1"), 100, 100);
+  qp->SetSize (10000);
+  qp->snd_nxt = 8000;
+  uint64_t seq;
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), 0, "Nothing to send again");
+
+  // [1000, 2000) and [3000, 5000) were lost
+  uint32_t sack1[] = {2000, 3000, 5000, 8000};
+  Nack (qp, 1000, sack1, 2);
+  NS_TEST_ASSERT_MSG_EQ (qp->GetBytesLeft (), 2000 + 3000, "The holes and what is left");
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), g_mtu, "First hole");
+  NS_TEST_EXPECT_MSG_EQ (seq, 1000, "Seq of the first hole");
+
+  // the same NACK again: what was sent again is lost too, the holes are queued from the start
+  Nack (qp, 1000, sack1, 2);
+  NS_TEST_ASSERT_MSG_EQ (qp->GetBytesLeft (), 2000 + 3000, "The holes are queued again");
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), g_mtu, "First hole again");
+  NS_TEST_EXPECT_MSG_EQ (seq, 1000, "Seq of the first hole again");
+
+  // what was acknowledged in the meantime is not sent again
+  qp->Acknowledge (4000);
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), g_mtu, "Rest of the second hole");
+  NS_TEST_EXPECT_MSG_EQ (seq, 4000, "Seq of the rest of the second hole");
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), 0, "Every hole was sent again");
+  NS_TEST_ASSERT_MSG_EQ (qp->GetBytesLeft (), 2000, "Only what is left");
+
+  // a NACK without SACK block, e.g. only the NACK got through: one segment, not beyond snd_nxt
+  Nack (qp, 7500, sack1, 0);
+  NS_TEST_ASSERT_MSG_EQ (qp->NextRetransmit (g_mtu, seq), 500, "The segment before snd_nxt");
+  NS_TEST_EXPECT_MSG_EQ (seq, 7500, "Seq of the segment before snd_nxt");
+  m_hw = 0;
+}
+
+class RdmaSackTestSuite : public TestSuite
+{
+public:
+  RdmaSackTestSuite ()
+    : TestSuite ("rdma-sack", UNIT)
+  {
+    AddTestCase (new RdmaSackBitmapTestCase ());
+    AddTestCase (new RdmaSackHeaderTestCase ());
+    AddTestCase (new RdmaSelectiveRetransmitTestCase ());
+  }
+} g_rdmaSackTestSuite;
+
+} // namespace ns3
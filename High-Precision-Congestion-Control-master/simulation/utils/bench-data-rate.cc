@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/data-rate.h"
+
+using namespace ns3;
+
+/*
+ * Cost of the transmission time of a packet, as RdmaHw::UpdateNextAvail and
+ * QbbNetDevice::TransmitStart compute it.
+ *
+ *   double    Seconds (rate.CalculateTxTime (bytes)), as they used to
+ *   integer   rate.TxTime (bytes)
+ *   setrate   DataRate (bps), which precomputes the picoseconds per byte,
+ *             as the congestion control does on every rate update
+ *
+ * Both are then checked against the exact time: TxTime must match it, and
+ * the number of times the double computation is a time step short is shown.
+ */
+
+std::string g_me;
+#define LOG(x)   std::cout << x << std::endl
+#define LOGME(x) LOG (g_me << x)
+
+static void
+Report (std::string name, uint32_t n, double t)
+{
+  LOG (std::setw (10) << name <<
+       std::setw (12) << t << " s" <<
+       std::setw (14) << (n / t) << " ops/s");
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t total = 20000000;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark DataRate::TxTime against Seconds (DataRate::CalculateTxTime).");
+  cmd.AddValue ("total", "number of packets (default 2E7)", total);
+  cmd.Parse (argc, argv);
+  g_me = cmd.GetName () + ": ";
+  LOGME ("packets: " << total);
+
+  // Time objects are tracked until the simulator runs, as in a simulation
+  Simulator::Run ();
+
+  // rates as the congestion control leaves them, packet sizes from ACKs to MTU
+  std::vector<DataRate> rates;
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      rates.push_back (DataRate (100000000000ULL - i * 1234567891ULL));
+    }
+  uint32_t sizes[] = {60, 82, 1048, 1000, 1500, 4096, 9000, 64};
+
+  SystemWallClockMs time;
+  int64_t sum = 0;
+  time.Start ();
+  for (uint32_t i = 0; i < total; i++)
+    {
+      sum += Seconds (rates[i & 63].CalculateTxTime (sizes[i & 7])).GetTimeStep ();
+    }
+  Report ("double", total, time.End () / 1000.0);
+
+  int64_t sum2 = 0;
+  time.Start ();
+  for (uint32_t i = 0; i < total; i++)
+    {
+      sum2 += rates[i & 63].TxTime (sizes[i & 7]).GetTimeStep ();
+    }
+  Report ("integer", total, time.End () / 1000.0);
+
+  LOGME ("time steps: " << sum << " " << sum2);
+
+  // both against the exact time, bytes * 8e12 / bps picoseconds, for the
+  // line rates and the rates above
+  uint64_t lineRates[] = {10000000000ULL, 25000000000ULL, 40000000000ULL,
+                          100000000000ULL, 400000000000ULL};
+  for (uint32_t i = 0; i < sizeof (lineRates) / sizeof (lineRates[0]); i++)
+    {
+      rates.push_back (DataRate (lineRates[i]));
+    }
+  uint32_t checked = 0, doubleOff = 0;
+  for (uint32_t i = 0; i < rates.size (); i++)
+    {
+      uint64_t bps = rates[i].GetBitRate ();
+      for (uint32_t bytes = 0; bytes <= 9000; bytes++)
+        {
+          uint64_t n = (uint64_t)bytes * 8000000;
+          Time exact = Time::FromInteger (n / bps * 1000000 + n % bps * 1000000 / bps, Time::PS);
+          if (rates[i].TxTime (bytes) != exact)
+            {
+              LOGME ("mismatch at " << rates[i] << ", " << bytes << " bytes: "
+                     << rates[i].TxTime (bytes) << " instead of " << exact);
+              Simulator::Destroy ();
+              return 1;
+            }
+          doubleOff += Seconds (rates[i].CalculateTxTime (bytes)) != exact;
+          checked++;
+        }
+    }
+  LOGME ("integer exact for " << checked << " rates and sizes, double off for " << doubleOff);
+
+  time.Start ();
+  for (uint32_t i = 0; i < total; i++)
+    {
+      rates[i & 63] = DataRate (rates[i & 63].GetBitRate () ^ 1);
+    }
+  Report ("setrate", total, time.End () / 1000.0);
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,174 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdlib.h>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/enquserver-node.h"
+
+using namespace ns3;
+
+/*
+ * Replay a stream of ACKs through EnquserverNode::MatchSharedTableSendToRelatedSender.
+ *
+ * The node has no routes, so every forwarded packet and every notification is
+ * dropped at SendToDev; what is measured is the shared-table update and lookup.
+ *
+ * A recorded stream is an ascii file with one ACK per line:
+ *   l3Prot sip dip sport dport flags nodeNum [rid port] depthNum {rid port depth} ratioNum {rid port ratio}
+ * Without --file, a synthetic stream is generated in which every flow is
+ * recorded on one link and ACKs report depth on random links.
+ */
+
+std::string g_me;
+#define LOG(x)   std::cout << x << std::endl
+#define LOGME(x) LOG (g_me << x)
+
+struct AckRecord
+{
+  MyCustomHeader ch;
+};
+
+static bool
+ReadAck (std::istream &in, AckRecord &r)
+{
+  uint32_t l3Prot, sport, dport, flags, nodeNum, depthNum, ratioNum;
+  if (!(in >> l3Prot >> r.ch.sip >> r.ch.dip >> sport >> dport >> flags >> nodeNum))
+    {
+      return false;
+    }
+  r.ch.l3Prot = l3Prot;
+  r.ch.ack.sport = sport;
+  r.ch.ack.dport = dport;
+  r.ch.ack.flags = flags;
+  r.ch.ack.ih = MyIntHeader ();
+  for (uint32_t i = 0; i < nodeNum; i++)
+    {
+      uint32_t rid, port;
+      in >> rid >> port;
+      r.ch.ack.ih.iinfo[r.ch.ack.ih.hinfo.nodeNum++].Set (rid, port);
+    }
+  in >> depthNum;
+  for (uint32_t i = 0; i < depthNum; i++)
+    {
+      uint32_t rid, port, depth;
+      in >> rid >> port >> depth;
+      r.ch.ack.ih.dinfo[r.ch.ack.ih.hinfo.depthNum++].Set (rid, port, depth, 0, 0);
+    }
+  in >> ratioNum;
+  for (uint32_t i = 0; i < ratioNum; i++)
+    {
+      uint32_t rid, port, ratio;
+      in >> rid >> port >> ratio;
+      r.ch.ack.ih.rinfo[r.ch.ack.ih.hinfo.ratioNum++].Set (rid, port, ratio, 0, 0);
+    }
+  return true;
+}
+
+static std::vector<AckRecord>
+GenerateAcks (uint32_t flows, uint32_t links, uint32_t total)
+{
+  std::vector<AckRecord> acks;
+  srand (1);
+  // one learning ACK per flow, then congestion reports on random links
+  for (uint32_t f = 0; f < flows; f++)
+    {
+      AckRecord r;
+      r.ch.l3Prot = 0xFC;
+      r.ch.sip = 0x0b000001 + (f % 256) * 0x100;
+      r.ch.dip = 0x0b000001 + (f / 256 + 1) * 0x10000;
+      r.ch.ack.sport = 100;
+      r.ch.ack.dport = 10000 + f;
+      r.ch.ack.flags = 0;
+      r.ch.ack.ih = MyIntHeader ();
+      uint32_t l = f % links;
+      r.ch.ack.ih.iinfo[r.ch.ack.ih.hinfo.nodeNum++].Set (l >> 4, l & 0xf);
+      acks.push_back (r);
+    }
+  for (uint32_t i = 0; i < total; i++)
+    {
+      AckRecord r = acks[rand () % flows];
+      r.ch.ack.ih = MyIntHeader ();
+      uint32_t l = rand () % links;
+      r.ch.ack.ih.dinfo[r.ch.ack.ih.hinfo.depthNum++].Set (l >> 4, l & 0xf, 10, 0, 0);
+      acks.push_back (r);
+    }
+  return acks;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t flows = 4096;
+  uint32_t links = 64;
+  uint32_t total = 200000;
+  uint32_t runs = 1;
+  std::string filename = "";
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the shared-link table of the enquiry server.\n"
+             "\n"
+             "ACKs are read from --file=\"<filename>\", or generated.");
+  cmd.AddValue ("flows", "number of synthetic flows (default 4096)", flows);
+  cmd.AddValue ("links", "number of synthetic (router, port) links (default 64)", links);
+  cmd.AddValue ("total", "number of synthetic congestion ACKs (default 2E5)", total);
+  cmd.AddValue ("runs",  "number of runs (default 1)", runs);
+  cmd.AddValue ("file",  "file of recorded ACKs", filename);
+  cmd.Parse (argc, argv);
+  g_me = cmd.GetName () + ": ";
+
+  std::vector<AckRecord> acks;
+  if (filename == "")
+    {
+      LOGME ("generating " << flows << " flows on " << links << " links");
+      acks = GenerateAcks (flows, links, total);
+    }
+  else
+    {
+      LOGME ("replaying ACKs from " << filename);
+      std::ifstream in (filename.c_str ());
+      AckRecord r;
+      while (ReadAck (in, r))
+        {
+          acks.push_back (r);
+        }
+    }
+  LOGME ("ACKs: " << acks.size ());
+
+  for (uint32_t run = 0; run < runs; run++)
+    {
+      Ptr<EnquserverNode> node = CreateObject<EnquserverNode> ();
+      Ptr<Packet> p = Create<Packet> (0);
+      SystemWallClockMs time;
+      time.Start ();
+      for (uint32_t i = 0; i < acks.size (); i++)
+        {
+          MyCustomHeader ch = acks[i].ch;
+          node->MatchSharedTableSendToRelatedSender (0, p, ch);
+        }
+      double t = time.End () / 1000.0;
+      LOG (std::setw (6) << run <<
+           std::setw (12) << t << " s" <<
+           std::setw (14) << (acks.size () / t) << " ack/s" <<
+           std::setw (8) << node->GetSharedTableSize () << " links");
+    }
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+
+#include "ns3/core-module.h"
+#include "ns3/event-log.h"
+
+using namespace ns3;
+
+/*
+ * Cost per ACK of the RdmaHw::ReceiveAck trace line, as ostream text and as
+ * an event log record.
+ *
+ *   ostream   the text line the simulator used to print, to --out
+ *   filtered  EVLOG with the log not opened (runtime level 0)
+ *   binary    EVLOG into --out at EVLOG_DEBUG
+ *
+ * With the default NS3_EVLOG_MAX_LEVEL=0 both EVLOG cases compile to nothing;
+ * configure with --event-log-level=3 to measure the binary sink.
+ */
+
+std::string g_me;
+#define LOG(x)   std::cout << x << std::endl
+#define LOGME(x) LOG (g_me << x)
+
+static void
+Report (std::string name, uint32_t n, double t)
+{
+  LOG (std::setw (10) << name <<
+       std::setw (12) << t << " s" <<
+       std::setw (14) << (n / t) << " events/s");
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t total = 10000000;
+  std::string filename = "/dev/null";
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the event log against ostream tracing.");
+  cmd.AddValue ("total", "number of events (default 1E7)", total);
+  cmd.AddValue ("out",   "output file (default /dev/null)", filename);
+  cmd.Parse (argc, argv);
+  g_me = cmd.GetName () + ": ";
+  LOGME ("NS3_EVLOG_MAX_LEVEL=" << NS3_EVLOG_MAX_LEVEL << ", events: " << total);
+
+  SystemWallClockMs time;
+  {
+    std::ofstream out (filename.c_str ());
+    time.Start ();
+    for (uint32_t i = 0; i < total; i++)
+      {
+        out << "PG" << 3 << "dport" << (10000 + (i & 0xff)) << "seq" << i * 1000 << "ch-ack-flag" << (i & 1) << std::endl;
+      }
+    Report ("ostream", total, time.End () / 1000.0);
+  }
+
+  time.Start ();
+  for (uint32_t i = 0; i < total; i++)
+    {
+      EVLOG (EVLOG_DEBUG, EvRxAck, i & 0x3ff, i * 1000, 3, 10000 + (i & 0xff), i & 1);
+    }
+  Report ("filtered", total, time.End () / 1000.0);
+
+  EventLog::Open (filename, EVLOG_DEBUG);
+  time.Start ();
+  for (uint32_t i = 0; i < total; i++)
+    {
+      EVLOG (EVLOG_DEBUG, EvRxAck, i & 0x3ff, i * 1000, 3, 10000 + (i & 0xff), i & 1);
+    }
+  EventLog::Close ();
+  Report ("binary", total, time.End () / 1000.0);
+
+  return 0;
+}
@@ -0,0 +1,45 @@
+from __future__ import print_function
+import sys
+import struct
+from fractions import Fraction
+from optparse import OptionParser
+
+# Converts a flow file of traffic_gen.py to the binary flow file of the simulation (FlowFileHeader
+# and FlowRecord in scratch/third.cc): the header "HPCCFLOW" and the number of flows, then one
+# 32-byte record per flow, sorted by start time:
+#   start (ns, uint64), size (bytes, uint64), src, dst (uint32), pg, sport, dport, 0 (uint16)
+# The source ports are the ones the simulation gives the flows of the text file: 10000, 10001, ...
+# for the flows of each host pair, in the order they start.
+
+HEADER = struct.Struct("<8sQ")
+RECORD = struct.Struct("<QQIIHHHH")
+
+def to_ns(start_time):
+	# as Seconds(double) in the simulation: the double is truncated to ns, not rounded
+	ns = Fraction(float(start_time)) * 1000000000
+	return ns.numerator // ns.denominator
+
+if __name__ == "__main__":
+	parser = OptionParser(usage = "%prog [options] <flow file> <binary flow file>")
+	options, args = parser.parse_args()
+	if len(args) != 2:
+		parser.print_help()
+		sys.exit(1)
+
+	flows = []
+	with open(args[0]) as f:
+		n_flow = int(f.readline().split()[0])
+		for i in range(n_flow):
+			# <source host> <dest host> <pg> <dest port number> <flow size (bytes)> <start time (seconds)>
+			src, dst, pg, dport, size, start_time = f.readline().split()
+			flows.append((to_ns(start_time), i, int(src), int(dst), int(pg), int(dport), int(size)))
+	flows.sort() # by start time, then by line
+
+	port = {}
+	with open(args[1], "wb") as f:
+		f.write(HEADER.pack(b"HPCCFLOW", len(flows)))
+		for start, i, src, dst, pg, dport, size in flows:
+			sport = port.get((src, dst), 10000)
+			port[(src, dst)] = (sport + 1) & 0xffff
+			f.write(RECORD.pack(start, size, src, dst, pg, sport, dport, 0))
+	print("%d flows, %d host pairs"%(len(flows), len(port)))